@@ -0,0 +1,89 @@
+#ifndef ACCEPTOR_POOL_H
+#define ACCEPTOR_POOL_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "profiled_mutex.h"
+
+namespace chat {
+
+// Sockets de escuta na mesma porta com SO_REUSEPORT, cada um com a sua thread
+// de aceitação fixa num núcleo: o kernel reparte os SYN entre eles. Cada
+// thread espera com poll() e, quando acorda, aceita em lote com accept4()
+// até esvaziar a fila ou encher o lote, entregando tudo de uma vez.
+class AcceptorPool {
+public:
+    struct Accepted {
+        int fd;
+        std::string addr;
+        uint32_t ip; // IPv4 em ordem do host
+    };
+    // Recebe o lote; fica dono dos sockets
+    using Handler = std::function<void(std::vector<Accepted>& batch)>;
+
+    struct Stats {
+        uint64_t accepted;
+        uint64_t errors;
+        uint64_t last_second; // conexões aceites no último segundo completo
+        uint64_t peak_second;
+        std::vector<uint64_t> per_acceptor;
+    };
+
+    static const size_t ACCEPT_BATCH = 64;
+
+    // acceptors <= 0: um por núcleo. nonblocking: sockets aceites já com O_NONBLOCK
+    AcceptorPool(int port, int acceptors, int backlog, bool nonblocking);
+    ~AcceptorPool();
+
+    // Cria e faz bind/listen de todos os sockets (falha se a porta estiver ocupada)
+    bool open();
+    void start(Handler handler);
+    void stop();
+
+    Stats stats() const;
+    int get_acceptor_count() const { return acceptor_count_; }
+
+    AcceptorPool(const AcceptorPool&) = delete;
+    AcceptorPool& operator=(const AcceptorPool&) = delete;
+
+private:
+    struct Acceptor {
+        int listen_fd = -1;
+        std::thread thread;
+        std::atomic<uint64_t> accepted{0};
+    };
+
+    int port_;
+    int acceptor_count_;
+    int backlog_;
+    bool nonblocking_;
+    int wake_fd_; // eventfd partilhado: acorda todas as threads no stop()
+    std::atomic<bool> running_;
+    Handler handler_;
+    std::vector<std::unique_ptr<Acceptor>> acceptors_;
+    std::atomic<uint64_t> errors_;
+
+    // Janela de um segundo para a taxa de aceitação
+    mutable ProfiledMutex rate_mutex_{"acceptor.rate"};
+    int64_t rate_second_;
+    uint64_t rate_count_;
+    uint64_t rate_last_;
+    uint64_t rate_peak_;
+
+    // probe: só bind, sem SO_REUSEPORT nem listen, para confirmar que a porta está livre
+    int open_listener(bool probe);
+    void accept_loop(size_t index);
+    void record_batch(size_t count);
+    void close_all();
+};
+
+}
+
+#endif
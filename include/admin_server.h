@@ -0,0 +1,63 @@
+#ifndef ADMIN_SERVER_H
+#define ADMIN_SERVER_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <thread>
+#include <sys/types.h>
+
+namespace chat {
+
+// Listener de administração só local (socket Unix ou TCP em 127.0.0.1) que
+// responde a GETs HTTP/1.0 com o resultado de um handler por caminho. Uma
+// única thread serve os pedidos em série: é para scrapes periódicos, não
+// para tráfego. Os handlers correm nessa thread e só leem estado partilhado.
+class AdminServer {
+public:
+    using Handler = std::function<std::string()>;
+
+    // endpoint: número de porta TCP (escuta em 127.0.0.1) ou caminho de um socket Unix
+    explicit AdminServer(const std::string& endpoint);
+    ~AdminServer();
+
+    // Deve ser chamado antes de start()
+    void route(const std::string& path, const std::string& content_type, Handler handler);
+    bool start();
+    void stop();
+
+    const std::string& endpoint() const { return endpoint_; }
+    uint64_t get_requests() const { return requests_.load(std::memory_order_relaxed); }
+
+    AdminServer(const AdminServer&) = delete;
+    AdminServer& operator=(const AdminServer&) = delete;
+
+private:
+    struct Route {
+        std::string content_type;
+        Handler handler;
+    };
+
+    static const size_t MAX_REQUEST_SIZE = 8192;
+
+    std::string endpoint_;
+    bool unix_socket_;
+    int listen_fd_;
+    int wake_fd_;
+    dev_t socket_dev_;
+    ino_t socket_ino_;
+    std::atomic<bool> running_;
+    std::atomic<uint64_t> requests_;
+    std::map<std::string, Route> routes_;
+    std::thread thread_;
+
+    int open_listener();
+    void serve_loop();
+    void serve(int fd);
+};
+
+}
+
+#endif
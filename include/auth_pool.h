@@ -0,0 +1,78 @@
+#ifndef AUTH_POOL_H
+#define AUTH_POOL_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace chat {
+
+// Pool de threads dedicado à verificação de senhas. O KDF é caro de propósito;
+// corre aqui para que uma rajada de logins não bloqueie as threads de I/O. A
+// fila é limitada: quando está cheia, submit() recusa logo em vez de acumular.
+class AuthPool {
+public:
+    struct LatencyStats {
+        size_t samples;
+        double p50_ms;
+        double p95_ms;
+        double p99_ms;
+        double max_ms;
+    };
+
+    AuthPool(int workers, size_t max_queue);
+    ~AuthPool();
+
+    void start();
+    // Executa os pedidos já aceites e termina as threads
+    void stop();
+
+    // Retorna false (sem executar o job) se a fila estiver cheia ou o pool parado
+    bool submit(std::function<void()> job);
+
+    // Percentis do tempo entre submit() e o fim do job, sobre as últimas amostras
+    LatencyStats latency() const;
+    uint64_t get_completed() const;
+    uint64_t get_rejected() const;
+    size_t get_queue_depth() const;
+    int get_worker_count() const { return worker_count_; }
+
+    AuthPool(const AuthPool&) = delete;
+    AuthPool& operator=(const AuthPool&) = delete;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Job {
+        std::function<void()> fn;
+        Clock::time_point enqueued;
+    };
+
+    static const size_t LATENCY_SAMPLES = 4096;
+
+    int worker_count_;
+    size_t max_queue_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Job> queue_;
+    bool running_;
+    std::vector<std::thread> workers_;
+    uint64_t completed_;
+    uint64_t rejected_;
+
+    // Anel com as latências mais recentes, em microssegundos
+    std::vector<uint32_t> latency_us_;
+    size_t latency_next_;
+
+    void worker_loop();
+};
+
+}
+
+#endif
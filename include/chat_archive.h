@@ -0,0 +1,129 @@
+#ifndef CHAT_ARCHIVE_H
+#define CHAT_ARCHIVE_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "chat_common.h"
+#include "mpsc_queue.h"
+
+namespace chat {
+
+// --- FORMATO DO ARQUIVO ---
+// Segmentos de tamanho fixo "<primeiro seq, 20 dígitos>.seg", mapeados em memória:
+//   cabeçalho: "CHATARC1" + u64 primeiro seq
+//   registos:  [u32 tamanho total][u64 seq][u64 timestamp µs][u8 tipo][u8 len username]
+//              [u8 len target][u8 reservado][u16 len content] + username, target, content
+// Um tamanho 0 marca o fim dos dados. Ao lado, "<...>.idx" guarda um índice
+// esparso de entradas [u64 seq][u64 timestamp µs][u64 offset]. Inteiros em little-endian.
+// O seq é o do histórico (o que os clientes veem); privados e mensagens de sala
+// não têm seq próprio e herdam o do registo anterior, por isso os seqs são
+// crescentes mas podem repetir-se. O nome de cada segmento é maior ou igual a
+// qualquer seq dos segmentos anteriores.
+const char ARCHIVE_SEGMENT_MAGIC[8] = {'C', 'H', 'A', 'T', 'A', 'R', 'C', '1'};
+const size_t ARCHIVE_SEGMENT_HEADER_SIZE = 16;
+const size_t ARCHIVE_RECORD_HEADER_SIZE = 26;
+const size_t ARCHIVE_INDEX_ENTRY_SIZE = 24;
+
+struct ArchiveOptions {
+    std::string directory;
+    size_t segment_size = 64 * 1024 * 1024;
+    size_t queue_capacity = 4096;
+    size_t index_interval = 64; // um registo em cada N entra no índice
+};
+
+// Escritor do arquivo de mensagens. append() só enfileira (nunca bloqueia; se
+// a fila encher, o registo é descartado e contado) e uma thread própria grava
+// os lotes no segmento mapeado.
+class ChatArchive {
+public:
+    explicit ChatArchive(const ArchiveOptions& options);
+    ~ChatArchive();
+
+    bool start();
+    void stop();
+
+    // msg.seq é o número atribuído pelo HistoryRing (0 para privados e salas)
+    bool append(const Message& msg);
+    // Último seq já gravado quando start() correu: o histórico continua a partir dele
+    uint64_t recovered_seq() const { return recovered_seq_; }
+
+    uint64_t get_written() const { return written_.load(std::memory_order_relaxed); }
+    uint64_t get_dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    ChatArchive(const ChatArchive&) = delete;
+    ChatArchive& operator=(const ChatArchive&) = delete;
+
+private:
+    struct Entry {
+        Message msg;
+        uint64_t timestamp_us = 0;
+    };
+
+    ArchiveOptions options_;
+    MpscQueue<Entry> queue_;
+    std::thread writer_;
+    std::atomic<bool> running_;
+    std::atomic<uint64_t> written_;
+    std::atomic<uint64_t> dropped_;
+    uint64_t recovered_seq_;
+
+    // Estado da thread escritora
+    int segment_fd_;
+    int index_fd_;
+    char* map_;
+    size_t write_offset_;
+    uint64_t last_seq_;     // seq do último registo gravado
+    uint64_t segment_seq_;  // nome (primeiro seq) do segmento aberto
+    uint64_t segment_records_;
+    std::string index_batch_;
+
+    void writer_loop();
+    bool open_segment(uint64_t first_seq);
+    void close_segment();
+    bool write_record(const Entry& entry);
+    void flush_index();
+};
+
+struct ArchiveRecord {
+    uint64_t seq;
+    uint64_t timestamp_us;
+    MessageType type;
+    std::string_view username;
+    std::string_view target;
+    std::string_view content;
+};
+
+// Leitura offline: percorre os segmentos sem passar pelo servidor nem pelo log
+class ArchiveReader {
+public:
+    explicit ArchiveReader(const std::string& directory);
+
+    // Chama fn para cada registo com seq >= from_seq e timestamp >= from_time_us,
+    // por ordem, até fn retornar false; 0 desliga o respetivo limite. As views
+    // só valem durante a chamada.
+    size_t scan(uint64_t from_seq, uint64_t from_time_us,
+                const std::function<bool(const ArchiveRecord&)>& fn) const;
+
+    // Primeiro seq de cada segmento, por ordem crescente
+    std::vector<uint64_t> segments() const;
+    uint64_t last_seq() const;
+
+    static std::string segment_path(const std::string& directory, uint64_t first_seq);
+    static std::string index_path(const std::string& directory, uint64_t first_seq);
+
+private:
+    std::string directory_;
+
+    size_t seek_offset(uint64_t first_seq, uint64_t from_seq, uint64_t from_time_us) const;
+    bool first_timestamp(uint64_t first_seq, uint64_t& timestamp_us) const;
+};
+
+}
+
+#endif
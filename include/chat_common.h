@@ -2,6 +2,7 @@
 #define CHAT_COMMON_H
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <chrono>
 #include <iomanip>
@@ -9,9 +10,12 @@
 #include <algorithm>
 #include <cctype>
 #include <cstring>
+#include <memory>
 
 namespace chat {
 
+class ReadBuffer;
+
 // --- CONSTANTES ---
 const int DEFAULT_PORT = 8080;
 const int MAX_CLIENTS = 50;
@@ -25,8 +29,33 @@ enum class MessageType : uint8_t {
     REGISTER_REQUEST, LOGIN_REQUEST, DISCONNECT_REQUEST,
     CHAT_BROADCAST, PRIVATE_MESSAGE, AUTH_SUCCESS,
     AUTH_FAILURE, SERVER_MESSAGE, ERROR_MSG,
+    // Reconexão com o token de sessão recebido no AUTH_SUCCESS (campo password)
+    RESUME_REQUEST,
+    // Salas: o nome da sala segue no campo target_user
+    JOIN_ROOM, LEAVE_ROOM, ROOM_MESSAGE,
+    // Heartbeat: o servidor envia PING a sessões caladas, o cliente responde PONG
+    PING, PONG,
 };
 
+// --- PROTOCOLO DE REDE ---
+// v1: texto delimitado por '|' e terminado em '\n'. O número de sequência,
+//   quando existe, segue o tipo: "3:1234|user|...".
+// v2: binário com cabeçalho fixo e campos de tamanho variável:
+//   [magic 0xC2][type][flags][len username][len password][len target][len content u16 BE]
+//   com a flag SEQ, 8 bytes BE de número de sequência; depois username,
+//   password, target_user e content, sem terminadores.
+// A versão é escolhida pelo primeiro byte que o cliente envia no handshake.
+enum class ProtocolVersion : uint8_t { V1_TEXT = 1, V2_BINARY = 2 };
+
+const uint8_t PROTOCOL_V2_MAGIC = 0xC2;
+const size_t PROTOCOL_V2_HEADER_SIZE = 8;
+const uint8_t PROTOCOL_V2_FLAG_SEQ = 0x01;
+const size_t PROTOCOL_V2_SEQ_SIZE = 8;
+
+// Mensagem já codificada para o fio, imutável e partilhada entre
+// todas as filas de destino de um broadcast
+using WireBuffer = std::shared_ptr<const std::string>;
+
 // --- ESTRUTURA DA MENSAGEM ---
 struct Message {
     MessageType type;
@@ -34,12 +63,36 @@ struct Message {
     char password[MAX_PASSWORD_SIZE];
     char target_user[MAX_USERNAME_SIZE];
     char content[MAX_CONTENT_SIZE];
+    // Número de sequência dos broadcasts guardados no histórico (0 = sem número)
+    uint64_t seq;
+    // Instante em que o frame foi lido (StageMetrics::now, 0 = não medido); não vai para o fio
+    int64_t received_ns;
 
     Message(); 
     Message(MessageType type, const std::string& user, const std::string& content);
     
     std::string serialize() const;
-    static Message deserialize(const std::string& data);
+    static Message deserialize(std::string_view data);
+
+    // Protocolo v2: codifica/decodifica diretamente, sem objetos de stream
+    void serialize_binary(std::string& out) const;
+    static Message deserialize_binary(std::string_view frame);
+
+    // Frame completo pronto a enviar (inclui o '\n' no v1)
+    WireBuffer to_wire(ProtocolVersion version = ProtocolVersion::V1_TEXT) const;
+    static Message decode(std::string_view frame, ProtocolVersion version);
+};
+
+// Codifica uma mensagem no máximo uma vez por versão de protocolo durante um fan-out
+class WireCache {
+private:
+    const Message& msg_;
+    WireBuffer v1_;
+    WireBuffer v2_;
+
+public:
+    explicit WireCache(const Message& msg) : msg_(msg) {}
+    const WireBuffer& get(ProtocolVersion version);
 };
 
 // --- CLASSE DE UTILITÁRIOS ---
@@ -48,9 +101,18 @@ public:
     static std::string get_timestamp_str();
     static bool is_valid_username(const std::string& name);
     static bool is_valid_password(const std::string& pass);
-    static std::string filter_profanity(const std::string& message);
-    // Nova função de leitura segura que recebe o seu próprio buffer
-    static std::string read_line(int socket_fd, std::string& buffer);
+    // Bytes aleatórios do kernel (getrandom); lança std::runtime_error se falhar
+    static void random_bytes(uint8_t* out, size_t len);
+    // Leitura bloqueante de uma linha usando o buffer da conexão.
+    // Retorna false em EOF/erro; a view é válida até a próxima leitura.
+    static bool read_line(int socket_fd, ReadBuffer& buffer, std::string_view& line);
+
+    // Deteta a versão do protocolo pelo primeiro byte já recebido
+    static ProtocolVersion detect_protocol(const ReadBuffer& buffer);
+    // Extrai a próxima mensagem completa já presente no buffer
+    static bool next_frame(ReadBuffer& buffer, ProtocolVersion version, std::string_view& frame);
+    // Versão bloqueante de next_frame(); retorna false em EOF/erro
+    static bool read_frame(int socket_fd, ReadBuffer& buffer, ProtocolVersion version, std::string_view& frame);
 };
 
 } 
@@ -2,38 +2,139 @@
 #define CONNECTED_CLIENT_H
 
 #include "chat_common.h"
-#include "thread_safe_queue.h"
+#include "mpsc_queue.h"
+#include "read_buffer.h"
+#include "rate_limiter.h"
+#include "profiled_mutex.h"
 #include <string>
 #include <thread>
 #include <atomic>
+#include <mutex>
 #include <memory>
+#include <functional>
+#include <vector>
+#include <sys/types.h>
 
 namespace chat {
 
+// Resultado de uma escrita não bloqueante feita pelo reactor
+enum class FlushResult { DONE, WOULD_BLOCK, FAILED };
+
+// O que fazer com um cliente que não lê tão depressa quanto recebe mensagens
+enum class SlowConsumerPolicy {
+    DROP_NEW,    // descarta as mensagens que chegam com a fila cheia
+    DROP_OLDEST, // mantém as mais recentes, descartando as mais antigas
+    DISCONNECT   // expulsa o cliente
+};
+
+// Limites da fila de saída de cada cliente
+struct OutboundLimits {
+    size_t max_messages = 1024;
+    size_t max_bytes = 1024 * 1024;
+    SlowConsumerPolicy policy = SlowConsumerPolicy::DROP_NEW;
+};
+
 class ConnectedClient {
 private:
+    // Entrada da fila de saída com os instantes usados pelas métricas de estágio
+    struct OutboundWire {
+        WireBuffer wire;
+        int64_t origin_ns; // leitura do frame que originou a mensagem (0 = sem origem)
+        int64_t queued_ns;
+    };
+
     int socket_fd_;
+    ProfiledMutex socket_mutex_{"client.socket"};
     std::string username_;
+    ProtocolVersion protocol_;
     std::atomic<bool> active_;
+    std::atomic<bool> evicted_;
     std::thread sender_thread_;
-    ThreadSafeQueue<Message> outgoing_messages_;
+    // Última mensagem recebida (ms do relógio monótono), para o heartbeat
+    std::atomic<int64_t> last_activity_ms_;
+    // Limite de mensagens recebidas; o aviso ao cliente sai uma vez por rajada recusada
+    TokenBucket inbound_rate_;
+    std::atomic<uint64_t> throttled_;
+    bool throttle_notified_ = false;
+
+    // Limitada: um cliente lento nunca ocupa mais do que os limites configurados
+    OutboundLimits limits_;
+    MpscQueue<OutboundWire> outgoing_messages_;
+    std::atomic<size_t> queued_messages_;
+    std::atomic<size_t> queued_bytes_;
+    std::atomic<uint64_t> dropped_new_;
+    std::atomic<uint64_t> dropped_oldest_;
+
+    // Modo reactor: sem thread de envio, o event loop escreve no socket
+    std::function<void()> reactor_wake_;
+
+    // Lote retirado da fila e ainda não escrito por completo (usado só pelo
+    // consumidor: a thread de envio ou o event loop)
+    std::vector<OutboundWire> pending_batch_;
+    size_t pending_index_ = 0;
+    size_t pending_offset_ = 0;
 
     void sender_thread_func();
-    bool send_message_direct(const Message& msg);
+    bool take_batch();
+    ssize_t write_pending(int flags);
+    void release_accounting(const OutboundWire& entry);
+    bool over_limits() const;
+    void evict();
 
 public:
-    ConnectedClient(int socket, const std::string& username);
+    ConnectedClient(int socket, const std::string& username,
+                    ProtocolVersion protocol = ProtocolVersion::V1_TEXT,
+                    const OutboundLimits& limits = OutboundLimits());
     ~ConnectedClient();
 
     bool is_active() const { return active_.load(); }
+    const std::string& get_username() const { return username_; }
+    ProtocolVersion get_protocol() const { return protocol_; }
+
+    // Estatísticas da fila de saída
+    size_t get_queue_depth() const { return queued_messages_.load(); }
+    size_t get_queued_bytes() const { return queued_bytes_.load(); }
+    uint64_t get_dropped_new() const { return dropped_new_.load(); }
+    uint64_t get_dropped_oldest() const { return dropped_oldest_.load(); }
+    bool was_evicted() const { return evicted_.load(); }
+
+    uint64_t get_throttled() const { return throttled_.load(); }
+
+    // Deve ser chamado antes do cliente ser publicado em online_users_
+    void set_inbound_rate(const RateLimit& limit) { inbound_rate_.configure(limit); }
+    // Consome uma ficha por mensagem recebida. Chamado só por quem lê o socket;
+    // notify fica true na primeira recusa depois de uma mensagem aceite
+    bool admit_inbound(bool& notify);
+
+    void mark_activity();
+    // Milissegundos desde a última mensagem recebida (ou desde a autenticação)
+    int64_t get_idle_ms() const;
+
     void queue_message(const Message& msg);
+    // Enfileira um buffer já codificado no protocolo deste cliente, sem copiá-lo;
+    // origin_ns é o received_ns da mensagem (para a latência ponta a ponta)
+    void queue_wire(WireBuffer wire, int64_t origin_ns = 0);
+    // Fecha o socket: só a thread dona da sessão (a de leitura, ou o event loop) e o destrutor
     void disconnect();
-    void start_sender_thread();
-    std::string receive_data_blocking(std::string& read_buffer); 
+    // Para as outras threads (timers, outra sessão, stop()): só faz shutdown() e marca o
+    // cliente inativo; quem lê o socket vê EOF e fecha-o pelo caminho normal
+    void request_close();
+    // false se não houver descritores para o eventfd da fila; o cliente não deve ser publicado
+    bool start_sender_thread();
+    bool receive_data_blocking(ReadBuffer& read_buffer, std::string_view& frame);
+
+    // --- Modo reactor (epoll) ---
+    // Deve ser chamado antes do cliente ser publicado em online_users_
+    void attach_to_reactor(std::function<void()> wake);
+    bool is_reactor_managed() const { return static_cast<bool>(reactor_wake_); }
+    // Chamados apenas pela thread do event loop dono do socket
+    FlushResult flush_nonblocking();
+    int release_socket();
 };
 
+// Lista imutável de destinatários partilhada entre quem envia e o pool de fan-out
+using ClientList = std::vector<std::shared_ptr<ConnectedClient>>;
+
 } 
 
 #endif 
-
-
@@ -0,0 +1,83 @@
+#ifndef CONTENT_FILTER_H
+#define CONTENT_FILTER_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace chat {
+
+// Lista de palavras compilada num autómato de Aho-Corasick determinístico:
+// uma consulta de tabela por byte, qualquer que seja o número de palavras.
+// A comparação ignora maiúsculas ASCII. Os bytes que não pertencem a nenhuma
+// palavra partilham uma classe, o que mantém a tabela pequena. Imutável
+// depois de construído, por isso pode ser partilhado entre threads.
+class FilterAutomaton {
+public:
+    static const size_t MAX_WORD_LENGTH = 255;
+
+    // Palavras vazias ou maiores que MAX_WORD_LENGTH são ignoradas
+    explicit FilterAutomaton(const std::vector<std::string>& words);
+
+    // Substitui por '*' cada ocorrência de uma palavra; retorna quantas encontrou
+    size_t mask(char* data, size_t length) const;
+
+    size_t word_count() const { return word_count_; }
+    size_t state_count() const { return out_len_.size(); }
+
+private:
+    size_t word_count_;
+    uint32_t classes_;
+    uint8_t class_of_[256];
+    std::vector<uint32_t> delta_;   // estado * classes_ + classe -> estado
+    std::vector<uint8_t> out_len_;  // maior palavra que termina em cada estado
+    // Pré-filtro: bytes que podem iniciar uma palavra, em bitmap e em duas
+    // tabelas de nibbles para testar 16 bytes de uma vez com SSSE3
+    uint64_t start_bits_[4];
+    alignas(16) uint8_t start_lo_[16];
+    alignas(16) uint8_t start_hi_[16];
+
+    bool is_start(uint8_t byte) const { return (start_bits_[byte >> 6] >> (byte & 63)) & 1; }
+    // Primeira posição >= from onde pode começar uma palavra (length se nenhuma)
+    size_t next_candidate(const uint8_t* data, size_t from, size_t length) const;
+};
+
+// Filtro de conteúdo com a lista trocável a quente: o autómato atual é um
+// snapshot imutável publicado com std::atomic_store, como online_users_.
+class ContentFilter {
+public:
+    // Começa com a lista embutida
+    ContentFilter();
+
+    // Uma palavra por linha; linhas vazias e começadas por '#' são ignoradas.
+    // Se o ficheiro não abrir, a lista atual mantém-se e retorna false
+    bool load_file(const std::string& path);
+    // Recarrega o último ficheiro se a data de modificação ou o tamanho mudaram
+    bool reload_if_changed();
+
+    // Mascara o texto (terminado em '\0') no próprio buffer; true se alterou algo
+    bool apply(char* text) const;
+
+    std::shared_ptr<const FilterAutomaton> current() const { return std::atomic_load(&automaton_); }
+    uint64_t get_filtered() const { return filtered_.load(); }
+
+    ContentFilter(const ContentFilter&) = delete;
+    ContentFilter& operator=(const ContentFilter&) = delete;
+
+private:
+    std::shared_ptr<const FilterAutomaton> automaton_;
+    mutable std::atomic<uint64_t> filtered_;
+
+    // Só quem carrega o ficheiro
+    std::mutex file_mutex_;
+    std::string path_;
+    int64_t file_mtime_ns_;
+    int64_t file_size_;
+};
+
+}
+
+#endif
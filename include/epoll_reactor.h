@@ -0,0 +1,120 @@
+#ifndef EPOLL_REACTOR_H
+#define EPOLL_REACTOR_H
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <functional>
+#include <unordered_map>
+
+#include "connected_client.h"
+#include "timer_wheel.h"
+#include "profiled_mutex.h"
+
+namespace chat {
+
+// Event loop edge-triggered sobre epoll. Cada loop é uma thread que cuida da
+// leitura, do handshake de autenticação e da escrita de todos os seus sockets,
+// substituindo as duas threads por cliente do modo clássico.
+class EpollReactor {
+public:
+    // Resultado do handshake: o cliente autenticado (com a resposta já
+    // enfileirada) ou nullptr e a resposta a enviar antes de fechar
+    struct HandshakeResult {
+        std::shared_ptr<ConnectedClient> client;
+        WireBuffer reply;
+    };
+    using HandshakeDone = std::function<void(HandshakeResult)>;
+
+    struct Callbacks {
+        // Recebe a primeira mensagem do socket (a view só vale durante a chamada)
+        // e chama done exatamente uma vez, de qualquer thread. Até lá o loop
+        // guarda o que chegar no buffer de leitura sem o processar.
+        std::function<void(int fd, const std::string& addr, std::string_view frame,
+                           ProtocolVersion protocol, std::function<void()> wake,
+                           HandshakeDone done)> on_handshake;
+        // received_ns: instante da leitura que completou o frame (StageMetrics::now)
+        std::function<void(const std::shared_ptr<ConnectedClient>&, std::string_view frame,
+                           int64_t received_ns)> on_message;
+        std::function<void(const std::shared_ptr<ConnectedClient>&)> on_close;
+    };
+
+    // Com timers, um socket que não envia o pedido de autenticação dentro de
+    // handshake_timeout é fechado (0 = sem prazo)
+    EpollReactor(int num_loops, Callbacks callbacks, TimerWheel* timers = nullptr,
+                 std::chrono::milliseconds handshake_timeout = std::chrono::milliseconds(0));
+    ~EpollReactor();
+
+    bool start();
+    void stop();
+
+    // Entrega um socket recém-aceito a um dos loops (round-robin)
+    void add_connection(int fd, const std::string& addr);
+    // Lote de sockets já não bloqueantes: um lock e um wake por loop
+    void add_connections(std::vector<std::pair<int, std::string>>& conns);
+    int loop_count() const { return static_cast<int>(loops_.size()); }
+    uint64_t get_handshake_timeouts() const { return handshake_timeouts_.load(); }
+
+    EpollReactor(const EpollReactor&) = delete;
+    EpollReactor& operator=(const EpollReactor&) = delete;
+
+private:
+    struct Session {
+        int fd;
+        uint64_t id; // distingue sessões que reutilizam o mesmo fd
+        std::string addr;
+        std::unique_ptr<ReadBuffer> read_buffer;
+        ProtocolVersion protocol;
+        bool authenticating;
+        std::shared_ptr<ConnectedClient> client;
+        TimerWheel::Handle deadline; // prazo do handshake, cancelado ao chegar o pedido
+        int64_t read_ns;             // instante do último recv() com dados
+    };
+
+    struct CompletedHandshake {
+        int fd;
+        uint64_t session_id;
+        HandshakeResult result;
+    };
+
+    struct Loop {
+        int epoll_fd = -1;
+        int wake_fd = -1;
+        std::thread thread;
+
+        ProfiledMutex pending_mutex{"reactor.pending"};
+        std::vector<std::pair<int, std::string>> pending_new;
+        std::vector<int> pending_flush;
+        std::vector<CompletedHandshake> pending_handshakes;
+        std::vector<std::pair<int, uint64_t>> pending_timeouts; // (fd, id da sessão)
+
+        std::unordered_map<int, Session> sessions;
+        uint64_t next_session_id = 0;
+    };
+
+    Callbacks callbacks_;
+    std::vector<std::unique_ptr<Loop>> loops_;
+    std::atomic<bool> running_;
+    std::atomic<unsigned> next_loop_;
+    TimerWheel* timers_;
+    std::chrono::milliseconds handshake_timeout_;
+    std::atomic<uint64_t> handshake_timeouts_;
+
+    void run_loop(Loop& loop);
+    void wake(Loop& loop);
+    void request_flush(Loop& loop, int fd);
+    void register_pending(Loop& loop);
+    void complete_handshake(Loop& loop, CompletedHandshake& completed);
+    void handle_readable(Loop& loop, Session& session);
+    bool process_frames(Loop& loop, Session& session);
+    void handle_writable(Session& session);
+    void close_session(Loop& loop, int fd, bool notify);
+};
+
+}
+
+#endif
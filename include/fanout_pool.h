@@ -0,0 +1,91 @@
+#ifndef FANOUT_POOL_H
+#define FANOUT_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "connected_client.h"
+#include "mpsc_queue.h"
+#include "profiled_mutex.h"
+
+namespace chat {
+
+// Estágio de fan-out: abaixo do limiar a mensagem é enfileirada nos
+// destinatários pela própria thread que a enviou; a partir dele, o job vai
+// para os workers e quem enviou volta logo a ler o seu socket. Cada worker
+// trata uma fatia contígua [begin, end) da lista de destinatários. Como a
+// lista muda entre jobs, um cliente pode mudar de fatia: um worker só começa
+// um job depois de todas as fatias do anterior estarem entregues, e assim
+// cada cliente vê as mensagens pela ordem em que foram submetidas.
+class FanoutPool {
+public:
+    // threshold = 0 desativa o pool (fan-out sempre na thread de quem envia)
+    FanoutPool(int workers, size_t threshold);
+    ~FanoutPool();
+
+    void start();
+    // Entrega os jobs já aceites e termina os workers
+    void stop();
+
+    // Enfileira msg em todos os destinatários exceto skip (pode ser nullptr)
+    void deliver(std::shared_ptr<const ClientList> recipients, const Message& msg,
+                 const ConnectedClient* skip = nullptr);
+
+    uint64_t get_inline() const { return inline_jobs_.load(std::memory_order_relaxed); }
+    uint64_t get_parallel() const { return parallel_jobs_.load(std::memory_order_relaxed); }
+    int get_worker_count() const { return worker_count_; }
+    size_t get_threshold() const { return threshold_; }
+
+    FanoutPool(const FanoutPool&) = delete;
+    FanoutPool& operator=(const FanoutPool&) = delete;
+
+private:
+    struct Job {
+        std::shared_ptr<const ClientList> recipients;
+        const ConnectedClient* skip;
+        WireBuffer v1;
+        WireBuffer v2;
+        int64_t origin_ns;
+        uint64_t seq;               // ordem de submissão, a partir de 1
+        std::atomic<int> remaining; // workers que ainda não passaram pelo job
+    };
+    using JobPtr = std::shared_ptr<Job>;
+
+    struct Worker {
+        MpscQueue<JobPtr> queue;
+        std::thread thread;
+        Worker() : queue(QUEUE_CAPACITY) {}
+    };
+
+    static const size_t QUEUE_CAPACITY = 1024;
+
+    int worker_count_;
+    size_t threshold_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<bool> running_;
+    // Jobs ainda em curso: enquanto houver, nada passa pelo caminho em linha
+    std::atomic<size_t> pending_jobs_;
+    std::atomic<uint64_t> inline_jobs_;
+    std::atomic<uint64_t> parallel_jobs_;
+    // Serializa as submissões para todas as filas terem a mesma ordem
+    ProfiledMutex submit_mutex_{"fanout.submit"};
+    uint64_t next_seq_; // protegido por submit_mutex_
+    // Último job com todas as fatias entregues; o worker que o termina só toma o
+    // mutex para acordar os outros se algum estiver à espera
+    std::atomic<uint64_t> completed_seq_;
+    std::atomic<int> progress_waiters_;
+    std::mutex progress_mutex_;
+    std::condition_variable progress_cv_;
+
+    void run_slice(size_t index, Job& job);
+    void worker_loop(size_t index);
+};
+
+}
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef HDR_HISTOGRAM_H
+#define HDR_HISTOGRAM_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace chat {
+
+// Histograma de alcance dinâmico (estilo HDR) com buckets log-lineares: os
+// valores até 255 são exatos e acima disso cada potência de 2 divide-se em
+// 128 buckets, o que dá um erro relativo abaixo de 1% até ~2^40. Registar é
+// um índice calculado com clz e um fetch_add relaxado: pode ter um histograma
+// por thread e juntá-los com merge() enquanto continuam a ser escritos.
+class HdrHistogram {
+public:
+    static const int SUB_BUCKET_BITS = 7;
+    static const uint64_t SUB_BUCKETS = uint64_t(1) << SUB_BUCKET_BITS;
+    static const int MAX_VALUE_BITS = 40; // valores maiores são registados como 2^40 - 1
+    static const size_t BUCKETS = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    HdrHistogram() { reset(); }
+
+    void record(uint64_t value) {
+        counts_[bucket_for(value)].fetch_add(1, std::memory_order_relaxed);
+        total_.fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(value, std::memory_order_relaxed);
+        uint64_t max = max_.load(std::memory_order_relaxed);
+        while (value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {}
+    }
+
+    // Soma os contadores de outro histograma a este (o outro pode estar a ser escrito)
+    void merge(const HdrHistogram& other);
+    void reset();
+
+    uint64_t count() const { return total_.load(std::memory_order_relaxed); }
+    uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+    double mean() const;
+    // Valor abaixo do qual está a fração q (0..1) das amostras; limite superior do bucket
+    uint64_t percentile(double q) const;
+
+    HdrHistogram(const HdrHistogram&) = delete;
+    HdrHistogram& operator=(const HdrHistogram&) = delete;
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKETS> counts_;
+    std::atomic<uint64_t> total_;
+    std::atomic<uint64_t> sum_;
+    std::atomic<uint64_t> max_;
+
+    static size_t bucket_for(uint64_t value) {
+        if (value >= (uint64_t(1) << MAX_VALUE_BITS)) value = (uint64_t(1) << MAX_VALUE_BITS) - 1;
+        if (value < 2 * SUB_BUCKETS) return static_cast<size_t>(value);
+        int shift = 63 - __builtin_clzll(value) - SUB_BUCKET_BITS;
+        return static_cast<size_t>((shift + 1) * SUB_BUCKETS + ((value >> shift) - SUB_BUCKETS));
+    }
+    static uint64_t upper_bound_of(size_t bucket);
+};
+
+}
+
+#endif
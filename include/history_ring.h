@@ -0,0 +1,46 @@
+#ifndef HISTORY_RING_H
+#define HISTORY_RING_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "chat_common.h"
+#include "profiled_mutex.h"
+
+namespace chat {
+
+// Últimos N broadcasts com número de sequência, num anel pré-alocado: a
+// memória fica fixa no arranque e cada mensagem nova sobrescreve a mais antiga.
+// Os números só existem em memória e recomeçam em 1 a cada arranque; a época
+// (aleatória, fixa durante a vida do processo) diz ao cliente quando isso aconteceu.
+class HistoryRing {
+public:
+    explicit HistoryRing(size_t capacity);
+
+    // Atribui o próximo número de sequência à mensagem e guarda uma cópia
+    uint64_t append(Message& msg);
+    // Continua a numeração depois de seq (o último do arquivo em disco), para que
+    // o arquivo e os clientes usem os mesmos números; antes do primeiro append()
+    void resume_from(uint64_t seq);
+    // Codifica num único buffer todas as mensagens com seq > since ainda no
+    // anel, por ordem; retorna quantas foram incluídas
+    size_t encode_since(uint64_t since, ProtocolVersion version, std::string& out) const;
+
+    uint64_t last_seq() const;
+    size_t capacity() const { return slots_.size(); }
+    // 12 dígitos hexadecimais; cabe em Message::target_user
+    const std::string& epoch() const { return epoch_; }
+
+private:
+    std::vector<Message> slots_;
+    mutable ProfiledMutex mutex_{"history.ring"};
+    uint64_t last_seq_;
+    uint64_t first_seq_; // o replay nunca recua para antes deste
+    std::string epoch_;
+};
+
+}
+
+#endif
@@ -7,6 +7,11 @@
 #include <memory>
 #include <chrono>
 #include <sstream>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include "mpsc_ring.h"
+#include "profiled_mutex.h"
 
 namespace tslog {
 
@@ -18,33 +23,81 @@ enum class LogLevel {
     CRITICAL = 4
 };
 
+// SYNC escreve na thread que chamou log(); ASYNC coloca o registo num anel sem
+// locks e uma única thread de escrita grava em lotes
+enum class LogMode { SYNC, ASYNC };
+
+// O que fazer quando o anel do modo assíncrono está cheio
+enum class OverflowPolicy {
+    BLOCK,           // o produtor espera por espaço
+    DROP,            // descarta o registo (contado em dropped_count())
+    DROP_AND_REPORT  // descarta e a thread de escrita regista quantos se perderam
+};
+
+struct AsyncOptions {
+    size_t ring_capacity = 8192;
+    std::chrono::milliseconds flush_interval{200};
+    OverflowPolicy overflow = OverflowPolicy::DROP_AND_REPORT;
+};
+
 class Logger {
 private:
     static std::unique_ptr<Logger> instance_;
-    static std::mutex instance_mutex_;
+    static chat::ProfiledMutex instance_mutex_;
     
     std::ofstream log_file_;
-    std::mutex log_mutex_;
+    chat::ProfiledMutex log_mutex_{"log.write"};
     LogLevel min_level_;
     bool console_output_;
     bool file_output_;
     std::string filename_;
 
+    // --- Modo assíncrono ---
+    struct LogRecord {
+        LogLevel level;
+        std::chrono::system_clock::time_point time;
+        std::thread::id thread;
+        std::string message;
+    };
+
+    std::atomic<bool> async_{false};
+    AsyncOptions async_options_;
+    std::unique_ptr<MpscRing<LogRecord>> ring_;
+    std::thread writer_thread_;
+    std::atomic<bool> writer_running_{false};
+    std::atomic<bool> writer_idle_{false};
+    std::atomic<bool> flush_requested_{false};
+    std::mutex writer_mutex_;
+    std::condition_variable writer_cv_;
+    std::atomic<uint64_t> written_{0};
+    std::atomic<uint64_t> dropped_{0};
+
     Logger() = default;
     
     std::string get_timestamp() const;
+    std::string format_timestamp(std::chrono::system_clock::time_point time) const;
     std::string level_to_string(LogLevel level) const;
     std::string get_thread_id() const;
+    std::string format_thread_id(std::thread::id id) const;
+
+    void enqueue(LogLevel level, const std::string& message);
+    void wake_writer();
+    void writer_loop();
+    void start_writer();
+    void stop_writer();
     
 public:
     
     static Logger& getInstance();
     
   
+    // Deve ser chamado antes de outras threads começarem a registar
     void configure(const std::string& filename = "", 
                    LogLevel min_level = LogLevel::INFO,
                    bool console = true, 
-                   bool file = true);
+                   bool file = true,
+                   LogMode mode = LogMode::SYNC,
+                   const AsyncOptions& async_options = AsyncOptions());
     
     // Métodos de logging
     void log(LogLevel level, const std::string& message);
@@ -55,7 +108,13 @@ public:
     void critical(const std::string& message);
     
     
+    // No modo assíncrono espera até que tudo o que já foi registado chegue ao disco
     void flush();
+
+    // Estatísticas do modo assíncrono
+    uint64_t dropped_count() const { return dropped_.load(); }
+    size_t ring_occupancy() const { return ring_ ? ring_->size_approx() : 0; }
+    size_t ring_capacity() const { return ring_ ? ring_->capacity() : 0; }
     
     ~Logger();
     
@@ -0,0 +1,129 @@
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include "mpsc_ring.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+// Fila limitada sem locks (vários produtores, um consumidor) com acordar via
+// eventfd. Os produtores só fazem a syscall de acordar quando o consumidor
+// está de facto à espera, por isso o caminho comum de push() é só um CAS.
+// Sem eventfd (não pedido, ou recusado por falta de descritores) wait()
+// dorme no máximo FALLBACK_WAIT_MS de cada vez em vez de bloquear para sempre.
+template<typename T>
+class MpscQueue {
+private:
+    MpscRing<T> ring_;
+    int event_fd_;
+    std::atomic<bool> consumer_waiting_;
+    std::atomic<bool> shutdown_;
+
+    static const int SPIN_ITERATIONS = 64;
+    static const int FALLBACK_WAIT_MS = 10;
+
+    void signal() {
+        if (event_fd_ == -1) return;
+        uint64_t one = 1;
+        ssize_t ignored = write(event_fd_, &one, sizeof(one));
+        (void)ignored;
+    }
+
+public:
+    // with_wakeup = false: sem eventfd, para consumidores que nunca chamam wait()
+    // (o event loop do reactor); open_wakeup() cria-o mais tarde se for preciso
+    explicit MpscQueue(size_t capacity, bool with_wakeup = true)
+        : ring_(capacity), event_fd_(with_wakeup ? eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC) : -1),
+          consumer_waiting_(false), shutdown_(false) {}
+
+    ~MpscQueue() {
+        if (event_fd_ != -1) close(event_fd_);
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    // Cria o eventfd se ainda não existir; false se o sistema o recusar (ex.: EMFILE).
+    // Deve ser chamado antes de haver produtores
+    bool open_wakeup() {
+        if (event_fd_ == -1) event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        return event_fd_ != -1;
+    }
+    bool has_wakeup() const { return event_fd_ != -1; }
+
+    // Retorna false se a fila estiver cheia ou encerrada (o item não é movido)
+    bool push(T&& item) {
+        if (shutdown_.load(std::memory_order_relaxed)) return false;
+        if (!ring_.try_push(std::move(item))) return false;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        // Só o primeiro produtor a ver o consumidor adormecido faz a syscall
+        if (consumer_waiting_.load(std::memory_order_relaxed) &&
+            consumer_waiting_.exchange(false, std::memory_order_acq_rel)) {
+            signal();
+        }
+        return true;
+    }
+
+    bool try_pop(T& out) { return ring_.try_pop(out); }
+
+    // Retira até max_items de uma vez, chamando fn(T&&) para cada um
+    template<typename F>
+    size_t pop_all(F&& fn, size_t max_items = SIZE_MAX) {
+        size_t count = 0;
+        T item;
+        while (count < max_items && ring_.try_pop(item)) {
+            fn(std::move(item));
+            ++count;
+        }
+        return count;
+    }
+
+    // Bloqueia o consumidor até haver itens, shutdown ou timeout (-1 = infinito).
+    // Retorna true se houver algo para consumir.
+    bool wait(int timeout_ms = -1) {
+        // Espera ativa curta antes de dormir: em rajadas evita as syscalls
+        for (int spin = 0; spin < SPIN_ITERATIONS; ++spin) {
+            if (ring_.size_approx() > 0 || shutdown_.load(std::memory_order_relaxed)) {
+                return ring_.size_approx() > 0;
+            }
+            std::this_thread::yield();
+        }
+
+        consumer_waiting_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (ring_.size_approx() == 0 && !shutdown_.load()) {
+            if (event_fd_ == -1) {
+                // poll() ignora fds negativos: com -1 nunca acordaria
+                int bounded = timeout_ms < 0 || timeout_ms > FALLBACK_WAIT_MS ? FALLBACK_WAIT_MS : timeout_ms;
+                poll(nullptr, 0, bounded);
+            } else {
+                struct pollfd pfd;
+                pfd.fd = event_fd_;
+                pfd.events = POLLIN;
+                pfd.revents = 0;
+                poll(&pfd, 1, timeout_ms);
+            }
+        }
+        consumer_waiting_.store(false, std::memory_order_relaxed);
+
+        uint64_t counter;
+        while (event_fd_ != -1 && read(event_fd_, &counter, sizeof(counter)) > 0) {}
+        return ring_.size_approx() > 0;
+    }
+
+    void shutdown() {
+        shutdown_.store(true);
+        signal();
+    }
+
+    bool is_shutdown() const { return shutdown_.load(); }
+    int event_fd() const { return event_fd_; }
+    size_t size_approx() const { return ring_.size_approx(); }
+    size_t capacity() const { return ring_.capacity(); }
+};
+
+#endif
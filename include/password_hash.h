@@ -0,0 +1,29 @@
+#ifndef PASSWORD_HASH_H
+#define PASSWORD_HASH_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+namespace chat {
+
+// Hash de senhas com PBKDF2-HMAC-SHA256 e salt aleatório. O formato guardado
+// no banco de dados é "pbkdf2$<iterações>$<salt hex>$<hash hex>".
+class PasswordHasher {
+public:
+    static const uint32_t DEFAULT_ITERATIONS = 100000;
+    static const size_t SALT_SIZE = 16;
+    static const size_t HASH_SIZE = 32;
+
+    static std::string hash(const std::string& password, uint32_t iterations = DEFAULT_ITERATIONS);
+    // Aceita também entradas antigas em texto simples (ver is_hashed)
+    static bool verify(const std::string& password, const std::string& stored);
+    static bool is_hashed(const std::string& stored);
+
+    static void pbkdf2_sha256(const std::string& password, const uint8_t* salt, size_t salt_len,
+                              uint32_t iterations, uint8_t out[HASH_SIZE]);
+};
+
+}
+
+#endif
@@ -0,0 +1,186 @@
+#ifndef PROFILED_MUTEX_H
+#define PROFILED_MUTEX_H
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+namespace chat {
+
+// Estatísticas de um site de lock: todas as instâncias com o mesmo nome
+// (por exemplo, os 16 shards de um mapa) somam-se no mesmo site
+struct LockReport {
+    std::string name;
+    uint64_t acquisitions;
+    uint64_t contended;      // aquisições que tiveram de esperar
+    uint64_t wait_total_ns;  // soma das esperas
+    uint64_t wait_p50_ns;    // percentis só das aquisições com espera
+    uint64_t wait_p99_ns;
+    uint64_t wait_max_ns;
+    uint64_t hold_p50_ns;    // posse exclusiva; leitores partilhados não contam
+    uint64_t hold_p99_ns;
+    uint64_t hold_max_ns;
+};
+
+struct LockSite;
+
+// Registo dos sites. Só recolhe dados quando compilado com CHAT_LOCK_PROFILING
+// (make LOCK_PROFILING=1); sem ele os mutexes abaixo são std::mutex e
+// std::shared_mutex sem qualquer custo extra.
+class LockProfiler {
+public:
+#ifdef CHAT_LOCK_PROFILING
+    static constexpr bool ENABLED = true;
+#else
+    static constexpr bool ENABLED = false;
+#endif
+
+    // Site com este nome, criado na primeira chamada e nunca destruído
+    static LockSite* site(const char* name);
+    static void acquired(LockSite* site, bool contended, int64_t wait_ns);
+    static void released(LockSite* site, int64_t hold_ns);
+
+    // Ordenados pelo tempo total de espera, do pior para o melhor
+    static std::vector<LockReport> report();
+    static std::string report_text();
+
+    static int64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+};
+
+#ifdef CHAT_LOCK_PROFILING
+
+// Substituto de std::mutex que mede a espera (só quando o try_lock falha) e o
+// tempo de posse; o registo da posse é feito já depois de libertar o lock
+class ProfiledMutex {
+public:
+    explicit ProfiledMutex(const char* name) : site_(LockProfiler::site(name)) {}
+
+    void lock() {
+        if (mutex_.try_lock()) {
+            LockProfiler::acquired(site_, false, 0);
+        } else {
+            int64_t start = LockProfiler::now();
+            mutex_.lock();
+            LockProfiler::acquired(site_, true, LockProfiler::now() - start);
+        }
+        hold_start_ = LockProfiler::now();
+    }
+    bool try_lock() {
+        if (!mutex_.try_lock()) return false;
+        LockProfiler::acquired(site_, false, 0);
+        hold_start_ = LockProfiler::now();
+        return true;
+    }
+    void unlock() {
+        int64_t held = LockProfiler::now() - hold_start_;
+        mutex_.unlock();
+        LockProfiler::released(site_, held);
+    }
+
+    ProfiledMutex(const ProfiledMutex&) = delete;
+    ProfiledMutex& operator=(const ProfiledMutex&) = delete;
+
+private:
+    std::mutex mutex_;
+    LockSite* site_;
+    int64_t hold_start_ = 0; // escrito e lido só por quem detém o lock
+};
+
+// Substituto de std::shared_mutex; as aquisições partilhadas medem só a espera
+class ProfiledSharedMutex {
+public:
+    explicit ProfiledSharedMutex(const char* name) : site_(LockProfiler::site(name)) {}
+
+    void lock() {
+        if (mutex_.try_lock()) {
+            LockProfiler::acquired(site_, false, 0);
+        } else {
+            int64_t start = LockProfiler::now();
+            mutex_.lock();
+            LockProfiler::acquired(site_, true, LockProfiler::now() - start);
+        }
+        hold_start_ = LockProfiler::now();
+    }
+    bool try_lock() {
+        if (!mutex_.try_lock()) return false;
+        LockProfiler::acquired(site_, false, 0);
+        hold_start_ = LockProfiler::now();
+        return true;
+    }
+    void unlock() {
+        int64_t held = LockProfiler::now() - hold_start_;
+        mutex_.unlock();
+        LockProfiler::released(site_, held);
+    }
+
+    void lock_shared() {
+        if (mutex_.try_lock_shared()) {
+            LockProfiler::acquired(site_, false, 0);
+            return;
+        }
+        int64_t start = LockProfiler::now();
+        mutex_.lock_shared();
+        LockProfiler::acquired(site_, true, LockProfiler::now() - start);
+    }
+    bool try_lock_shared() {
+        if (!mutex_.try_lock_shared()) return false;
+        LockProfiler::acquired(site_, false, 0);
+        return true;
+    }
+    void unlock_shared() { mutex_.unlock_shared(); }
+
+    ProfiledSharedMutex(const ProfiledSharedMutex&) = delete;
+    ProfiledSharedMutex& operator=(const ProfiledSharedMutex&) = delete;
+
+private:
+    std::shared_mutex mutex_;
+    LockSite* site_;
+    int64_t hold_start_ = 0;
+};
+
+#else
+
+class ProfiledMutex {
+public:
+    explicit ProfiledMutex(const char*) {}
+
+    void lock() { mutex_.lock(); }
+    bool try_lock() { return mutex_.try_lock(); }
+    void unlock() { mutex_.unlock(); }
+
+    ProfiledMutex(const ProfiledMutex&) = delete;
+    ProfiledMutex& operator=(const ProfiledMutex&) = delete;
+
+private:
+    std::mutex mutex_;
+};
+
+class ProfiledSharedMutex {
+public:
+    explicit ProfiledSharedMutex(const char*) {}
+
+    void lock() { mutex_.lock(); }
+    bool try_lock() { return mutex_.try_lock(); }
+    void unlock() { mutex_.unlock(); }
+    void lock_shared() { mutex_.lock_shared(); }
+    bool try_lock_shared() { return mutex_.try_lock_shared(); }
+    void unlock_shared() { mutex_.unlock_shared(); }
+
+    ProfiledSharedMutex(const ProfiledSharedMutex&) = delete;
+    ProfiledSharedMutex& operator=(const ProfiledSharedMutex&) = delete;
+
+private:
+    std::shared_mutex mutex_;
+};
+
+#endif
+
+}
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef RATE_LIMITER_H
+#define RATE_LIMITER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+#include "profiled_mutex.h"
+
+namespace chat {
+
+// Taxa sustentada (eventos por segundo) e rajada máxima; per_second <= 0 desativa
+struct RateLimit {
+    double per_second = 0;
+    uint32_t burst = 1;
+
+    bool enabled() const { return per_second > 0; }
+};
+
+// Token bucket na forma GCRA: em vez de fichas guarda-se só o instante teórico
+// de chegada (TAT) do próximo evento. Um evento passa se o TAT não estiver mais
+// de (burst - 1) intervalos à frente de agora; cada evento empurra o TAT um
+// intervalo. O estado é um único inteiro atualizado com CAS, sem locks.
+class TokenBucket {
+public:
+    TokenBucket() : interval_ns_(0), tolerance_ns_(0), tat_ns_(0) {}
+    explicit TokenBucket(const RateLimit& limit) : TokenBucket() { configure(limit); }
+
+    // Não é thread-safe: configurar antes de partilhar o bucket
+    void configure(const RateLimit& limit);
+
+    bool try_acquire() { return interval_ns_ == 0 || try_acquire_at(now_ns()); }
+    bool try_acquire_at(int64_t now) {
+        int64_t tat = tat_ns_.load(std::memory_order_relaxed);
+        while (true) {
+            int64_t base = tat > now ? tat : now;
+            if (base - now > tolerance_ns_) return false;
+            if (tat_ns_.compare_exchange_weak(tat, base + interval_ns_, std::memory_order_relaxed)) return true;
+        }
+    }
+
+    static int64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+private:
+    int64_t interval_ns_; // 0 = sem limite
+    int64_t tolerance_ns_;
+    std::atomic<int64_t> tat_ns_;
+};
+
+// Um bucket por endereço IPv4, em shards com mutex próprio. Entradas cujo TAT
+// já passou equivalem a um bucket cheio e são removidas por prune().
+class IpRateLimiter {
+public:
+    explicit IpRateLimiter(const RateLimit& limit);
+
+    bool enabled() const { return interval_ns_ > 0; }
+    bool try_acquire(uint32_t ip);
+    // Retorna quantas entradas foram removidas
+    size_t prune();
+    size_t size() const;
+
+    IpRateLimiter(const IpRateLimiter&) = delete;
+    IpRateLimiter& operator=(const IpRateLimiter&) = delete;
+
+private:
+    static const size_t SHARDS = 16;
+    // Acima disto o shard é podado antes de inserir; se continuar cheio, o IP novo passa
+    static const size_t MAX_ENTRIES_PER_SHARD = 65536;
+
+    struct Shard {
+        mutable ProfiledMutex mutex{"ratelimit.ip"};
+        std::unordered_map<uint32_t, int64_t> tat_ns;
+    };
+
+    int64_t interval_ns_;
+    int64_t tolerance_ns_;
+    Shard shards_[SHARDS];
+
+    static size_t prune_shard(Shard& shard, int64_t now);
+};
+
+}
+
+#endif
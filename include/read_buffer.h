@@ -0,0 +1,47 @@
+#ifndef READ_BUFFER_H
+#define READ_BUFFER_H
+
+#include <string_view>
+#include <vector>
+#include <cstddef>
+#include <sys/types.h>
+
+namespace chat {
+
+// Buffer de leitura por conexão. Enche com recv() grandes e entrega linhas
+// como views para dentro do próprio buffer, sem copiar nem apagar a cada mensagem.
+// As views devolvidas por next_line() são válidas até a próxima chamada a fill().
+class ReadBuffer {
+private:
+    std::vector<char> data_;
+    size_t read_pos_;   // início dos bytes ainda não consumidos
+    size_t write_pos_;  // fim dos bytes recebidos
+    size_t scan_pos_;   // até onde já se procurou o delimitador
+    size_t max_size_;
+
+    void make_room();
+
+public:
+    static const size_t DEFAULT_CAPACITY = 16 * 1024;
+    static const size_t DEFAULT_MAX_SIZE = 1024 * 1024;
+
+    explicit ReadBuffer(size_t capacity = DEFAULT_CAPACITY, size_t max_size = DEFAULT_MAX_SIZE);
+
+    // Um único recv() para o espaço livre. Retorna como recv(): >0 bytes lidos,
+    // 0 em EOF, -1 em erro (EMSGSIZE se uma linha exceder max_size).
+    ssize_t fill(int socket_fd, int flags = 0);
+
+    // Extrai a próxima linha completa (sem o '\n'). Só examina bytes novos.
+    bool next_line(std::string_view& line);
+
+    // Acesso direto aos bytes pendentes, para protocolos com prefixo de tamanho
+    std::string_view peek() const { return std::string_view(data_.data() + read_pos_, write_pos_ - read_pos_); }
+    void consume(size_t n);
+
+    size_t buffered() const { return write_pos_ - read_pos_; }
+    void clear() { read_pos_ = write_pos_ = scan_pos_ = 0; }
+};
+
+}
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef RESUME_TOKENS_H
+#define RESUME_TOKENS_H
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "profiled_mutex.h"
+
+namespace chat {
+
+// Tokens de retoma de sessão, só em memória. Cada utilizador tem no máximo um
+// token; enquanto está online o token não expira, e o TTL começa a contar
+// quando a sessão termina. Cada token só pode ser usado uma vez.
+class ResumeTokenStore {
+public:
+    // Cabe no campo password da mensagem (MAX_PASSWORD_SIZE - 1)
+    static const size_t TOKEN_LENGTH = 15;
+
+    explicit ResumeTokenStore(int ttl_seconds);
+
+    bool enabled() const { return ttl_.count() > 0; }
+    // Gera um novo token para o utilizador, invalidando o anterior
+    std::string issue(const std::string& username);
+    // Valida e consome o token; falha se expirou ou pertence a outro utilizador
+    bool redeem(const std::string& token, const std::string& username);
+    // A sessão terminou: o token passa a expirar daqui a ttl segundos
+    void release(const std::string& username);
+    size_t size() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        std::string username;
+        Clock::time_point expires;
+    };
+
+    std::chrono::seconds ttl_;
+    mutable ProfiledMutex mutex_{"resume.tokens"};
+    std::unordered_map<std::string, Entry> by_token_;
+    std::unordered_map<std::string, std::string> by_user_;
+    Clock::time_point next_purge_;
+
+    void erase_user_token(const std::string& username);
+    void purge_expired(Clock::time_point now);
+};
+
+}
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef ROOM_REGISTRY_H
+#define ROOM_REGISTRY_H
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "connected_client.h"
+#include "profiled_mutex.h"
+
+namespace chat {
+
+// Salas de chat e os seus membros, divididas em shards pelo nome da sala:
+// salas em shards diferentes nunca disputam o mesmo lock. Cada sala guarda
+// um snapshot imutável da lista de membros, refeito só quando a lista mudou,
+// para que o envio para a sala corra sem lock e custe O(membros da sala).
+class RoomRegistry {
+public:
+    using Members = ClientList;
+
+    static const size_t MAX_ROOMS_PER_CLIENT = 32;
+
+    enum class JoinResult { JOINED, ALREADY_MEMBER, TOO_MANY_ROOMS };
+
+    RoomRegistry();
+
+    // member_count recebe o número de membros depois da entrada
+    JoinResult join(const std::string& room, const std::shared_ptr<ConnectedClient>& client,
+                    size_t& member_count);
+    bool leave(const std::string& room, const std::shared_ptr<ConnectedClient>& client);
+    // Tira o cliente de todas as salas (fim da sessão)
+    void leave_all(const std::shared_ptr<ConnectedClient>& client);
+
+    // Membros atuais, ou nullptr se a sala não existe ou o cliente não é membro
+    std::shared_ptr<const Members> members_if_member(const std::string& room,
+                                                      const ConnectedClient* client);
+    size_t room_count() const { return room_count_.load(std::memory_order_relaxed); }
+
+    RoomRegistry(const RoomRegistry&) = delete;
+    RoomRegistry& operator=(const RoomRegistry&) = delete;
+
+private:
+    struct Room {
+        std::unordered_map<const ConnectedClient*, std::shared_ptr<ConnectedClient>> members;
+        std::shared_ptr<const Members> snapshot; // nullptr = desatualizado
+    };
+    struct RoomShard {
+        ProfiledMutex mutex{"rooms.room_shard"};
+        std::unordered_map<std::string, Room> rooms;
+    };
+    // Índice inverso cliente -> salas, para a saída não percorrer todas as salas
+    struct ClientShard {
+        ProfiledMutex mutex{"rooms.client_shard"};
+        std::unordered_map<const ConnectedClient*, std::vector<std::string>> rooms;
+    };
+    static const size_t SHARD_COUNT = 16;
+
+    std::array<RoomShard, SHARD_COUNT> room_shards_;
+    std::array<ClientShard, SHARD_COUNT> client_shards_;
+    std::atomic<size_t> room_count_;
+
+    RoomShard& room_shard(const std::string& room);
+    ClientShard& client_shard(const ConnectedClient* client);
+    // Chamado com o lock do shard da sala
+    bool remove_member(RoomShard& shard, const std::string& room, const ConnectedClient* client);
+};
+
+}
+
+#endif
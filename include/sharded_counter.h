@@ -0,0 +1,45 @@
+#ifndef SHARDED_COUNTER_H
+#define SHARDED_COUNTER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace chat {
+
+const size_t THREAD_SHARDS = 16;
+
+// Shard fixo da thread atual, atribuído em round-robin à primeira chamada
+inline size_t thread_shard() {
+    static std::atomic<size_t> next(0);
+    thread_local size_t shard = next.fetch_add(1, std::memory_order_relaxed) % THREAD_SHARDS;
+    return shard;
+}
+
+// Contador somado por muitas threads: cada uma incrementa a célula do seu
+// shard (uma linha de cache cada) e load() soma-as sem parar quem escreve
+class ShardedCounter {
+public:
+    void add(uint64_t n) { cells_[thread_shard()].value.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t load() const {
+        uint64_t total = 0;
+        for (const Cell& cell : cells_) total += cell.value.load(std::memory_order_relaxed);
+        return total;
+    }
+
+private:
+    struct alignas(64) Cell {
+        std::atomic<uint64_t> value{0};
+    };
+    Cell cells_[THREAD_SHARDS];
+};
+
+// Bytes de mensagens trocados com os clientes, de todas as threads de I/O
+struct TrafficCounters {
+    static inline ShardedCounter bytes_in;
+    static inline ShardedCounter bytes_out;
+};
+
+}
+
+#endif
@@ -4,19 +4,38 @@
 #include <string>
 #include <thread>
 #include <atomic>
+#include <mutex>
+#include <set>
 #include "chat_common.h"
+#include "read_buffer.h"
 
 namespace chat {
 
 class SimpleChatClient {
 private:
-    int socket_fd_;
+    static const int MAX_RESUME_ATTEMPTS = 5;
+
+    std::atomic<int> socket_fd_;
     std::atomic<bool> is_connected_;
     std::atomic<bool> is_authenticated_;
     std::string username_;
     std::string server_address_;
     int server_port_;
+    ProtocolVersion protocol_;
+
+    // Credenciais para reconectar sozinho quando a conexão cai
+    std::string password_;
+    std::string resume_token_;
+    bool auto_reconnect_;
+    // Último número de sequência recebido: pedido no login para o replay do histórico
+    std::atomic<uint64_t> last_seq_;
+    // Época do histórico do servidor em que last_seq_ foi visto; muda quando o servidor reinicia
+    std::string history_epoch_;
+    // Salas em que o utilizador entrou: a sessão retomada volta a entrar nelas
+    std::mutex rooms_mutex_;
+    std::set<std::string> rooms_;
     
+    ReadBuffer read_buffer_;
     std::thread receiver_thread_;
     std::atomic<bool> should_stop_;
 
@@ -25,9 +44,13 @@ private:
     void process_chat_message(const Message& msg);
     
     bool establish_connection(); 
-    bool handle_auth_response(const std::string& response_data, const std::string& original_username);
+    bool exchange_auth(const Message& request, Message& response);
+    bool handle_auth_response(bool received, const Message& response_msg, const std::string& original_username);
+    // Reconecta com o token de sessão (ou a senha, se o token for recusado)
+    bool resume_session();
+    void rejoin_rooms();
     
-    bool send_data(const std::string& data);
+    bool send_message(const Message& msg);
 
 public:
     SimpleChatClient(const std::string& server_addr = "127.0.0.1", int port = DEFAULT_PORT);
@@ -37,10 +60,22 @@ public:
     bool connect_and_register(const std::string& username, const std::string& password);
     void disconnect();
 
+    // Versão do protocolo usada nas próximas conexões (padrão: v2 binário)
+    void set_protocol(ProtocolVersion protocol) { protocol_ = protocol; }
+    ProtocolVersion get_protocol() const { return protocol_; }
+
+    // Ao perder a conexão, tenta retomar a sessão automaticamente (padrão: ativo)
+    void set_auto_reconnect(bool enabled) { auto_reconnect_ = enabled; }
+
     void send_broadcast(const std::string& message);
     void send_private(const std::string& target, const std::string& message);
+    void join_room(const std::string& room);
+    void leave_room(const std::string& room);
+    void send_room(const std::string& room, const std::string& message);
 
     bool is_authenticated() const { return is_authenticated_.load(); }
+    // Continua true enquanto uma reconexão automática está em curso
+    bool is_connected() const { return is_connected_.load(); }
     const std::string& get_username() const { return username_; }
 };
 
@@ -5,6 +5,7 @@
 #include <string>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
 #include <atomic>
 #include <memory>
 #include <unordered_map>
@@ -12,40 +13,149 @@
 #include "chat_common.h"
 #include "user_database.h"
 #include "connected_client.h"
+#include "epoll_reactor.h"
+#include "auth_pool.h"
+#include "resume_tokens.h"
+#include "history_ring.h"
+#include "chat_archive.h"
+#include "room_registry.h"
+#include "fanout_pool.h"
+#include "acceptor_pool.h"
+#include "timer_wheel.h"
+#include "rate_limiter.h"
+#include "content_filter.h"
+#include "admin_server.h"
+#include "profiled_mutex.h"
 
 namespace chat {
 
+// Motor de I/O do servidor. THREADS é o modelo clássico (uma thread de leitura
+// e uma de envio por cliente); EPOLL usa event loops não bloqueantes.
+enum class ServerEngine { THREADS, EPOLL };
+
+struct ServerConfig {
+    int port = DEFAULT_PORT;
+    int acceptors = 1;          // sockets de escuta com SO_REUSEPORT; 0 = um por núcleo
+    int listen_backlog = 4096;  // limitado pelo net.core.somaxconn do kernel
+    ServerEngine engine = ServerEngine::THREADS;
+    int event_loops = 0; // 0 = um loop por núcleo
+    OutboundLimits outbound;
+    int auth_workers = 0; // 0 = uma thread por núcleo
+    size_t auth_queue_limit = 256;
+    uint32_t kdf_iterations = PasswordHasher::DEFAULT_ITERATIONS;
+    int resume_token_ttl = 300; // segundos após a desconexão; 0 desativa a retoma
+    size_t history_size = 256;  // broadcasts guardados para replay; 0 desativa
+    std::string archive_dir;    // vazio = sem arquivo de mensagens em disco
+    size_t archive_segment_size = ArchiveOptions().segment_size;
+    int fanout_workers = 0;       // 0 = uma thread por núcleo
+    size_t fanout_threshold = 256; // destinatários a partir dos quais o fan-out é paralelo; 0 desativa
+    // Prazos em segundos (0 desativa cada um)
+    int handshake_timeout = 10;  // até chegar o pedido de autenticação
+    int idle_timeout = 90;       // sem receber nada do cliente, nem PONG
+    int heartbeat_interval = 30; // silêncio a partir do qual o servidor envia PING
+    RateLimit message_rate{50, 100};      // mensagens por sessão (por segundo, rajada)
+    RateLimit connection_rate{200, 1000}; // conexões aceites por IP
+    std::string filter_file;    // vazio = lista de palavras embutida
+    bool stage_metrics = true;  // histogramas de latência por estágio
+    std::string admin_endpoint; // porta TCP em 127.0.0.1 ou caminho de socket Unix; vazio desativa
+};
+
 class SimpleChatServer {
 private:
-    int server_socket_;
+    using OnlineUsers = std::unordered_map<std::string, std::shared_ptr<ConnectedClient>>;
+
+    // Limite da espera do stop() pelas sessões destacadas do motor threads
+    static constexpr int SESSION_DRAIN_SECONDS = 2;
+
     int port_;
+    ServerConfig config_;
     std::atomic<bool> running_;
+    std::mutex stop_mutex_; // stop() concorrente espera pela paragem em curso
     
-    std::thread accept_thread_; 
+    std::unique_ptr<AcceptorPool> acceptors_;
+    std::unique_ptr<EpollReactor> reactor_;
 
     UserDatabase user_db_; 
+    AuthPool auth_pool_;
+    ResumeTokenStore resume_tokens_;
+    HistoryRing history_;
+    std::unique_ptr<ChatArchive> archive_; // nullptr sem --archive
+    RoomRegistry rooms_;
+    FanoutPool fanout_;
+    // Prazos de handshake e heartbeat de todas as conexões, sem thread por cliente
+    TimerWheel timers_;
+    IpRateLimiter connection_limiter_;
+    ContentFilter filter_;
+    std::unique_ptr<AdminServer> admin_; // nullptr sem --admin
+    // Mantém a atribuição de seq e a submissão ao fan-out na mesma ordem
+    ProfiledMutex broadcast_order_mutex_{"server.broadcast_order"};
 
-    mutable std::mutex online_users_mutex_;
-    std::unordered_map<std::string, std::shared_ptr<ConnectedClient>> online_users_;
+    // Registo copy-on-write: leitores pegam um snapshot imutável sem lock
+    // (std::atomic_load); entradas e saídas publicam uma nova versão.
+    // O mutex só serializa os escritores entre si.
+    ProfiledMutex online_users_write_mutex_{"server.online_users"};
+    std::shared_ptr<const OnlineUsers> online_users_;
+    // Os mesmos clientes em lista, publicada junto com online_users_ para o fan-out
+    std::shared_ptr<const ClientList> online_list_;
 
+    // Sessões do motor threads ainda dentro de handle_client (threads destacadas);
+    // a última a sair notifica sessions_cv_, por onde o stop() espera
+    std::mutex sessions_mutex_;
+    std::condition_variable sessions_cv_;
+    int threaded_sessions_;
     std::atomic<int> total_connections_;
     std::atomic<long> total_messages_processed_;
+    // Contadores de clientes lentos já desconectados (os online somam-se à parte)
+    std::atomic<uint64_t> retired_dropped_new_;
+    std::atomic<uint64_t> retired_dropped_oldest_;
+    std::atomic<uint64_t> evicted_clients_;
+    std::atomic<uint64_t> handshake_timeouts_; // só motor threads; o reactor conta os seus
+    std::atomic<uint64_t> idle_disconnects_;
+    std::atomic<uint64_t> throttled_messages_;
+    std::atomic<uint64_t> rejected_connections_;
 
-    bool setup_server_socket();
-    void cleanup_server_socket();
-    
-    void accept_connections();
+    void on_accepted(std::vector<AcceptorPool::Accepted>& batch);
     void handle_client(int client_socket, std::string client_addr);
+    Message make_auth_response(bool success, const std::string& text, const std::string& username);
+    // Envia numa só escrita o histórico posterior ao seq pedido no login (campo content)
+    void replay_history(const std::shared_ptr<ConnectedClient>& client, const Message& auth_msg);
+    bool authenticate(const Message& auth_msg, std::string& response_text);
+    // Corre authenticate() no pool (RESUME é barato e corre na própria thread);
+    // com a fila cheia, done é chamado de imediato com recusa
+    void authenticate_async(const Message& auth_msg, std::function<void(bool, const std::string&)> done);
+    // received_ns: instante da leitura do frame (StageMetrics::now)
+    void handle_client_line(std::string_view data, std::shared_ptr<ConnectedClient> client,
+                            int64_t received_ns);
+    // Aplica o filtro de conteúdo medindo o estágio FILTER
+    void filter_content(Message& msg);
+    // Agenda a próxima verificação de atividade do cliente (PING ou expulsão)
+    void arm_heartbeat(const std::shared_ptr<ConnectedClient>& client);
+    void check_liveness(const std::weak_ptr<ConnectedClient>& weak);
+    // Esquece periodicamente os IPs cujo bucket já voltou a encher
+    void schedule_rate_prune();
+    // Verifica periodicamente se o ficheiro de palavras mudou e recompila-o
+    void schedule_filter_reload();
+
+    void reactor_handshake(int client_socket, const std::string& client_addr,
+                           std::string_view initial_data, ProtocolVersion protocol,
+                           std::function<void()> wake, EpollReactor::HandshakeDone done);
     
     void process_client_message(const Message& msg, std::shared_ptr<ConnectedClient> client);
+    std::shared_ptr<const OnlineUsers> online_snapshot() const;
+    // Chamado com online_users_write_mutex_
+    void publish_online_users(std::shared_ptr<const OnlineUsers> users);
     void add_online_user(const std::string& username, std::shared_ptr<ConnectedClient> client);
-    void remove_online_user(const std::string& username);
+    void remove_online_user(const std::shared_ptr<ConnectedClient>& client);
     
-    void broadcast_message(const Message& msg);
+    size_t broadcast_message(const Message& msg, const ConnectedClient* skip = nullptr);
     void send_private_message(const Message& msg);
+    void handle_room_request(const Message& msg, const std::shared_ptr<ConnectedClient>& client);
+    // Envia só para os membros da sala; retorna o número de destinatários
+    size_t send_room_message(const Message& msg, const std::shared_ptr<ConnectedClient>& sender);
 
 public:
     SimpleChatServer(int port = DEFAULT_PORT);
+    explicit SimpleChatServer(const ServerConfig& config);
     ~SimpleChatServer();
 
     bool start();
@@ -55,6 +165,10 @@ public:
     int get_online_user_count() const;
     std::vector<std::string> get_online_usernames() const;
     void print_stats() const;
+    // Os mesmos números num objeto JSON, para ferramentas externas
+    std::string stats_json() const;
+    // Formato de texto do Prometheus, servido em /metrics pelo listener de administração
+    std::string metrics_text() const;
 };
 
 } 
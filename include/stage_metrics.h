@@ -0,0 +1,62 @@
+#ifndef STAGE_METRICS_H
+#define STAGE_METRICS_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace chat {
+
+// Estágios do caminho de uma mensagem, da chegada ao socket até ao send()
+enum class Stage {
+    READ,       // recv() não bloqueante de um lote de bytes (só no motor epoll)
+    PARSE,      // decode do frame para Message
+    FILTER,     // filtro de conteúdo
+    FANOUT,     // enfileirar nos destinatários ou submeter aos workers
+    QUEUE_WAIT, // tempo na fila de saída do destinatário até ser retirada
+    WRITE,      // sendmsg() de um lote
+    END_TO_END, // da leitura do frame ao último byte escrito para um destinatário
+    COUNT
+};
+
+// Latências por estágio em nanossegundos. Cada thread escreve no conjunto
+// de histogramas do seu thread_shard(), sem locks, e as leituras juntam-nos
+// a pedido. Desativado, now() devolve 0 e record() ignora as amostras: o
+// custo fica numa leitura relaxada.
+class StageMetrics {
+public:
+    struct Summary {
+        Stage stage;
+        uint64_t count;
+        double mean_ns;
+        uint64_t p50_ns;
+        uint64_t p99_ns;
+        uint64_t p999_ns;
+        uint64_t max_ns;
+    };
+
+    static void set_enabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+    static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+    // Relógio monótono em ns, ou 0 com as métricas desativadas
+    static int64_t now();
+    // Regista end - start; amostras com start == 0 (não medidas) são ignoradas
+    static void record(Stage stage, int64_t start, int64_t end) {
+        if (start != 0 && end >= start) record_value(stage, static_cast<uint64_t>(end - start));
+    }
+
+    static const char* name(Stage stage);
+    static std::vector<Summary> summarize();
+    // Objeto JSON com um campo por estágio
+    static std::string to_json();
+
+private:
+    static std::atomic<bool> enabled_;
+
+    static void record_value(Stage stage, uint64_t ns);
+};
+
+}
+
+#endif
@@ -34,7 +34,7 @@ public:
         }
         return std::nullopt; 
     }
-    
+
     void shutdown() {
         std::lock_guard<std::mutex> lock(mutex_);
         shutdown_ = true;
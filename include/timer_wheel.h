@@ -0,0 +1,86 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace chat {
+
+// Roda de temporizadores hierárquica (4 níveis de 64 posições) servida por uma
+// única thread. Agendar e cancelar são O(1); a cada tick só se processa uma
+// posição do nível 0 e, de 64 em 64 ticks, a posição seguinte do nível acima
+// desce para os níveis de baixo. Os callbacks correm na thread da roda e devem
+// ser curtos (fechar um socket, enfileirar uma mensagem, reagendar).
+class TimerWheel {
+private:
+    struct Entry {
+        uint64_t expires; // em ticks
+        std::function<void()> callback;
+        std::mutex mutex; // cancel() espera por um callback em curso
+        bool cancelled = false;
+    };
+
+public:
+    class Handle {
+    public:
+        Handle() = default;
+        // Depois de retornar, o callback já terminou ou nunca vai correr
+        void cancel();
+        explicit operator bool() const { return static_cast<bool>(entry_.lock()); }
+
+    private:
+        friend class TimerWheel;
+        explicit Handle(std::weak_ptr<Entry> entry) : entry_(std::move(entry)) {}
+        std::weak_ptr<Entry> entry_;
+    };
+
+    explicit TimerWheel(std::chrono::milliseconds tick = std::chrono::milliseconds(100));
+    ~TimerWheel();
+
+    void start();
+    // Os temporizadores pendentes são descartados sem correr
+    void stop();
+
+    Handle schedule(std::chrono::milliseconds delay, std::function<void()> callback);
+
+    size_t size() const { return armed_.load(std::memory_order_relaxed); }
+    std::chrono::milliseconds tick() const { return tick_; }
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+private:
+    using EntryPtr = std::shared_ptr<Entry>;
+    using Slot = std::vector<EntryPtr>;
+
+    static const int LEVELS = 4;
+    static const int SLOT_BITS = 6;
+    static const uint64_t SLOTS = 1 << SLOT_BITS;
+    static const uint64_t SLOT_MASK = SLOTS - 1;
+
+    std::chrono::milliseconds tick_;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::array<std::array<Slot, SLOTS>, LEVELS> wheel_;
+    uint64_t now_tick_;
+    bool running_;
+    std::thread thread_;
+    std::atomic<size_t> armed_;
+
+    // Chamados com mutex_
+    void insert(EntryPtr entry);
+    void advance(std::vector<EntryPtr>& expired);
+    void run();
+};
+
+}
+
+#endif
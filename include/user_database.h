@@ -1,33 +1,95 @@
 #ifndef USER_DATABASE_H
 #define USER_DATABASE_H
 
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <string>
 #include <unordered_map>
 #include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <thread>
 #include <vector>
 
+#include "password_hash.h"
+#include "profiled_mutex.h"
+
 namespace chat {
 
+// Utilizadores em memória, persistidos num snapshot (users.db) mais um
+// journal só de acréscimo (users.db.journal). Um registo custa um write()
+// no journal; uma thread de fundo compacta tudo num novo snapshot,
+// substituído de forma atómica com rename(). As senhas guardam-se com
+// PBKDF2; o mapa está dividido em shards e o KDF corre sempre fora dos locks.
 class UserDatabase {
 private:
+    using UserMap = std::unordered_map<std::string, std::string>; // username -> hash da senha
+
+    struct Shard {
+        mutable ProfiledSharedMutex mutex{"userdb.shard"};
+        UserMap users;
+    };
+    static const size_t SHARD_COUNT = 16;
+
     std::string db_filepath_;
-    std::unordered_map<std::string, std::string> users_; // username -> password
-    mutable std::mutex db_mutex_;
+    std::string journal_filepath_;
+    uint32_t kdf_iterations_;
+    std::array<Shard, SHARD_COUNT> shards_;
+    std::atomic<size_t> user_count_;
+
+    ProfiledMutex journal_mutex_{"userdb.journal"};
+    int journal_fd_;
+    size_t journal_records_;
+    bool journal_dirty_;   // registos escritos desde o último fdatasync do journal
+    bool rotated_pending_; // journal rodado cujo snapshot ainda não foi escrito
+
+    ProfiledMutex compaction_mutex_{"userdb.compaction"}; // só uma compactação de cada vez
+    std::mutex worker_mutex_;
+    std::condition_variable worker_cv_;
+    bool compact_requested_;
+    bool stopping_;
+    std::thread compaction_thread_;
+
+    // Reescrever o snapshot custa O(utilizadores): só compensa quando o journal já
+    // tem 1/COMPACT_FRACTION dos utilizadores (e pelo menos COMPACT_MIN_RECORDS)
+    static const size_t COMPACT_MIN_RECORDS = 4096;
+    static const size_t COMPACT_FRACTION = 4;
+    // Entre compactações o journal só leva fdatasync a cada intervalo
+    static constexpr int COMPACT_INTERVAL_SECONDS = 60;
+
+    Shard& shard_for(const std::string& username);
+    const Shard& shard_for(const std::string& username) const;
+    bool store(const std::string& username, const std::string& hashed);
 
     void load();
-    void save();
+    bool replay(const std::string& path, size_t& records);
+    bool open_journal();
+    void append_journal(const std::string& username, const std::string& password);
+    bool compaction_due() const; // chamado com journal_mutex_
+    void sync_journal();
+    bool write_snapshot(const UserMap& users);
+    void compaction_loop();
 
 public:
-    UserDatabase(const std::string& filepath = "users.db");
+    UserDatabase(const std::string& filepath = "users.db",
+                 uint32_t kdf_iterations = PasswordHasher::DEFAULT_ITERATIONS);
+    ~UserDatabase();
+
+    UserDatabase(const UserDatabase&) = delete;
+    UserDatabase& operator=(const UserDatabase&) = delete;
     
+    // Recusa nomes vazios ou com ':', '\r' ou '\n', que partiriam o formato do ficheiro
     bool add_user(const std::string& username, const std::string& password);
-    bool validate_user(const std::string& username, const std::string& password) const;
+    // Entradas antigas em texto simples são convertidas para hash no primeiro login
+    bool validate_user(const std::string& username, const std::string& password);
     bool user_exists(const std::string& username) const;
     size_t get_user_count() const;
+
+    // Reescreve o snapshot com todos os utilizadores e esvazia o journal
+    bool compact();
 };
 
 } 
 
 #endif 
-
-
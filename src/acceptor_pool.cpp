@@ -0,0 +1,230 @@
+#include "acceptor_pool.h"
+#include "libtslog.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace chat {
+
+namespace {
+int64_t now_seconds() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+}
+
+AcceptorPool::AcceptorPool(int port, int acceptors, int backlog, bool nonblocking)
+    : port_(port), acceptor_count_(acceptors), backlog_(backlog > 0 ? backlog : SOMAXCONN),
+      nonblocking_(nonblocking), wake_fd_(-1), running_(false), errors_(0),
+      rate_second_(0), rate_count_(0), rate_last_(0), rate_peak_(0) {
+    if (acceptor_count_ <= 0) {
+        acceptor_count_ = static_cast<int>(std::thread::hardware_concurrency());
+        if (acceptor_count_ <= 0) acceptor_count_ = 1;
+    }
+}
+
+AcceptorPool::~AcceptorPool() {
+    stop();
+    close_all();
+}
+
+int AcceptorPool::open_listener(bool probe) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        LOG_ERROR("Falha ao criar socket: " + std::string(strerror(errno)));
+        return -1;
+    }
+
+    // Permite reutilizar a porta imediatamente após fechar e partilhá-la entre os acceptors
+    int opt = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
+        LOG_WARNING("Falha ao definir SO_REUSEADDR");
+    }
+    if (!probe && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+        LOG_ERROR("Falha ao definir SO_REUSEPORT: " + std::string(strerror(errno)));
+        close(fd);
+        return -1;
+    }
+
+    struct sockaddr_in server_addr;
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_addr.s_addr = INADDR_ANY;
+    server_addr.sin_port = htons(port_);
+
+    if (bind(fd, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
+        LOG_ERROR("Falha no bind da porta " + std::to_string(port_) + ": " + std::string(strerror(errno)));
+        close(fd);
+        return -1;
+    }
+    if (probe) return fd;
+    if (listen(fd, backlog_) < 0) {
+        LOG_ERROR("Falha no listen: " + std::string(strerror(errno)));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool AcceptorPool::open() {
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd_ < 0) {
+        LOG_ERROR("Falha ao criar eventfd: " + std::string(strerror(errno)));
+        return false;
+    }
+    // Sonda sem SO_REUSEPORT: se outro processo já escuta na porta (mesmo com
+    // SO_REUSEPORT) o bind falha com EADDRINUSE, em vez de os sockets abaixo se
+    // juntarem aos dele e ficarem com metade das conexões
+    int probe = open_listener(true);
+    if (probe < 0) {
+        close_all();
+        return false;
+    }
+    close(probe);
+    for (int i = 0; i < acceptor_count_; ++i) {
+        auto acceptor = std::make_unique<Acceptor>();
+        acceptor->listen_fd = open_listener(false);
+        if (acceptor->listen_fd < 0) {
+            close_all();
+            return false;
+        }
+        acceptors_.push_back(std::move(acceptor));
+    }
+    LOG_INFO("Socket do servidor configurado com sucesso na porta " + std::to_string(port_) + " (" +
+             std::to_string(acceptor_count_) + " acceptors, backlog " + std::to_string(backlog_) + ")");
+    return true;
+}
+
+void AcceptorPool::start(Handler handler) {
+    if (acceptors_.empty() || running_.exchange(true)) return;
+    handler_ = std::move(handler);
+    unsigned cores = std::thread::hardware_concurrency();
+    for (size_t i = 0; i < acceptors_.size(); ++i) {
+        acceptors_[i]->thread = std::thread(&AcceptorPool::accept_loop, this, i);
+        if (cores > 0) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(i % cores, &set);
+            pthread_setaffinity_np(acceptors_[i]->thread.native_handle(), sizeof(set), &set);
+        }
+    }
+}
+
+void AcceptorPool::stop() {
+    if (!running_.exchange(false)) return;
+    uint64_t one = 1;
+    ssize_t ignored = write(wake_fd_, &one, sizeof(one));
+    (void)ignored;
+    for (auto& acceptor : acceptors_) {
+        if (acceptor->thread.joinable()) acceptor->thread.join();
+    }
+    close_all();
+}
+
+void AcceptorPool::close_all() {
+    for (auto& acceptor : acceptors_) {
+        if (acceptor->listen_fd != -1) {
+            close(acceptor->listen_fd);
+            acceptor->listen_fd = -1;
+        }
+    }
+    if (wake_fd_ != -1) {
+        close(wake_fd_);
+        wake_fd_ = -1;
+    }
+}
+
+void AcceptorPool::accept_loop(size_t index) {
+    Acceptor& acceptor = *acceptors_[index];
+    LOG_INFO("Thread de aceitação " + std::to_string(index) + " iniciada");
+    int flags = SOCK_CLOEXEC | (nonblocking_ ? SOCK_NONBLOCK : 0);
+    std::vector<Accepted> batch;
+    batch.reserve(ACCEPT_BATCH);
+
+    struct pollfd fds[2];
+    fds[0].fd = acceptor.listen_fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = wake_fd_;
+    fds[1].events = POLLIN;
+
+    while (running_.load()) {
+        fds[0].revents = fds[1].revents = 0;
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            LOG_ERROR("Falha no poll do acceptor: " + std::string(strerror(errno)));
+            break;
+        }
+        if (fds[1].revents) break;
+
+        batch.clear();
+        while (batch.size() < ACCEPT_BATCH) {
+            struct sockaddr_in client_addr;
+            socklen_t client_len = sizeof(client_addr);
+            int fd = accept4(acceptor.listen_fd, (struct sockaddr*)&client_addr, &client_len, flags);
+            if (fd < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                errors_.fetch_add(1, std::memory_order_relaxed);
+                LOG_ERROR("Falha no accept: " + std::string(strerror(errno)));
+                // Sem descritores livres o socket continua legível: evita girar em vazio
+                if (errno == EMFILE || errno == ENFILE) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                }
+                break;
+            }
+            char client_ip_str[INET_ADDRSTRLEN];
+            inet_ntop(AF_INET, &client_addr.sin_addr, client_ip_str, INET_ADDRSTRLEN);
+            batch.push_back(Accepted{fd, client_ip_str, ntohl(client_addr.sin_addr.s_addr)});
+        }
+        if (batch.empty()) continue;
+
+        acceptor.accepted.fetch_add(batch.size(), std::memory_order_relaxed);
+        record_batch(batch.size());
+        LOG_DEBUG("Acceptor " + std::to_string(index) + " aceitou " + std::to_string(batch.size()) + " conexões");
+        handler_(batch);
+    }
+    LOG_INFO("Thread de aceitação " + std::to_string(index) + " finalizada.");
+}
+
+void AcceptorPool::record_batch(size_t count) {
+    int64_t second = now_seconds();
+    std::lock_guard<ProfiledMutex> lock(rate_mutex_);
+    if (second != rate_second_) {
+        rate_last_ = second == rate_second_ + 1 ? rate_count_ : 0;
+        if (rate_last_ > rate_peak_) rate_peak_ = rate_last_;
+        rate_second_ = second;
+        rate_count_ = 0;
+    }
+    rate_count_ += count;
+}
+
+AcceptorPool::Stats AcceptorPool::stats() const {
+    Stats stats;
+    stats.accepted = 0;
+    stats.errors = errors_.load(std::memory_order_relaxed);
+    for (const auto& acceptor : acceptors_) {
+        uint64_t accepted = acceptor->accepted.load(std::memory_order_relaxed);
+        stats.per_acceptor.push_back(accepted);
+        stats.accepted += accepted;
+    }
+
+    int64_t second = now_seconds();
+    std::lock_guard<ProfiledMutex> lock(rate_mutex_);
+    // A janela corrente só conta como "último segundo" depois de fechada
+    if (second == rate_second_) stats.last_second = rate_last_;
+    else if (second == rate_second_ + 1) stats.last_second = rate_count_;
+    else stats.last_second = 0;
+    // A janela corrente, se já fechou, ainda não entrou no pico
+    stats.peak_second = std::max(rate_peak_, second > rate_second_ ? rate_count_ : stats.last_second);
+    return stats;
+}
+
+}
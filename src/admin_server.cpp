@@ -0,0 +1,250 @@
+#include "admin_server.h"
+#include "libtslog.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace chat {
+
+namespace {
+bool is_port(const std::string& endpoint) {
+    return !endpoint.empty() &&
+           std::all_of(endpoint.begin(), endpoint.end(), [](unsigned char c) { return std::isdigit(c) != 0; });
+}
+
+bool send_all(int fd, const std::string& data) {
+    size_t offset = 0;
+    while (offset < data.size()) {
+        ssize_t sent = send(fd, data.data() + offset, data.size() - offset, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) return false;
+        offset += static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+std::string http_response(const char* status, const std::string& content_type, const std::string& body,
+                          bool include_body) {
+    std::string out = std::string("HTTP/1.0 ") + status + "\r\nContent-Type: " + content_type +
+                      "\r\nContent-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n";
+    if (include_body) out += body;
+    return out;
+}
+
+// Só apaga o caminho se for um socket que ninguém está a escutar (restos de uma execução anterior)
+bool remove_stale_socket(const std::string& path, const struct sockaddr_un& addr) {
+    struct stat info;
+    if (lstat(path.c_str(), &info) != 0) {
+        if (errno == ENOENT) return true;
+        LOG_ERROR("Não foi possível verificar " + path + ": " + std::string(strerror(errno)));
+        return false;
+    }
+    if (!S_ISSOCK(info.st_mode)) {
+        LOG_ERROR("O caminho de administração " + path + " já existe e não é um socket");
+        return false;
+    }
+    int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (probe < 0) {
+        LOG_ERROR("Falha ao criar socket de verificação: " + std::string(strerror(errno)));
+        return false;
+    }
+    int result = connect(probe, reinterpret_cast<const struct sockaddr*>(&addr), sizeof(addr));
+    int error = errno;
+    close(probe);
+    if (result == 0) {
+        LOG_ERROR("Outro processo já escuta no socket de administração " + path);
+        return false;
+    }
+    if (error != ECONNREFUSED) {
+        LOG_ERROR("Não foi possível verificar o socket " + path + ": " + std::string(strerror(error)));
+        return false;
+    }
+    if (unlink(path.c_str()) != 0 && errno != ENOENT) {
+        LOG_ERROR("Não foi possível remover o socket antigo " + path + ": " + std::string(strerror(errno)));
+        return false;
+    }
+    return true;
+}
+}
+
+AdminServer::AdminServer(const std::string& endpoint)
+    : endpoint_(endpoint), unix_socket_(!is_port(endpoint)), listen_fd_(-1), wake_fd_(-1),
+      socket_dev_(0), socket_ino_(0), running_(false), requests_(0) {}
+
+AdminServer::~AdminServer() {
+    stop();
+}
+
+void AdminServer::route(const std::string& path, const std::string& content_type, Handler handler) {
+    routes_[path] = Route{content_type, std::move(handler)};
+}
+
+int AdminServer::open_listener() {
+    int fd = socket(unix_socket_ ? AF_UNIX : AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        LOG_ERROR("Falha ao criar socket de administração: " + std::string(strerror(errno)));
+        return -1;
+    }
+
+    int result;
+    if (unix_socket_) {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (endpoint_.size() >= sizeof(addr.sun_path)) {
+            LOG_ERROR("Caminho do socket de administração demasiado longo: " + endpoint_);
+            close(fd);
+            return -1;
+        }
+        strncpy(addr.sun_path, endpoint_.c_str(), sizeof(addr.sun_path) - 1);
+        // Um socket deixado por uma execução anterior impediria o bind
+        if (!remove_stale_socket(endpoint_, addr)) {
+            close(fd);
+            return -1;
+        }
+        // Só o dono do processo lê as métricas
+        mode_t previous = umask(0077);
+        result = bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+        umask(previous);
+    } else {
+        int opt = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(static_cast<uint16_t>(std::atoi(endpoint_.c_str())));
+        result = bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+    }
+    if (result < 0 || listen(fd, 16) < 0) {
+        LOG_ERROR("Falha ao abrir o socket de administração " + endpoint_ + ": " + std::string(strerror(errno)));
+        close(fd);
+        return -1;
+    }
+    if (unix_socket_) {
+        // Identidade do ficheiro criado, para o stop() não apagar um socket de outra instância
+        struct stat info;
+        if (lstat(endpoint_.c_str(), &info) == 0) {
+            socket_dev_ = info.st_dev;
+            socket_ino_ = info.st_ino;
+        }
+    }
+    return fd;
+}
+
+bool AdminServer::start() {
+    if (running_.load()) return false;
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd_ < 0) {
+        LOG_ERROR("Falha ao criar eventfd: " + std::string(strerror(errno)));
+        return false;
+    }
+    listen_fd_ = open_listener();
+    if (listen_fd_ < 0) {
+        close(wake_fd_);
+        wake_fd_ = -1;
+        return false;
+    }
+    running_.store(true);
+    thread_ = std::thread(&AdminServer::serve_loop, this);
+    LOG_INFO("Administração a escutar em " + (unix_socket_ ? endpoint_ : "127.0.0.1:" + endpoint_));
+    return true;
+}
+
+void AdminServer::stop() {
+    if (!running_.exchange(false)) return;
+    uint64_t one = 1;
+    ssize_t ignored = write(wake_fd_, &one, sizeof(one));
+    (void)ignored;
+    if (thread_.joinable()) thread_.join();
+    close(listen_fd_);
+    close(wake_fd_);
+    listen_fd_ = -1;
+    wake_fd_ = -1;
+    if (unix_socket_) {
+        struct stat info;
+        if (lstat(endpoint_.c_str(), &info) == 0 && S_ISSOCK(info.st_mode) &&
+            info.st_dev == socket_dev_ && info.st_ino == socket_ino_) {
+            unlink(endpoint_.c_str());
+        }
+        socket_dev_ = 0;
+        socket_ino_ = 0;
+    }
+}
+
+void AdminServer::serve_loop() {
+    struct pollfd fds[2];
+    fds[0].fd = listen_fd_;
+    fds[0].events = POLLIN;
+    fds[1].fd = wake_fd_;
+    fds[1].events = POLLIN;
+    while (running_.load()) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            LOG_ERROR("Falha no poll da administração: " + std::string(strerror(errno)));
+            break;
+        }
+        if (fds[1].revents) break;
+        while (true) {
+            int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd < 0) break;
+            serve(fd);
+            close(fd);
+        }
+    }
+}
+
+void AdminServer::serve(int fd) {
+    // Um cliente parado não pode prender a única thread
+    struct timeval timeout = {1, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    std::string request;
+    char buffer[1024];
+    while (request.size() < MAX_REQUEST_SIZE && request.find("\r\n\r\n") == std::string::npos &&
+           request.find("\n\n") == std::string::npos) {
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        request.append(buffer, static_cast<size_t>(n));
+    }
+    requests_.fetch_add(1, std::memory_order_relaxed);
+
+    // Só a linha de pedido interessa: "GET /caminho?query HTTP/1.1"
+    std::string line = request.substr(0, request.find_first_of("\r\n"));
+    size_t method_end = line.find(' ');
+    std::string method = line.substr(0, method_end);
+    std::string path;
+    if (method_end != std::string::npos) {
+        size_t path_end = line.find(' ', method_end + 1);
+        path = line.substr(method_end + 1, path_end == std::string::npos ? std::string::npos : path_end - method_end - 1);
+        path = path.substr(0, path.find('?'));
+    }
+
+    const std::string text = "text/plain; charset=utf-8";
+    if (method != "GET" && method != "HEAD") {
+        send_all(fd, http_response("405 Method Not Allowed", text, "Só GET e HEAD.\n", true));
+        return;
+    }
+    auto it = routes_.find(path);
+    if (it == routes_.end()) {
+        std::string body = "Caminhos disponíveis:\n";
+        for (const auto& route : routes_) body += "  " + route.first + "\n";
+        send_all(fd, http_response("404 Not Found", text, body, method == "GET"));
+        return;
+    }
+    send_all(fd, http_response("200 OK", it->second.content_type, it->second.handler(), method == "GET"));
+}
+
+}
@@ -0,0 +1,122 @@
+#include "auth_pool.h"
+#include "libtslog.h"
+#include <algorithm>
+
+namespace chat {
+
+AuthPool::AuthPool(int workers, size_t max_queue)
+    : worker_count_(workers), max_queue_(max_queue == 0 ? 1 : max_queue),
+      running_(false), completed_(0), rejected_(0), latency_next_(0) {
+    if (worker_count_ <= 0) {
+        worker_count_ = static_cast<int>(std::thread::hardware_concurrency());
+        if (worker_count_ <= 0) worker_count_ = 1;
+    }
+    latency_us_.reserve(LATENCY_SAMPLES);
+}
+
+AuthPool::~AuthPool() {
+    stop();
+}
+
+void AuthPool::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) return;
+    running_ = true;
+    for (int i = 0; i < worker_count_; ++i) {
+        workers_.emplace_back(&AuthPool::worker_loop, this);
+    }
+}
+
+void AuthPool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) return;
+        running_ = false;
+    }
+    cv_.notify_all();
+    for (auto& worker : workers_) {
+        if (worker.joinable()) worker.join();
+    }
+    workers_.clear();
+}
+
+bool AuthPool::submit(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_ || queue_.size() >= max_queue_) {
+            ++rejected_;
+            return false;
+        }
+        queue_.push_back(Job{std::move(job), Clock::now()});
+    }
+    cv_.notify_one();
+    return true;
+}
+
+void AuthPool::worker_loop() {
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this]{ return !queue_.empty() || !running_; });
+            if (queue_.empty()) return;
+            job = std::move(queue_.front());
+            queue_.pop_front();
+        }
+
+        try {
+            job.fn();
+        } catch (const std::exception& e) {
+            LOG_ERROR(std::string("Exceção no pool de autenticação: ") + e.what());
+        }
+
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - job.enqueued);
+        uint32_t micros = static_cast<uint32_t>(std::min<int64_t>(elapsed.count(), UINT32_MAX));
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++completed_;
+        if (latency_us_.size() < LATENCY_SAMPLES) {
+            latency_us_.push_back(micros);
+        } else {
+            latency_us_[latency_next_] = micros;
+        }
+        latency_next_ = (latency_next_ + 1) % LATENCY_SAMPLES;
+    }
+}
+
+AuthPool::LatencyStats AuthPool::latency() const {
+    std::vector<uint32_t> samples;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        samples = latency_us_;
+    }
+    LatencyStats stats = {samples.size(), 0.0, 0.0, 0.0, 0.0};
+    if (samples.empty()) return stats;
+
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&samples](double p) {
+        size_t index = static_cast<size_t>(p * (samples.size() - 1) + 0.5);
+        return samples[index] / 1000.0;
+    };
+    stats.p50_ms = percentile(0.50);
+    stats.p95_ms = percentile(0.95);
+    stats.p99_ms = percentile(0.99);
+    stats.max_ms = samples.back() / 1000.0;
+    return stats;
+}
+
+uint64_t AuthPool::get_completed() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return completed_;
+}
+
+uint64_t AuthPool::get_rejected() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return rejected_;
+}
+
+size_t AuthPool::get_queue_depth() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queue_.size();
+}
+
+}
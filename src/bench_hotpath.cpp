@@ -0,0 +1,554 @@
+// Microbenchmarks dos caminhos quentes do servidor, com resultados em JSON
+// para comparar execuções (make bench grava bench_results.json).
+//
+// Cada caso corre uma vez para aquecer e depois --repeats vezes; o JSON guarda
+// a mediana, o mínimo e o máximo de ns por operação. As entradas são fixas
+// (texto, nomes e sementes constantes) para que duas execuções meçam o mesmo
+// trabalho. O tempo de preparação (criar clientes, bases de dados, threads)
+// fica fora da medição.
+
+#include "chat_common.h"
+#include "connected_client.h"
+#include "content_filter.h"
+#include "fanout_pool.h"
+#include "libtslog.h"
+#include "profiled_mutex.h"
+#include "read_buffer.h"
+#include "stage_metrics.h"
+#include "thread_safe_queue.h"
+#include "user_database.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+using namespace chat;
+using namespace tslog;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+// Impede o compilador de eliminar o trabalho medido
+volatile size_t g_sink = 0;
+
+double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+struct Options {
+    std::string output = "-";
+    std::string only;
+    int repeats = 5;
+    bool quick = false;
+    size_t users = 1000000;
+};
+
+// Parâmetros de um caso, escritos no JSON como números quando o valor o é
+using Params = std::vector<std::pair<std::string, std::string>>;
+
+struct CaseResult {
+    std::string name;
+    Params params;
+    uint64_t ops;
+    std::vector<double> ns_per_op;
+};
+
+bool is_number(const std::string& value) {
+    return !value.empty() && value.find_first_not_of("0123456789.") == std::string::npos;
+}
+
+class Suite {
+public:
+    explicit Suite(const Options& options) : options_(options) {}
+
+    const Options& options() const { return options_; }
+    // Reduz um tamanho no modo --quick
+    size_t scaled(size_t full) const { return options_.quick ? std::max<size_t>(full / 10, 1) : full; }
+    bool wants(const std::string& group) const {
+        return options_.only.empty() || group.find(options_.only) != std::string::npos;
+    }
+
+    // body executa ops operações e devolve os segundos medidos
+    void run(const std::string& name, const Params& params, uint64_t ops, const std::function<double()>& body,
+             bool warmup = true) {
+        if (!wants(name)) return;
+        if (warmup) body();
+        CaseResult result{name, params, ops, {}};
+        for (int i = 0; i < options_.repeats; ++i) result.ns_per_op.push_back(body() * 1e9 / ops);
+
+        std::string label = name;
+        for (const auto& param : params) label += " " + param.first + "=" + param.second;
+        std::vector<double> sorted = result.ns_per_op;
+        std::sort(sorted.begin(), sorted.end());
+        fprintf(stderr, "  %-48s %12.1f ns/op  (min %.1f, máx %.1f)\n", label.c_str(), median(sorted),
+                sorted.front(), sorted.back());
+        results_.push_back(std::move(result));
+    }
+
+    std::string to_json() const {
+        char buffer[256];
+        std::time_t now = std::time(nullptr);
+        char timestamp[32];
+        std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+        std::string out = "{\n  \"suite\": \"chat-hotpath\",\n";
+        out += std::string("  \"timestamp\": \"") + timestamp + "\",\n";
+        out += std::string("  \"compiler\": \"") + __VERSION__ + "\",\n";
+        out += "  \"hardware_threads\": " + std::to_string(std::thread::hardware_concurrency()) + ",\n";
+        out += std::string("  \"lock_profiling\": ") + (LockProfiler::ENABLED ? "true" : "false") + ",\n";
+        out += std::string("  \"quick\": ") + (options_.quick ? "true" : "false") + ",\n";
+        out += "  \"repeats\": " + std::to_string(options_.repeats) + ",\n";
+        out += "  \"results\": [";
+        for (size_t i = 0; i < results_.size(); ++i) {
+            const CaseResult& result = results_[i];
+            std::vector<double> sorted = result.ns_per_op;
+            std::sort(sorted.begin(), sorted.end());
+            double mid = median(sorted);
+
+            out += i == 0 ? "\n" : ",\n";
+            out += "    {\"name\": \"" + result.name + "\", \"params\": {";
+            for (size_t p = 0; p < result.params.size(); ++p) {
+                const auto& param = result.params[p];
+                out += (p == 0 ? "\"" : ", \"") + param.first + "\": ";
+                out += is_number(param.second) ? param.second : "\"" + param.second + "\"";
+            }
+            snprintf(buffer, sizeof(buffer),
+                     "}, \"ops\": %llu, \"ns_per_op\": {\"median\": %.2f, \"min\": %.2f, \"max\": %.2f}, "
+                     "\"ops_per_sec\": %.0f}",
+                     static_cast<unsigned long long>(result.ops), mid, sorted.front(), sorted.back(),
+                     mid > 0 ? 1e9 / mid : 0.0);
+            out += buffer;
+        }
+        out += "\n  ]\n}\n";
+        return out;
+    }
+
+private:
+    Options options_;
+    std::vector<CaseResult> results_;
+
+    static double median(const std::vector<double>& sorted) {
+        size_t n = sorted.size();
+        return n % 2 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+    }
+};
+
+Message sample_message() {
+    Message msg(MessageType::CHAT_BROADCAST, "alice", std::string(96, 'm'));
+    strncpy(msg.target_user, "bob", MAX_USERNAME_SIZE - 1);
+    return msg;
+}
+
+// --- Message: serialização nos dois protocolos ---
+
+void bench_message(Suite& suite) {
+    const size_t ops = suite.scaled(1000000);
+    const Message msg = sample_message();
+    const std::string text = msg.serialize();
+    std::string binary;
+    msg.serialize_binary(binary);
+
+    suite.run("message.serialize", {{"protocol", "v1"}}, ops, [&] {
+        auto start = Clock::now();
+        for (size_t i = 0; i < ops; ++i) g_sink = g_sink + msg.serialize().size();
+        return seconds_since(start);
+    });
+    suite.run("message.deserialize", {{"protocol", "v1"}}, ops, [&] {
+        auto start = Clock::now();
+        for (size_t i = 0; i < ops; ++i) g_sink = g_sink + Message::deserialize(text).content[0];
+        return seconds_since(start);
+    });
+    suite.run("message.serialize", {{"protocol", "v2"}}, ops, [&] {
+        std::string out;
+        auto start = Clock::now();
+        for (size_t i = 0; i < ops; ++i) {
+            out.clear();
+            msg.serialize_binary(out);
+            g_sink = g_sink + out.size();
+        }
+        return seconds_since(start);
+    });
+    suite.run("message.deserialize", {{"protocol", "v2"}}, ops, [&] {
+        auto start = Clock::now();
+        for (size_t i = 0; i < ops; ++i) g_sink = g_sink + Message::deserialize_binary(binary).content[0];
+        return seconds_since(start);
+    });
+    for (ProtocolVersion version : {ProtocolVersion::V1_TEXT, ProtocolVersion::V2_BINARY}) {
+        suite.run("message.to_wire", {{"protocol", version == ProtocolVersion::V1_TEXT ? "v1" : "v2"}}, ops, [&] {
+            auto start = Clock::now();
+            for (size_t i = 0; i < ops; ++i) g_sink = g_sink + msg.to_wire(version)->size();
+            return seconds_since(start);
+        });
+    }
+}
+
+// --- Utils::read_line sobre um socketpair ---
+
+void bench_read_line(Suite& suite) {
+    const size_t block_lines = 64;
+    const size_t lines = suite.scaled(1000000) / block_lines * block_lines;
+    std::string block;
+    for (size_t i = 0; i < block_lines; ++i) block += sample_message().serialize() + "\n";
+
+    suite.run("utils.read_line", {{"line_bytes", std::to_string(block.size() / block_lines)}}, lines, [&] {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+            perror("socketpair");
+            exit(1);
+        }
+        // O escritor arranca já, mas fica bloqueado até o leitor começar a esvaziar o socket
+        std::thread writer([&] {
+            for (size_t sent = 0; sent < lines; sent += block_lines) {
+                size_t offset = 0;
+                while (offset < block.size()) {
+                    ssize_t n = send(fds[0], block.data() + offset, block.size() - offset, MSG_NOSIGNAL);
+                    if (n <= 0) return;
+                    offset += static_cast<size_t>(n);
+                }
+            }
+            shutdown(fds[0], SHUT_WR);
+        });
+
+        ReadBuffer buffer;
+        std::string_view line;
+        size_t received = 0;
+        auto start = Clock::now();
+        while (Utils::read_line(fds[1], buffer, line)) {
+            g_sink = g_sink + line.size();
+            ++received;
+        }
+        double elapsed = seconds_since(start);
+        writer.join();
+        close(fds[0]);
+        close(fds[1]);
+        if (received != lines) fprintf(stderr, "  aviso: read_line leu %zu de %zu linhas\n", received, lines);
+        return elapsed;
+    });
+}
+
+// --- ThreadSafeQueue: N produtores contra 1 ou N consumidores ---
+
+double run_queue(int producers, int consumers, size_t total, const WireBuffer& item) {
+    ThreadSafeQueue<WireBuffer> queue;
+    size_t per_producer = total / producers;
+    size_t expected = per_producer * producers;
+    std::atomic<bool> go(false);
+    std::atomic<size_t> received(0);
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&] {
+            while (!go.load()) std::this_thread::yield();
+            for (size_t i = 0; i < per_producer; ++i) queue.push(item);
+        });
+    }
+    for (int c = 0; c < consumers; ++c) {
+        threads.emplace_back([&] {
+            while (!go.load()) std::this_thread::yield();
+            while (received.load(std::memory_order_relaxed) < expected) {
+                if (queue.pop_timeout(std::chrono::milliseconds(10)).has_value()) {
+                    received.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        });
+    }
+
+    auto start = Clock::now();
+    go.store(true);
+    for (auto& thread : threads) thread.join();
+    return seconds_since(start);
+}
+
+void bench_queue(Suite& suite) {
+    const size_t total = suite.scaled(1000000);
+    const WireBuffer item = sample_message().to_wire(ProtocolVersion::V1_TEXT);
+    for (int producers : {1, 4, 16, 64}) {
+        for (int consumers : {1, 4}) {
+            size_t ops = total / producers * producers;
+            suite.run("queue.push_pop",
+                      {{"producers", std::to_string(producers)}, {"consumers", std::to_string(consumers)}}, ops,
+                      [&] { return run_queue(producers, consumers, total, item); });
+        }
+    }
+}
+
+// --- Logger::log: débito com 1 a 64 threads, síncrono e assíncrono ---
+
+void bench_logger(Suite& suite, const std::string& dir) {
+    const size_t total = suite.scaled(200000);
+    const std::string path = dir + "/bench.log";
+    const std::string line = "Mensagem de 'alice' entregue a 42 destinatários na sala #geral";
+    Logger& logger = Logger::getInstance();
+
+    for (LogMode mode : {LogMode::SYNC, LogMode::ASYNC}) {
+        for (int threads : {1, 4, 16, 64}) {
+            size_t per_thread = total / threads;
+            Params params = {{"mode", mode == LogMode::SYNC ? "sync" : "async"},
+                             {"threads", std::to_string(threads)}};
+            suite.run("logger.log", params, per_thread * threads, [&] {
+                // Ficheiro novo a cada repetição; BLOCK para que nenhum registo
+                // descartado conte como escrito
+                std::remove(path.c_str());
+                AsyncOptions async;
+                async.overflow = OverflowPolicy::BLOCK;
+                logger.configure(path, LogLevel::INFO, false, true, mode, async);
+
+                std::atomic<bool> go(false);
+                std::vector<std::thread> workers;
+                for (int t = 0; t < threads; ++t) {
+                    workers.emplace_back([&] {
+                        while (!go.load()) std::this_thread::yield();
+                        for (size_t i = 0; i < per_thread; ++i) logger.log(LogLevel::INFO, line);
+                    });
+                }
+                auto start = Clock::now();
+                go.store(true);
+                for (auto& worker : workers) worker.join();
+                logger.flush();
+                double elapsed = seconds_since(start);
+
+                logger.configure("", LogLevel::WARNING, false, false);
+                return elapsed;
+            });
+        }
+    }
+    std::remove(path.c_str());
+}
+
+// --- ContentFilter: lista embutida e lista grande ---
+
+std::vector<std::string> generated_words(size_t count) {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> letter('a', 'z');
+    std::uniform_int_distribution<size_t> length(4, 10);
+    std::vector<std::string> words;
+    for (size_t i = 0; i < count; ++i) {
+        std::string word(length(rng), ' ');
+        for (char& c : word) c = static_cast<char>(letter(rng));
+        words.push_back(word);
+    }
+    return words;
+}
+
+void bench_filter(Suite& suite) {
+    const size_t ops = suite.scaled(1000000);
+    const std::string clean =
+        "Bom dia a todos, alguém já experimentou a nova versão do servidor com o reactor epoll ativo? "
+        "Parece bem mais rápido com muitos clientes ligados ao mesmo tempo.";
+    const ContentFilter filter;
+
+    suite.run("filter.apply", {{"words", "builtin"}, {"text", "clean"}}, ops, [&] {
+        char text[MAX_CONTENT_SIZE];
+        auto start = Clock::now();
+        for (size_t i = 0; i < ops; ++i) {
+            memcpy(text, clean.c_str(), clean.size() + 1);
+            g_sink = g_sink + filter.apply(text);
+        }
+        return seconds_since(start);
+    });
+
+    // A mesma frase com algumas palavras da lista grande semeadas
+    const std::vector<std::string> words = generated_words(10000);
+    const FilterAutomaton automaton(words);
+    const std::string dirty = clean.substr(0, 40) + " " + words[7] + " " + clean.substr(40, 60) + " " +
+                              words[4242] + " " + clean.substr(100);
+    for (const std::string* sample : {&clean, &dirty}) {
+        suite.run("filter.mask", {{"words", std::to_string(words.size())}, {"text", sample == &clean ? "clean" : "dirty"}},
+                  ops, [&] {
+            char text[MAX_CONTENT_SIZE];
+            auto start = Clock::now();
+            for (size_t i = 0; i < ops; ++i) {
+                memcpy(text, sample->data(), sample->size());
+                g_sink = g_sink + automaton.mask(text, sample->size());
+            }
+            return seconds_since(start);
+        });
+    }
+}
+
+// --- UserDatabase: registo e login com muitos utilizadores ---
+
+void bench_userdb(Suite& suite, const std::string& dir) {
+    const size_t users = suite.options().users;
+    std::unique_ptr<UserDatabase> db;
+    auto username = [](size_t i) { return "u" + std::to_string(i); };
+    auto password = [](size_t i) { return "pw" + std::to_string(i); };
+
+    // Cada repetição começa numa base vazia; a última fica para os logins.
+    // Uma iteração de PBKDF2: mede-se a base, não o KDF
+    suite.run("userdb.add", {{"users", std::to_string(users)}, {"kdf_iterations", "1"}}, users, [&] {
+        db.reset();
+        std::filesystem::remove_all(dir + "/db");
+        std::filesystem::create_directories(dir + "/db");
+        db = std::make_unique<UserDatabase>(dir + "/db/users.db", 1);
+        auto start = Clock::now();
+        for (size_t i = 0; i < users; ++i) db->add_user(username(i), password(i));
+        return seconds_since(start);
+    }, false);
+    if (!db) return;
+
+    std::vector<size_t> order(users);
+    for (size_t i = 0; i < users; ++i) order[i] = i;
+    std::shuffle(order.begin(), order.end(), std::mt19937(42));
+
+    for (int threads : {1, 8}) {
+        suite.run("userdb.validate", {{"users", std::to_string(users)}, {"threads", std::to_string(threads)}}, users,
+                  [&] {
+            std::atomic<size_t> failures(0);
+            std::vector<std::thread> workers;
+            auto start = Clock::now();
+            for (int t = 0; t < threads; ++t) {
+                workers.emplace_back([&, t] {
+                    for (size_t i = t; i < users; i += threads) {
+                        if (!db->validate_user(username(order[i]), password(order[i]))) failures.fetch_add(1);
+                    }
+                });
+            }
+            for (auto& worker : workers) worker.join();
+            double elapsed = seconds_since(start);
+            if (failures.load()) fprintf(stderr, "  aviso: %zu logins falharam\n", failures.load());
+            return elapsed;
+        }, false);
+    }
+    db.reset();
+    std::filesystem::remove_all(dir + "/db");
+}
+
+// --- Fan-out de um broadcast para clientes falsos ---
+
+size_t total_depth(const ClientList& clients) {
+    size_t depth = 0;
+    for (const auto& client : clients) depth += client->get_queue_depth();
+    return depth;
+}
+
+// Clientes sem socket, geridos por um "reactor" cujo wake não faz nada: mede-se
+// a codificação e o enfileiramento, não a escrita. Metade fala cada protocolo.
+std::shared_ptr<const ClientList> fake_clients(size_t count, size_t messages) {
+    OutboundLimits limits;
+    limits.max_messages = messages;
+    limits.max_bytes = messages * MAX_CONTENT_SIZE * 2;
+    auto clients = std::make_shared<ClientList>();
+    for (size_t i = 0; i < count; ++i) {
+        auto client = std::make_shared<ConnectedClient>(
+            -1, "c" + std::to_string(i), i % 2 ? ProtocolVersion::V2_BINARY : ProtocolVersion::V1_TEXT, limits);
+        client->attach_to_reactor([] {});
+        clients->push_back(client);
+    }
+    return clients;
+}
+
+void bench_fanout(Suite& suite) {
+    const size_t messages = suite.scaled(1000);
+    const Message msg = sample_message();
+    const int workers = 4;
+
+    for (size_t recipients : {10, 100, 1000}) {
+        for (bool parallel : {false, true}) {
+            Params params = {{"recipients", std::to_string(recipients)},
+                             {"workers", parallel ? std::to_string(workers) : "0"}};
+            suite.run("fanout.deliver", params, messages, [&] {
+                // threshold 0 desliga o pool; 1 manda todos os broadcasts para os workers
+                FanoutPool pool(parallel ? workers : 0, parallel ? 1 : 0);
+                pool.start();
+                auto clients = fake_clients(recipients, messages);
+                size_t expected = recipients * messages;
+
+                auto start = Clock::now();
+                for (size_t i = 0; i < messages; ++i) pool.deliver(clients, msg);
+                while (total_depth(*clients) < expected) std::this_thread::yield();
+                double elapsed = seconds_since(start);
+
+                pool.stop();
+                return elapsed;
+            });
+        }
+    }
+}
+
+void print_usage(const char* program) {
+    std::cout << "Uso: " << program << " [opções]\n"
+              << "  --output <ficheiro>  Grava o JSON no ficheiro (padrão: stdout)\n"
+              << "  --repeats <n>        Repetições medidas por caso (padrão: 5)\n"
+              << "  --quick              Tamanhos dez vezes menores, para verificar a suite\n"
+              << "  --users <n>          Utilizadores na base (padrão: 1000000; 100000 com --quick)\n"
+              << "  --only <texto>       Só os casos cujo nome contém o texto (ex.: logger, fanout)\n";
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    bool users_set = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--output" && i + 1 < argc) {
+            options.output = argv[++i];
+        } else if (arg == "--repeats" && i + 1 < argc) {
+            options.repeats = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--quick") {
+            options.quick = true;
+        } else if (arg == "--users" && i + 1 < argc) {
+            options.users = std::max<size_t>(1, std::strtoull(argv[++i], nullptr, 10));
+            users_set = true;
+        } else if (arg == "--only" && i + 1 < argc) {
+            options.only = argv[++i];
+        } else {
+            print_usage(argv[0]);
+            return arg == "--help" || arg == "-h" ? 0 : 1;
+        }
+    }
+    if (options.quick && !users_set) options.users /= 10;
+
+    char dir_template[] = "/tmp/chat_bench_XXXXXX";
+    if (!mkdtemp(dir_template)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    const std::string dir = dir_template;
+
+    // Sem consola nem ficheiro, e sem as métricas de estágio: mede-se só a primitiva
+    Logger::getInstance().configure("", LogLevel::WARNING, false, false);
+    StageMetrics::set_enabled(false);
+
+    Suite suite(options);
+    fprintf(stderr, "=== MICROBENCHMARKS DOS CAMINHOS QUENTES (%d repetições%s) ===\n", options.repeats,
+            options.quick ? ", modo rápido" : "");
+    bench_message(suite);
+    bench_read_line(suite);
+    bench_queue(suite);
+    bench_logger(suite, dir);
+    bench_filter(suite);
+    bench_userdb(suite, dir);
+    bench_fanout(suite);
+    std::filesystem::remove_all(dir);
+
+    std::string json = suite.to_json();
+    if (options.output == "-") {
+        std::cout << json;
+    } else {
+        std::ofstream file(options.output);
+        file << json;
+        if (!file) {
+            std::cerr << "Falha ao gravar " << options.output << "\n";
+            return 1;
+        }
+        fprintf(stderr, "Resultados gravados em %s\n", options.output.c_str());
+    }
+    return 0;
+}
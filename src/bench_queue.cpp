@@ -0,0 +1,93 @@
+// Microbenchmark: ThreadSafeQueue (mutex + condition_variable) vs MpscQueue
+// (anel sem locks + eventfd) com 1, 8 e 64 produtores e um consumidor,
+// usando o mesmo tipo de item que as filas de saída do servidor.
+
+#include "thread_safe_queue.h"
+#include "mpsc_queue.h"
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+
+using Item = std::shared_ptr<const std::string>;
+using Clock = std::chrono::steady_clock;
+
+const size_t TOTAL_ITEMS = 2000000;
+const size_t MPSC_CAPACITY = 4096;
+
+double bench_thread_safe_queue(int producers, const Item& item) {
+    ThreadSafeQueue<Item> queue;
+    size_t per_producer = TOTAL_ITEMS / producers;
+    size_t expected = per_producer * producers;
+    std::atomic<bool> go(false);
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&]{
+            while (!go.load()) std::this_thread::yield();
+            for (size_t i = 0; i < per_producer; ++i) queue.push(item);
+        });
+    }
+
+    auto start = Clock::now();
+    go.store(true);
+    size_t received = 0;
+    while (received < expected) {
+        if (queue.pop_timeout(std::chrono::milliseconds(100)).has_value()) ++received;
+    }
+    auto elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    for (auto& t : threads) t.join();
+    return expected / elapsed;
+}
+
+double bench_mpsc_queue(int producers, const Item& item) {
+    MpscQueue<Item> queue(MPSC_CAPACITY);
+    size_t per_producer = TOTAL_ITEMS / producers;
+    size_t expected = per_producer * producers;
+    std::atomic<bool> go(false);
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&]{
+            while (!go.load()) std::this_thread::yield();
+            for (size_t i = 0; i < per_producer; ++i) {
+                Item copy = item;
+                while (!queue.push(std::move(copy))) std::this_thread::yield();
+            }
+        });
+    }
+
+    auto start = Clock::now();
+    go.store(true);
+    size_t received = 0;
+    while (received < expected) {
+        queue.wait(100);
+        received += queue.pop_all([](Item&&) {});
+    }
+    auto elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    for (auto& t : threads) t.join();
+    return expected / elapsed;
+}
+
+int main() {
+    Item item = std::make_shared<const std::string>(std::string(128, 'x'));
+
+    std::cout << "=== BENCHMARK DE FILAS (" << TOTAL_ITEMS << " itens, 1 consumidor) ===\n";
+    std::cout << std::left << std::setw(12) << "produtores"
+              << std::setw(26) << "ThreadSafeQueue (op/s)"
+              << std::setw(26) << "MpscQueue (op/s)" << "ganho\n";
+
+    for (int producers : {1, 8, 64}) {
+        double locked = bench_thread_safe_queue(producers, item);
+        double lock_free = bench_mpsc_queue(producers, item);
+        std::cout << std::left << std::setw(12) << producers
+                  << std::setw(26) << std::fixed << std::setprecision(0) << locked
+                  << std::setw(26) << lock_free
+                  << std::setprecision(2) << (lock_free / locked) << "x\n";
+    }
+    return 0;
+}
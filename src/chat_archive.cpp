@@ -0,0 +1,356 @@
+#include "chat_archive.h"
+#include "libtslog.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace chat {
+
+namespace {
+void put_u16(char* p, uint16_t v) { for (int i = 0; i < 2; ++i) p[i] = static_cast<char>(v >> (8 * i)); }
+void put_u32(char* p, uint32_t v) { for (int i = 0; i < 4; ++i) p[i] = static_cast<char>(v >> (8 * i)); }
+void put_u64(char* p, uint64_t v) { for (int i = 0; i < 8; ++i) p[i] = static_cast<char>(v >> (8 * i)); }
+
+uint64_t get_le(const char* p, int bytes) {
+    uint64_t v = 0;
+    for (int i = bytes - 1; i >= 0; --i) v = (v << 8) | static_cast<uint8_t>(p[i]);
+    return v;
+}
+
+uint64_t now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Segmento mapeado só para leitura durante um scan
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) : data_(nullptr), size_(0) {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1) return;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map != MAP_FAILED) {
+                data_ = static_cast<const char*>(map);
+                size_ = static_cast<size_t>(st.st_size);
+            }
+        }
+        close(fd);
+    }
+    ~MappedFile() {
+        if (data_) munmap(const_cast<char*>(data_), size_);
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const char* data_;
+    size_t size_;
+};
+
+// Lê o registo em offset; retorna o tamanho ou 0 no fim dos dados/registo inválido
+size_t parse_record(const char* data, size_t size, size_t offset, ArchiveRecord& record) {
+    if (offset + ARCHIVE_RECORD_HEADER_SIZE > size) return 0;
+    const char* p = data + offset;
+    size_t length = static_cast<size_t>(get_le(p, 4));
+    if (length < ARCHIVE_RECORD_HEADER_SIZE || offset + length > size) return 0;
+
+    size_t user_len = static_cast<uint8_t>(p[21]);
+    size_t target_len = static_cast<uint8_t>(p[22]);
+    size_t content_len = static_cast<size_t>(get_le(p + 24, 2));
+    if (ARCHIVE_RECORD_HEADER_SIZE + user_len + target_len + content_len != length) return 0;
+
+    record.seq = get_le(p + 4, 8);
+    record.timestamp_us = get_le(p + 12, 8);
+    record.type = static_cast<MessageType>(p[20]);
+    const char* field = p + ARCHIVE_RECORD_HEADER_SIZE;
+    record.username = std::string_view(field, user_len);
+    record.target = std::string_view(field + user_len, target_len);
+    record.content = std::string_view(field + user_len + target_len, content_len);
+    return length;
+}
+}
+
+// --- ESCRITOR ---
+
+ChatArchive::ChatArchive(const ArchiveOptions& options)
+    : options_(options), queue_(options.queue_capacity), running_(false), written_(0), dropped_(0),
+      recovered_seq_(0), segment_fd_(-1), index_fd_(-1), map_(nullptr), write_offset_(0), last_seq_(0),
+      segment_seq_(0), segment_records_(0) {
+    if (options_.index_interval == 0) options_.index_interval = 1;
+}
+
+ChatArchive::~ChatArchive() {
+    stop();
+}
+
+bool ChatArchive::start() {
+    if (running_.load()) return false;
+    if (mkdir(options_.directory.c_str(), 0755) != 0 && errno != EEXIST) {
+        LOG_ERROR("Não foi possível criar o diretório do arquivo '" + options_.directory + "': " + strerror(errno));
+        return false;
+    }
+    // Cada arranque começa um segmento novo, com nome acima do último seq e do último segmento
+    ArchiveReader reader(options_.directory);
+    std::vector<uint64_t> existing = reader.segments();
+    last_seq_ = recovered_seq_ = reader.last_seq();
+    if (!open_segment(std::max(last_seq_, existing.empty() ? 0 : existing.back()) + 1)) return false;
+
+    running_.store(true);
+    writer_ = std::thread(&ChatArchive::writer_loop, this);
+    LOG_INFO("Arquivo de mensagens em '" + options_.directory + "' a partir do seq " + std::to_string(last_seq_ + 1));
+    return true;
+}
+
+void ChatArchive::stop() {
+    if (!running_.exchange(false)) return;
+    queue_.shutdown();
+    if (writer_.joinable()) writer_.join();
+}
+
+bool ChatArchive::append(const Message& msg) {
+    if (!running_.load(std::memory_order_relaxed)) return false;
+    Entry entry;
+    entry.msg = msg;
+    entry.timestamp_us = now_us();
+    if (!queue_.push(std::move(entry))) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+void ChatArchive::writer_loop() {
+    auto write = [this](Entry&& entry) { write_record(entry); };
+    while (running_.load()) {
+        queue_.wait(100);
+        if (queue_.pop_all(write) > 0) flush_index();
+    }
+    // Esvazia o que ficou na fila depois do shutdown
+    queue_.pop_all(write);
+    close_segment();
+}
+
+bool ChatArchive::open_segment(uint64_t first_seq) {
+    segment_seq_ = first_seq;
+    std::string path = ArchiveReader::segment_path(options_.directory, segment_seq_);
+    segment_fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (segment_fd_ == -1 || ftruncate(segment_fd_, static_cast<off_t>(options_.segment_size)) != 0) {
+        LOG_ERROR("Não foi possível criar o segmento '" + path + "': " + strerror(errno));
+        if (segment_fd_ != -1) { close(segment_fd_); segment_fd_ = -1; }
+        return false;
+    }
+    void* map = mmap(nullptr, options_.segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, segment_fd_, 0);
+    if (map == MAP_FAILED) {
+        LOG_ERROR("Falha no mmap do segmento '" + path + "': " + strerror(errno));
+        close(segment_fd_);
+        segment_fd_ = -1;
+        return false;
+    }
+    map_ = static_cast<char*>(map);
+    memcpy(map_, ARCHIVE_SEGMENT_MAGIC, sizeof(ARCHIVE_SEGMENT_MAGIC));
+    put_u64(map_ + 8, segment_seq_);
+    write_offset_ = ARCHIVE_SEGMENT_HEADER_SIZE;
+    segment_records_ = 0;
+
+    std::string index = ArchiveReader::index_path(options_.directory, segment_seq_);
+    index_fd_ = open(index.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    return true;
+}
+
+void ChatArchive::close_segment() {
+    flush_index();
+    if (map_) {
+        msync(map_, write_offset_, MS_SYNC);
+        munmap(map_, options_.segment_size);
+        map_ = nullptr;
+    }
+    if (segment_fd_ != -1) {
+        // Devolve ao sistema de ficheiros o espaço não usado do segmento
+        if (ftruncate(segment_fd_, static_cast<off_t>(write_offset_)) != 0) {
+            LOG_WARNING(std::string("Falha ao truncar segmento do arquivo: ") + strerror(errno));
+        }
+        close(segment_fd_);
+        segment_fd_ = -1;
+    }
+    if (index_fd_ != -1) {
+        close(index_fd_);
+        index_fd_ = -1;
+    }
+}
+
+bool ChatArchive::write_record(const Entry& entry) {
+    const Message& msg = entry.msg;
+    size_t user_len = strnlen(msg.username, MAX_USERNAME_SIZE - 1);
+    size_t target_len = strnlen(msg.target_user, MAX_USERNAME_SIZE - 1);
+    size_t content_len = strnlen(msg.content, MAX_CONTENT_SIZE - 1);
+    size_t length = ARCHIVE_RECORD_HEADER_SIZE + user_len + target_len + content_len;
+
+    // Os broadcasts chegam por ordem de seq; os outros herdam o do registo anterior
+    uint64_t seq = std::max(msg.seq, last_seq_);
+    if (map_ && write_offset_ + length > options_.segment_size) {
+        close_segment();
+        // Um segmento só com privados repetiria o nome do anterior
+        open_segment(std::max(seq, segment_seq_ + 1));
+    }
+    if (!map_) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    last_seq_ = seq;
+    if (segment_records_++ % options_.index_interval == 0) {
+        char index_entry[ARCHIVE_INDEX_ENTRY_SIZE];
+        put_u64(index_entry, seq);
+        put_u64(index_entry + 8, entry.timestamp_us);
+        put_u64(index_entry + 16, write_offset_);
+        index_batch_.append(index_entry, sizeof(index_entry));
+    }
+
+    char* p = map_ + write_offset_;
+    put_u32(p, static_cast<uint32_t>(length));
+    put_u64(p + 4, seq);
+    put_u64(p + 12, entry.timestamp_us);
+    p[20] = static_cast<char>(msg.type);
+    p[21] = static_cast<char>(user_len);
+    p[22] = static_cast<char>(target_len);
+    p[23] = 0;
+    put_u16(p + 24, static_cast<uint16_t>(content_len));
+    p += ARCHIVE_RECORD_HEADER_SIZE;
+    memcpy(p, msg.username, user_len);        p += user_len;
+    memcpy(p, msg.target_user, target_len);   p += target_len;
+    memcpy(p, msg.content, content_len);
+
+    write_offset_ += length;
+    written_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void ChatArchive::flush_index() {
+    if (index_batch_.empty()) return;
+    if (index_fd_ != -1) {
+        ssize_t ignored = write(index_fd_, index_batch_.data(), index_batch_.size());
+        (void)ignored;
+    }
+    index_batch_.clear();
+}
+
+// --- LEITOR ---
+
+ArchiveReader::ArchiveReader(const std::string& directory) : directory_(directory) {}
+
+std::string ArchiveReader::segment_path(const std::string& directory, uint64_t first_seq) {
+    char name[32];
+    snprintf(name, sizeof(name), "%020llu.seg", static_cast<unsigned long long>(first_seq));
+    return directory + "/" + name;
+}
+
+std::string ArchiveReader::index_path(const std::string& directory, uint64_t first_seq) {
+    char name[32];
+    snprintf(name, sizeof(name), "%020llu.idx", static_cast<unsigned long long>(first_seq));
+    return directory + "/" + name;
+}
+
+std::vector<uint64_t> ArchiveReader::segments() const {
+    std::vector<uint64_t> result;
+    DIR* dir = opendir(directory_.c_str());
+    if (!dir) return result;
+    while (struct dirent* entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name.size() == 24 && name.compare(20, 4, ".seg") == 0 &&
+            std::all_of(name.begin(), name.begin() + 20, ::isdigit)) {
+            result.push_back(std::stoull(name.substr(0, 20)));
+        }
+    }
+    closedir(dir);
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+uint64_t ArchiveReader::last_seq() const {
+    std::vector<uint64_t> all = segments();
+    // Percorre do fim: o último segmento pode estar vazio se o servidor parou logo
+    for (auto it = all.rbegin(); it != all.rend(); ++it) {
+        uint64_t last = 0;
+        MappedFile file(segment_path(directory_, *it));
+        if (!file.data()) continue;
+        ArchiveRecord record;
+        size_t offset = seek_offset(*it, UINT64_MAX, UINT64_MAX);
+        while (size_t length = parse_record(file.data(), file.size(), offset, record)) {
+            last = record.seq;
+            offset += length;
+        }
+        if (last != 0) return last;
+    }
+    return 0;
+}
+
+bool ArchiveReader::first_timestamp(uint64_t first_seq, uint64_t& timestamp_us) const {
+    MappedFile index(index_path(directory_, first_seq));
+    if (!index.data() || index.size() < ARCHIVE_INDEX_ENTRY_SIZE) return false;
+    timestamp_us = get_le(index.data() + 8, 8);
+    return true;
+}
+
+size_t ArchiveReader::seek_offset(uint64_t first_seq, uint64_t from_seq, uint64_t from_time_us) const {
+    size_t offset = ARCHIVE_SEGMENT_HEADER_SIZE;
+    if (from_seq == 0 && from_time_us == 0) return offset;
+    MappedFile index(index_path(directory_, first_seq));
+    if (!index.data()) return offset;
+    // Última entrada do índice estritamente abaixo dos limites pedidos (0 = sem
+    // limite): com seqs repetidos, registos iguais ao limite podem estar antes dela
+    for (size_t pos = 0; pos + ARCHIVE_INDEX_ENTRY_SIZE <= index.size(); pos += ARCHIVE_INDEX_ENTRY_SIZE) {
+        const char* entry = index.data() + pos;
+        if ((from_seq != 0 && get_le(entry, 8) >= from_seq) ||
+            (from_time_us != 0 && get_le(entry + 8, 8) >= from_time_us)) {
+            break;
+        }
+        offset = static_cast<size_t>(get_le(entry + 16, 8));
+    }
+    return offset;
+}
+
+size_t ArchiveReader::scan(uint64_t from_seq, uint64_t from_time_us,
+                           const std::function<bool(const ArchiveRecord&)>& fn) const {
+    std::vector<uint64_t> all = segments();
+    // Começa no último segmento que começa estritamente abaixo dos limites: os
+    // anteriores só têm registos menores (0 = sem limite)
+    size_t start = 0;
+    for (size_t i = 0; (from_seq != 0 || from_time_us != 0) && i < all.size(); ++i) {
+        uint64_t first_ts = 0;
+        bool ts_known = first_timestamp(all[i], first_ts);
+        if ((from_seq == 0 || all[i] < from_seq) && (from_time_us == 0 || (ts_known && first_ts < from_time_us))) {
+            start = i;
+        }
+    }
+
+    size_t visited = 0;
+    for (size_t i = start; i < all.size(); ++i) {
+        MappedFile file(segment_path(directory_, all[i]));
+        if (!file.data() || file.size() < ARCHIVE_SEGMENT_HEADER_SIZE ||
+            memcmp(file.data(), ARCHIVE_SEGMENT_MAGIC, sizeof(ARCHIVE_SEGMENT_MAGIC)) != 0) {
+            continue;
+        }
+        size_t offset = i == start ? seek_offset(all[i], from_seq, from_time_us) : ARCHIVE_SEGMENT_HEADER_SIZE;
+        ArchiveRecord record;
+        while (size_t length = parse_record(file.data(), file.size(), offset, record)) {
+            offset += length;
+            if (record.seq < from_seq || record.timestamp_us < from_time_us) continue;
+            ++visited;
+            if (!fn(record)) return visited;
+        }
+    }
+    return visited;
+}
+
+}
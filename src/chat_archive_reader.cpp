@@ -0,0 +1,96 @@
+// Leitor offline do arquivo de mensagens gravado pelo servidor com --archive.
+// Lê os segmentos diretamente (mmap só de leitura), sem passar pelo servidor.
+
+#include "chat_archive.h"
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <string>
+
+using namespace chat;
+
+namespace {
+void print_usage(const char* program) {
+    std::cout << "Uso: " << program << " --dir DIR [--from-seq N] [--from-time T] [--limit N]\n"
+              << "  T em segundos desde a época ou \"AAAA-MM-DD HH:MM:SS\" (hora local)\n";
+}
+
+// Retorna 0 se o texto não for uma data válida
+uint64_t parse_time_us(const std::string& text) {
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    const char* end = strptime(text.c_str(), "%Y-%m-%d %H:%M:%S", &tm);
+    if (end && *end == '\0') {
+        tm.tm_isdst = -1;
+        time_t seconds = mktime(&tm);
+        return seconds < 0 ? 0 : static_cast<uint64_t>(seconds) * 1000000;
+    }
+    char* num_end = nullptr;
+    unsigned long long seconds = strtoull(text.c_str(), &num_end, 10);
+    if (num_end == text.c_str() || *num_end != '\0') return 0;
+    return static_cast<uint64_t>(seconds) * 1000000;
+}
+
+std::string format_time(uint64_t timestamp_us) {
+    time_t seconds = static_cast<time_t>(timestamp_us / 1000000);
+    struct tm tm;
+    localtime_r(&seconds, &tm);
+    char buffer[32];
+    strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &tm);
+    char millis[8];
+    snprintf(millis, sizeof(millis), ".%03llu", static_cast<unsigned long long>(timestamp_us / 1000 % 1000));
+    return std::string(buffer) + millis;
+}
+}
+
+int main(int argc, char* argv[]) {
+    std::string directory;
+    uint64_t from_seq = 0;
+    uint64_t from_time_us = 0;
+    size_t limit = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--dir") == 0 && i + 1 < argc) {
+            directory = argv[++i];
+        } else if (strcmp(argv[i], "--from-seq") == 0 && i + 1 < argc) {
+            from_seq = std::strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--from-time") == 0 && i + 1 < argc) {
+            from_time_us = parse_time_us(argv[++i]);
+            if (from_time_us == 0) {
+                std::cerr << "Data inválida: " << argv[i] << "\n";
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--limit") == 0 && i + 1 < argc) {
+            limit = static_cast<size_t>(std::atol(argv[++i]));
+        } else {
+            print_usage(argv[0]);
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+    if (directory.empty()) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    ArchiveReader reader(directory);
+    if (reader.segments().empty()) {
+        std::cerr << "Nenhum segmento encontrado em '" << directory << "'\n";
+        return 1;
+    }
+
+    size_t printed = 0;
+    reader.scan(from_seq, from_time_us, [&](const ArchiveRecord& record) {
+        std::cout << record.seq << "\t" << format_time(record.timestamp_us) << "\t";
+        if (record.type == MessageType::PRIVATE_MESSAGE) {
+            std::cout << record.username << " -> " << record.target;
+        } else if (record.type == MessageType::ROOM_MESSAGE) {
+            std::cout << record.username << " #" << record.target;
+        } else {
+            std::cout << record.username;
+        }
+        std::cout << "\t" << record.content << "\n";
+        return limit == 0 || ++printed < limit;
+    });
+    return 0;
+}
@@ -35,6 +35,9 @@ void print_banner() {
 void print_chat_help() {
     std::cout << "\n💡 COMANDOS ESPECIAIS:\n";
     std::cout << "  /privado <nome> <mensagem> - Envia mensagem privada\n";
+    std::cout << "  /entrar <sala>             - Entrar numa sala\n";
+    std::cout << "  /sair <sala>               - Sair de uma sala\n";
+    std::cout << "  /sala <sala> <mensagem>    - Envia mensagem só para a sala\n";
     std::cout << "  /quit                      - Sair do chat\n";
     std::cout << "  /cls                       - Limpar tela\n";
     std::cout << "\n📝 Para enviar mensagem pública, apenas digite e pressione ENTER\n" << std::endl;
@@ -46,9 +49,9 @@ void run_chat_session(SimpleChatClient& client) {
     print_chat_help();
 
     std::string input;
-    while (client.is_authenticated()) {
+    while (client.is_connected()) {
         std::cout << "> ";
-        if (!std::getline(std::cin, input) || !client.is_authenticated()) {
+        if (!std::getline(std::cin, input) || !client.is_connected()) {
             break;
         }
 
@@ -65,6 +68,28 @@ void run_chat_session(SimpleChatClient& client) {
             } else {
                 std::cout << "Uso: /privado <nome> <mensagem>\n";
             }
+        } else if (input.rfind("/entrar ", 0) == 0 || input.rfind("/sair ", 0) == 0) {
+            std::stringstream ss(input);
+            std::string command, room;
+            ss >> command >> room;
+            if (room.empty()) {
+                std::cout << "Uso: " << command << " <sala>\n";
+            } else if (command == "/entrar") {
+                client.join_room(room);
+            } else {
+                client.leave_room(room);
+            }
+        } else if (input.rfind("/sala ", 0) == 0) {
+            std::stringstream ss(input);
+            std::string command, room;
+            ss >> command >> room;
+            std::string message;
+            std::getline(ss, message);
+            if (!room.empty() && !message.empty()) {
+                client.send_room(room, message.substr(1));
+            } else {
+                std::cout << "Uso: /sala <sala> <mensagem>\n";
+            }
         } else if (input == "/quit") {
             break;
         } else if (input == "/cls") {
@@ -96,7 +121,7 @@ void run_auto_mode(SimpleChatClient& client, int num_messages) {
     std::uniform_int_distribution<> msg_dist(0, messages.size() - 1);
     std::uniform_int_distribution<> delay_dist(500, 2000); // 0.5 a 2 segundos
     
-    for (int i = 0; i < num_messages && client.is_authenticated(); ++i) {
+    for (int i = 0; i < num_messages && client.is_connected(); ++i) {
         std::string msg = messages[msg_dist(gen)];
         client.send_broadcast(msg);
         std::cout << "Enviada: " << msg << std::endl;
@@ -122,6 +147,8 @@ int main(int argc, char* argv[]) {
     std::string username;
     int auto_messages = 0;
     bool auto_mode = false;
+    ProtocolVersion protocol = ProtocolVersion::V2_BINARY;
+    bool auto_reconnect = true;
 
     // Parse argumentos
     for (int i = 1; i < argc; ++i) {
@@ -134,12 +161,18 @@ int main(int argc, char* argv[]) {
         } else if ((strcmp(argv[i], "--auto") == 0 || strcmp(argv[i], "-a") == 0) && i + 1 < argc) {
             auto_messages = std::atoi(argv[++i]);
             auto_mode = true;
+        } else if (strcmp(argv[i], "--protocol") == 0 && i + 1 < argc) {
+            protocol = std::atoi(argv[++i]) == 1 ? ProtocolVersion::V1_TEXT : ProtocolVersion::V2_BINARY;
+        } else if (strcmp(argv[i], "--no-reconnect") == 0) {
+            auto_reconnect = false;
         }
     }
 
     // Modo automático (para testes)
     if (auto_mode && !username.empty()) {
         SimpleChatClient client(server_addr, port);
+        client.set_protocol(protocol);
+        client.set_auto_reconnect(auto_reconnect);
         
         // Tentar registrar primeiro, se falhar, fazer login
         std::string password = "senha123";
@@ -162,6 +195,8 @@ int main(int argc, char* argv[]) {
     // Modo interativo
     while (true) {
         SimpleChatClient client(server_addr, port);
+        client.set_protocol(protocol);
+        client.set_auto_reconnect(auto_reconnect);
 
         print_banner();
         std::cout << "--- MENU PRINCIPAL ---\n";
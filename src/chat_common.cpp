@@ -1,12 +1,16 @@
 #include "chat_common.h"
 #include "libtslog.h"
+#include "read_buffer.h"
+#include <cerrno>
+#include <stdexcept>
+#include <sys/random.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
 namespace chat {
 
 // Construtores
-Message::Message() {
+Message::Message() : type(MessageType::ERROR_MSG), seq(0), received_ns(0) {
     memset(username, 0, sizeof(username));
     memset(password, 0, sizeof(password));
     memset(target_user, 0, sizeof(target_user));
@@ -23,18 +27,24 @@ Message::Message(MessageType msg_type, const std::string& user, const std::strin
 std::string Message::serialize() const {
     const char DELIMITER = '|';
     std::stringstream ss;
-    ss << static_cast<int>(type) << DELIMITER << username << DELIMITER
+    ss << static_cast<int>(type);
+    if (seq != 0) ss << ':' << seq;
+    ss << DELIMITER << username << DELIMITER
        << password << DELIMITER << target_user << DELIMITER << content;
     return ss.str();
 }
 
-Message Message::deserialize(const std::string& data) {
+Message Message::deserialize(std::string_view data) {
     Message msg;
-    std::stringstream ss(data);
+    std::stringstream ss{std::string(data)};
     std::string temp;
     const char DELIMITER = '|';
     try {
-        if (std::getline(ss, temp, DELIMITER)) msg.type = static_cast<MessageType>(std::stoi(temp));
+        if (std::getline(ss, temp, DELIMITER)) {
+            size_t parsed = 0;
+            msg.type = static_cast<MessageType>(std::stoi(temp, &parsed));
+            if (parsed < temp.size() && temp[parsed] == ':') msg.seq = std::stoull(temp.substr(parsed + 1));
+        }
         if (std::getline(ss, temp, DELIMITER)) strncpy(msg.username, temp.c_str(), MAX_USERNAME_SIZE - 1);
         if (std::getline(ss, temp, DELIMITER)) strncpy(msg.password, temp.c_str(), MAX_PASSWORD_SIZE - 1);
         if (std::getline(ss, temp, DELIMITER)) strncpy(msg.target_user, temp.c_str(), MAX_USERNAME_SIZE - 1);
@@ -45,21 +55,121 @@ Message Message::deserialize(const std::string& data) {
     return msg;
 }
 
+void Message::serialize_binary(std::string& out) const {
+    size_t user_len = strnlen(username, MAX_USERNAME_SIZE - 1);
+    size_t pass_len = strnlen(password, MAX_PASSWORD_SIZE - 1);
+    size_t target_len = strnlen(target_user, MAX_USERNAME_SIZE - 1);
+    size_t content_len = strnlen(content, MAX_CONTENT_SIZE - 1);
+
+    size_t seq_len = seq != 0 ? PROTOCOL_V2_SEQ_SIZE : 0;
+    size_t start = out.size();
+    out.resize(start + PROTOCOL_V2_HEADER_SIZE + seq_len + user_len + pass_len + target_len + content_len);
+    char* p = &out[start];
+    p[0] = static_cast<char>(PROTOCOL_V2_MAGIC);
+    p[1] = static_cast<char>(type);
+    p[2] = static_cast<char>(seq != 0 ? PROTOCOL_V2_FLAG_SEQ : 0);
+    p[3] = static_cast<char>(user_len);
+    p[4] = static_cast<char>(pass_len);
+    p[5] = static_cast<char>(target_len);
+    p[6] = static_cast<char>((content_len >> 8) & 0xFF);
+    p[7] = static_cast<char>(content_len & 0xFF);
+    p += PROTOCOL_V2_HEADER_SIZE;
+    for (size_t i = 0; i < seq_len; ++i) p[i] = static_cast<char>(seq >> (56 - 8 * i));
+    p += seq_len;
+    memcpy(p, username, user_len);      p += user_len;
+    memcpy(p, password, pass_len);      p += pass_len;
+    memcpy(p, target_user, target_len); p += target_len;
+    memcpy(p, content, content_len);
+}
+
+Message Message::deserialize_binary(std::string_view frame) {
+    Message msg;
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(frame.data());
+    if (frame.size() < PROTOCOL_V2_HEADER_SIZE || p[0] != PROTOCOL_V2_MAGIC) {
+        msg.type = MessageType::ERROR_MSG;
+        return msg;
+    }
+    size_t seq_len = (p[2] & PROTOCOL_V2_FLAG_SEQ) ? PROTOCOL_V2_SEQ_SIZE : 0;
+    size_t user_len = p[3], pass_len = p[4], target_len = p[5];
+    size_t content_len = (static_cast<size_t>(p[6]) << 8) | p[7];
+    if (frame.size() != PROTOCOL_V2_HEADER_SIZE + seq_len + user_len + pass_len + target_len + content_len) {
+        msg.type = MessageType::ERROR_MSG;
+        return msg;
+    }
+
+    msg.type = static_cast<MessageType>(p[1]);
+    for (size_t i = 0; i < seq_len; ++i) msg.seq = (msg.seq << 8) | p[PROTOCOL_V2_HEADER_SIZE + i];
+    const char* field = frame.data() + PROTOCOL_V2_HEADER_SIZE + seq_len;
+    memcpy(msg.username, field, std::min<size_t>(user_len, MAX_USERNAME_SIZE - 1));        field += user_len;
+    memcpy(msg.password, field, std::min<size_t>(pass_len, MAX_PASSWORD_SIZE - 1));        field += pass_len;
+    memcpy(msg.target_user, field, std::min<size_t>(target_len, MAX_USERNAME_SIZE - 1));   field += target_len;
+    memcpy(msg.content, field, std::min<size_t>(content_len, MAX_CONTENT_SIZE - 1));
+    return msg;
+}
+
+WireBuffer Message::to_wire(ProtocolVersion version) const {
+    std::string data;
+    if (version == ProtocolVersion::V2_BINARY) {
+        data.reserve(PROTOCOL_V2_HEADER_SIZE + PROTOCOL_V2_SEQ_SIZE + MAX_USERNAME_SIZE * 3 + MAX_CONTENT_SIZE);
+        serialize_binary(data);
+    } else {
+        data = serialize();
+        data += '\n';
+    }
+    return std::make_shared<const std::string>(std::move(data));
+}
+
+Message Message::decode(std::string_view frame, ProtocolVersion version) {
+    return version == ProtocolVersion::V2_BINARY ? deserialize_binary(frame) : deserialize(frame);
+}
+
+const WireBuffer& WireCache::get(ProtocolVersion version) {
+    WireBuffer& slot = version == ProtocolVersion::V2_BINARY ? v2_ : v1_;
+    if (!slot) slot = msg_.to_wire(version);
+    return slot;
+}
+
 // --- CLASSE DE UTILITÁRIOS ---
 
-std::string Utils::read_line(int socket_fd, std::string& buffer) {
-    char read_char;
-    while (true) {
-        size_t pos = buffer.find('\n');
-        if (pos != std::string::npos) {
-            std::string line = buffer.substr(0, pos);
-            buffer.erase(0, pos + 1);
-            return line;
-        }
-        ssize_t bytes_read = recv(socket_fd, &read_char, 1, 0);
-        if (bytes_read <= 0) return "";
-        buffer += read_char;
+bool Utils::read_line(int socket_fd, ReadBuffer& buffer, std::string_view& line) {
+    while (!buffer.next_line(line)) {
+        ssize_t bytes_read = buffer.fill(socket_fd);
+        if (bytes_read < 0 && errno == EINTR) continue;
+        if (bytes_read <= 0) return false;
+    }
+    return true;
+}
+
+ProtocolVersion Utils::detect_protocol(const ReadBuffer& buffer) {
+    std::string_view pending = buffer.peek();
+    if (!pending.empty() && static_cast<uint8_t>(pending[0]) == PROTOCOL_V2_MAGIC) {
+        return ProtocolVersion::V2_BINARY;
     }
+    return ProtocolVersion::V1_TEXT;
+}
+
+bool Utils::next_frame(ReadBuffer& buffer, ProtocolVersion version, std::string_view& frame) {
+    if (version == ProtocolVersion::V1_TEXT) return buffer.next_line(frame);
+
+    std::string_view pending = buffer.peek();
+    if (pending.size() < PROTOCOL_V2_HEADER_SIZE) return false;
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(pending.data());
+    size_t frame_size = PROTOCOL_V2_HEADER_SIZE + p[3] + p[4] + p[5] +
+                        ((static_cast<size_t>(p[6]) << 8) | p[7]) +
+                        ((p[2] & PROTOCOL_V2_FLAG_SEQ) ? PROTOCOL_V2_SEQ_SIZE : 0);
+    if (pending.size() < frame_size) return false;
+    frame = pending.substr(0, frame_size);
+    buffer.consume(frame_size);
+    return true;
+}
+
+bool Utils::read_frame(int socket_fd, ReadBuffer& buffer, ProtocolVersion version, std::string_view& frame) {
+    while (!next_frame(buffer, version, frame)) {
+        ssize_t bytes_read = buffer.fill(socket_fd);
+        if (bytes_read < 0 && errno == EINTR) continue;
+        if (bytes_read <= 0) return false;
+    }
+    return true;
 }
 
 std::string Utils::get_timestamp_str() {
@@ -79,20 +189,14 @@ bool Utils::is_valid_password(const std::string& pass) {
     return pass.length() >= 4 && pass.length() < MAX_PASSWORD_SIZE;
 }
 
-std::string Utils::filter_profanity(const std::string& message) {
-    std::string lower_message = message;
-    std::transform(lower_message.begin(), lower_message.end(), lower_message.begin(),
-                   [](unsigned char c){ return std::tolower(c); });
-    const std::vector<std::string> bad_words = {"palavraofeia", "chulao", "improprio"};
-    std::string result = message;
-    for (const auto& word : bad_words) {
-        size_t pos = lower_message.find(word);
-        while (pos != std::string::npos) {
-            result.replace(pos, word.length(), std::string(word.length(), '*'));
-            pos = lower_message.find(word, pos + 1);
-        }
+void Utils::random_bytes(uint8_t* out, size_t len) {
+    size_t filled = 0;
+    while (filled < len) {
+        ssize_t n = getrandom(out + filled, len - filled, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) throw std::runtime_error("getrandom falhou");
+        filled += static_cast<size_t>(n);
     }
-    return result;
 }
 
 } // namespace chat
@@ -0,0 +1,686 @@
+// Gerador de carga: milhares de sessões simuladas multiplexadas com epoll em
+// poucas threads. Cada mensagem leva no conteúdo o instante em que foi enviada;
+// como quem a recebe está no mesmo processo, a latência envio -> receção é
+// medida com o mesmo relógio monótono. O relatório final sai em JSON.
+
+#include "chat_common.h"
+#include "hdr_histogram.h"
+#include "read_buffer.h"
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <queue>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace chat;
+
+namespace {
+
+struct Options {
+    std::string host = "127.0.0.1";
+    int port = DEFAULT_PORT;
+    int clients = 100;
+    int threads = 2;
+    double ramp = 200;          // sessões novas por segundo
+    double rate = 1;            // mensagens por segundo por sessão
+    size_t size = 64;           // bytes de conteúdo por mensagem
+    double private_ratio = 0;   // fração das mensagens que são privadas
+    double churn = 0;           // fração das sessões online que reconecta por segundo
+    double duration = 30;       // segundos de envio, contados desde o arranque
+    double drain = 2;           // segundos a escutar depois de parar de enviar
+    bool register_users = true; // REGISTER e, se a conta já existir, LOGIN
+    std::string prefix = "lg";
+    std::string password = "loadgen1";
+    ProtocolVersion protocol = ProtocolVersion::V1_TEXT;
+    std::string output;         // vazio = JSON no stdout
+};
+
+// Prefixo do conteúdo das mensagens geradas: "LG:<ns de envio>:"
+const char CONTENT_TAG[] = "LG:";
+// Acima disto a sessão deixa de enviar até o servidor ler o que está pendente
+const size_t MAX_PENDING_OUT = 256 * 1024;
+const int64_t RETRY_DELAY_NS = 1000000000LL;
+const int64_t CHURN_RECONNECT_DELAY_NS = 100000000LL;
+
+std::atomic<bool> interrupted(false);
+
+void on_signal(int) { interrupted.store(true); }
+
+int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::string username_for(const Options& options, int index) {
+    std::ostringstream name;
+    name << options.prefix << std::setw(6) << std::setfill('0') << index;
+    return name.str();
+}
+
+// Contadores de uma thread; juntos no fim (e lidos de relance pelo progresso)
+struct Counters {
+    std::atomic<uint64_t> sent{0};
+    std::atomic<uint64_t> received{0};
+    std::atomic<uint64_t> bytes_out{0};
+    std::atomic<uint64_t> bytes_in{0};
+    std::atomic<uint64_t> connect_errors{0};
+    std::atomic<uint64_t> auth_ok{0};
+    std::atomic<uint64_t> auth_failed{0};
+    std::atomic<uint64_t> auth_busy{0};     // recusas por pool de autenticação saturado
+    std::atomic<uint64_t> disconnects{0};   // quedas não pedidas pelo gerador
+    std::atomic<uint64_t> churned{0};
+    std::atomic<uint64_t> server_errors{0};
+    std::atomic<uint64_t> throttled{0};     // avisos de limite de taxa do servidor
+    std::atomic<uint64_t> skipped{0};       // envios saltados por a sessão estar entupida
+    std::atomic<uint64_t> pings{0};
+    std::atomic<int> online{0};
+};
+
+class Worker {
+public:
+    Worker(const Options& options, const sockaddr_in& address, int64_t start_ns, int id)
+        : options_(options), address_(address), start_ns_(start_ns), epoll_fd_(-1), rng_(id * 7919 + 1) {}
+
+    ~Worker() {
+        if (epoll_fd_ != -1) close(epoll_fd_);
+    }
+
+    void add_session(int global_index) {
+        Session session;
+        session.global_index = global_index;
+        session.username = username_for(options_, global_index);
+        sessions_.push_back(std::move(session));
+    }
+
+    void start() { thread_ = std::thread([this]{ run(); }); }
+    void join() { if (thread_.joinable()) thread_.join(); }
+
+    Counters counters;
+    HdrHistogram latency_us;
+    HdrHistogram auth_latency_us;
+
+private:
+    enum class State { IDLE, CONNECTING, AUTHENTICATING, ONLINE };
+    enum class TimerKind { CONNECT, SEND, CHURN };
+
+    struct Session {
+        int global_index = 0;
+        std::string username;
+        int fd = -1;
+        State state = State::IDLE;
+        bool use_login = false;
+        uint32_t generation = 0; // invalida temporizadores de conexões anteriores
+        std::unique_ptr<ReadBuffer> in;
+        std::string out;
+        size_t out_offset = 0;
+        bool want_write = false;
+        int64_t auth_sent_ns = 0;
+    };
+
+    struct Timer {
+        int64_t due_ns;
+        size_t index;
+        uint32_t generation;
+        TimerKind kind;
+        bool operator>(const Timer& other) const { return due_ns > other.due_ns; }
+    };
+
+    const Options& options_;
+    sockaddr_in address_;
+    int64_t start_ns_;
+    int epoll_fd_;
+    std::thread thread_;
+    std::vector<Session> sessions_;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers_;
+    std::mt19937_64 rng_;
+
+    int64_t send_end_ns() const { return start_ns_ + static_cast<int64_t>(options_.duration * 1e9); }
+    int64_t drain_end_ns() const { return send_end_ns() + static_cast<int64_t>(options_.drain * 1e9); }
+    bool sending(int64_t now) const { return now < send_end_ns() && !interrupted.load(); }
+
+    double uniform() { return std::uniform_real_distribution<double>(0.0, 1.0)(rng_); }
+
+    void schedule(size_t index, int64_t due, TimerKind kind) {
+        timers_.push(Timer{due, index, sessions_[index].generation, kind});
+    }
+
+    void run() {
+        epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd_ < 0) {
+            std::cerr << "epoll_create1: " << strerror(errno) << std::endl;
+            return;
+        }
+        // A rampa é global: a sessão i arranca em i / ramp segundos
+        for (size_t i = 0; i < sessions_.size(); ++i) {
+            int64_t offset = options_.ramp > 0 ? static_cast<int64_t>(sessions_[i].global_index / options_.ramp * 1e9) : 0;
+            schedule(i, start_ns_ + offset, TimerKind::CONNECT);
+        }
+
+        struct epoll_event events[256];
+        while (true) {
+            int64_t now = now_ns();
+            if (now >= drain_end_ns() || interrupted.load()) break;
+            run_timers(now);
+
+            int timeout_ms = 100;
+            if (!timers_.empty()) {
+                int64_t wait = (timers_.top().due_ns - now_ns()) / 1000000;
+                timeout_ms = static_cast<int>(std::max<int64_t>(0, std::min<int64_t>(wait, 100)));
+            }
+            int n = epoll_wait(epoll_fd_, events, 256, timeout_ms);
+            if (n < 0 && errno != EINTR) break;
+            for (int i = 0; i < n; ++i) {
+                size_t index = static_cast<size_t>(events[i].data.u64);
+                Session& session = sessions_[index];
+                if (session.fd == -1) continue;
+                uint32_t flags = events[i].events;
+                if ((flags & EPOLLERR) || (session.state == State::CONNECTING && (flags & EPOLLHUP))) {
+                    if (session.state == State::CONNECTING) counters.connect_errors++;
+                    drop(index, true);
+                    continue;
+                }
+                if (flags & EPOLLOUT) on_writable(index);
+                // Lê antes de tratar o HUP: a recusa da autenticação chega junto com o fecho
+                if (session.fd != -1 && (flags & (EPOLLIN | EPOLLHUP))) on_readable(index);
+            }
+        }
+
+        for (size_t i = 0; i < sessions_.size(); ++i) {
+            if (sessions_[i].fd != -1) close_session(i);
+        }
+    }
+
+    void run_timers(int64_t now) {
+        while (!timers_.empty() && timers_.top().due_ns <= now) {
+            Timer timer = timers_.top();
+            timers_.pop();
+            Session& session = sessions_[timer.index];
+            if (timer.generation != session.generation) continue;
+            switch (timer.kind) {
+                case TimerKind::CONNECT:
+                    if (session.state == State::IDLE && sending(now)) connect_session(timer.index);
+                    break;
+                case TimerKind::SEND:
+                    if (session.state == State::ONLINE && sending(now)) send_one(timer.index, timer.due_ns, now);
+                    break;
+                case TimerKind::CHURN:
+                    if (session.state == State::ONLINE && sending(now)) {
+                        queue(session, Message(MessageType::DISCONNECT_REQUEST, session.username, ""));
+                        flush(timer.index);
+                        counters.churned++;
+                        close_session(timer.index);
+                        session.use_login = true;
+                        // Dá tempo ao servidor de retirar a sessão antiga antes do novo login
+                        schedule(timer.index, now + CHURN_RECONNECT_DELAY_NS, TimerKind::CONNECT);
+                    }
+                    break;
+            }
+        }
+    }
+
+    void connect_session(size_t index) {
+        Session& session = sessions_[index];
+        int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            counters.connect_errors++;
+            schedule(index, now_ns() + RETRY_DELAY_NS, TimerKind::CONNECT);
+            return;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (connect(fd, reinterpret_cast<const sockaddr*>(&address_), sizeof(address_)) < 0 && errno != EINPROGRESS) {
+            counters.connect_errors++;
+            close(fd);
+            schedule(index, now_ns() + RETRY_DELAY_NS, TimerKind::CONNECT);
+            return;
+        }
+
+        session.fd = fd;
+        session.state = State::CONNECTING;
+        if (!session.in) session.in = std::make_unique<ReadBuffer>(4096);
+        session.in->clear();
+        session.out.clear();
+        session.out_offset = 0;
+        session.want_write = true;
+
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN | EPOLLOUT;
+        ev.data.u64 = index;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev);
+
+        bool use_register = options_.register_users && !session.use_login;
+        Message auth(use_register ? MessageType::REGISTER_REQUEST : MessageType::LOGIN_REQUEST, session.username, "");
+        strncpy(auth.password, options_.password.c_str(), MAX_PASSWORD_SIZE - 1);
+        queue(session, auth);
+    }
+
+    void queue(Session& session, const Message& msg) {
+        WireBuffer wire = msg.to_wire(options_.protocol);
+        session.out.append(*wire);
+    }
+
+    void set_write_interest(size_t index, bool enabled) {
+        Session& session = sessions_[index];
+        if (session.want_write == enabled) return;
+        session.want_write = enabled;
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = enabled ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+        ev.data.u64 = index;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, session.fd, &ev);
+    }
+
+    // Retorna false se a sessão caiu
+    bool flush(size_t index) {
+        Session& session = sessions_[index];
+        if (session.state == State::CONNECTING) return true;
+        while (session.out_offset < session.out.size()) {
+            ssize_t n = send(session.fd, session.out.data() + session.out_offset,
+                             session.out.size() - session.out_offset, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    set_write_interest(index, true);
+                    return true;
+                }
+                drop(index, true);
+                return false;
+            }
+            session.out_offset += static_cast<size_t>(n);
+            counters.bytes_out.fetch_add(static_cast<uint64_t>(n), std::memory_order_relaxed);
+        }
+        session.out.clear();
+        session.out_offset = 0;
+        set_write_interest(index, false);
+        return true;
+    }
+
+    void on_writable(size_t index) {
+        Session& session = sessions_[index];
+        if (session.state == State::CONNECTING) {
+            int error = 0;
+            socklen_t length = sizeof(error);
+            getsockopt(session.fd, SOL_SOCKET, SO_ERROR, &error, &length);
+            if (error != 0) {
+                counters.connect_errors++;
+                drop(index, true);
+                return;
+            }
+            session.state = State::AUTHENTICATING;
+            session.auth_sent_ns = now_ns();
+        }
+        flush(index);
+    }
+
+    void on_readable(size_t index) {
+        Session& session = sessions_[index];
+        while (true) {
+            ssize_t n = session.in->fill(session.fd, MSG_DONTWAIT);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+            if (n <= 0) {
+                drop(index, true);
+                return;
+            }
+            counters.bytes_in.fetch_add(static_cast<uint64_t>(n), std::memory_order_relaxed);
+            std::string_view frame;
+            while (session.fd != -1 && Utils::next_frame(*session.in, options_.protocol, frame)) {
+                on_frame(index, Message::decode(frame, options_.protocol));
+            }
+            if (session.fd == -1) return;
+        }
+    }
+
+    void on_frame(size_t index, const Message& msg) {
+        Session& session = sessions_[index];
+        int64_t now = now_ns();
+        if (session.state == State::AUTHENTICATING) {
+            if (msg.type == MessageType::AUTH_SUCCESS) {
+                session.state = State::ONLINE;
+                counters.auth_ok++;
+                counters.online++;
+                auth_latency_us.record(static_cast<uint64_t>((now - session.auth_sent_ns) / 1000));
+                if (options_.rate > 0) {
+                    // Fase aleatória: as sessões não enviam todas no mesmo instante
+                    schedule(index, now + static_cast<int64_t>(uniform() * 1e9 / options_.rate), TimerKind::SEND);
+                }
+                if (options_.churn > 0) {
+                    double wait = std::exponential_distribution<double>(options_.churn)(rng_);
+                    schedule(index, now + static_cast<int64_t>(wait * 1e9), TimerKind::CHURN);
+                }
+            } else if (msg.type == MessageType::AUTH_FAILURE) {
+                bool retry_as_login = options_.register_users && !session.use_login;
+                if (!retry_as_login) counters.auth_failed++;
+                if (strstr(msg.content, "ocupado")) counters.auth_busy++;
+                close_session(index);
+                // O registo falha se a conta já existe (de uma execução anterior)
+                session.use_login = true;
+                schedule(index, retry_as_login ? now : now + RETRY_DELAY_NS, TimerKind::CONNECT);
+            }
+            return;
+        }
+
+        switch (msg.type) {
+            case MessageType::CHAT_BROADCAST:
+            case MessageType::PRIVATE_MESSAGE:
+            case MessageType::ROOM_MESSAGE:
+                if (strncmp(msg.content, CONTENT_TAG, sizeof(CONTENT_TAG) - 1) == 0) {
+                    int64_t sent_ns = std::strtoll(msg.content + sizeof(CONTENT_TAG) - 1, nullptr, 10);
+                    if (sent_ns > 0 && now >= sent_ns) latency_us.record(static_cast<uint64_t>((now - sent_ns) / 1000));
+                    counters.received.fetch_add(1, std::memory_order_relaxed);
+                }
+                break;
+            case MessageType::PING:
+                counters.pings++;
+                queue(session, Message(MessageType::PONG, session.username, ""));
+                flush(index);
+                break;
+            case MessageType::ERROR_MSG:
+                if (strstr(msg.content, "Demasiadas")) {
+                    counters.throttled++;
+                } else {
+                    counters.server_errors++;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    void send_one(size_t index, int64_t due, int64_t now) {
+        Session& session = sessions_[index];
+        // Cadência fixa em malha aberta; atrasos grandes não viram rajadas
+        int64_t interval = static_cast<int64_t>(1e9 / options_.rate);
+        int64_t next = due + interval;
+        if (next < now - 1000000000LL) next = now + interval;
+        schedule(index, next, TimerKind::SEND);
+
+        if (session.out.size() - session.out_offset > MAX_PENDING_OUT) {
+            counters.skipped++;
+            return;
+        }
+
+        bool is_private = options_.private_ratio > 0 && uniform() < options_.private_ratio;
+        Message msg(is_private ? MessageType::PRIVATE_MESSAGE : MessageType::CHAT_BROADCAST, session.username, "");
+        if (is_private) {
+            int target = static_cast<int>(rng_() % static_cast<uint64_t>(options_.clients));
+            std::string target_name = username_for(options_, target);
+            strncpy(msg.target_user, target_name.c_str(), MAX_USERNAME_SIZE - 1);
+        }
+        int length = snprintf(msg.content, MAX_CONTENT_SIZE, "%s%lld:", CONTENT_TAG, static_cast<long long>(now_ns()));
+        size_t target_size = std::min(options_.size, static_cast<size_t>(MAX_CONTENT_SIZE - 1));
+        if (length > 0 && static_cast<size_t>(length) < target_size) {
+            memset(msg.content + length, 'x', target_size - length);
+            msg.content[target_size] = '\0';
+        }
+        queue(session, msg);
+        counters.sent.fetch_add(1, std::memory_order_relaxed);
+        flush(index);
+    }
+
+    void close_session(size_t index) {
+        Session& session = sessions_[index];
+        if (session.fd == -1) return;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, session.fd, nullptr);
+        close(session.fd);
+        session.fd = -1;
+        if (session.state == State::ONLINE) counters.online--;
+        session.state = State::IDLE;
+        session.out.clear();
+        session.out_offset = 0;
+        session.generation++;
+    }
+
+    // Queda inesperada: conta e volta a tentar enquanto durar o envio
+    void drop(size_t index, bool reconnect) {
+        Session& session = sessions_[index];
+        if (session.state == State::ONLINE || session.state == State::AUTHENTICATING) counters.disconnects++;
+        close_session(index);
+        if (reconnect && sending(now_ns())) {
+            if (options_.register_users) session.use_login = true;
+            schedule(index, now_ns() + RETRY_DELAY_NS, TimerKind::CONNECT);
+        }
+    }
+};
+
+void print_usage(const char* program) {
+    std::cout << "Uso: " << program << " [opções]\n"
+              << "  -s, --server HOST       Servidor (padrão: 127.0.0.1)\n"
+              << "  -p, --port PORTA        Porta (padrão: " << DEFAULT_PORT << ")\n"
+              << "  --clients N             Sessões simuladas (padrão: 100)\n"
+              << "  --threads N             Threads com epoll (padrão: 2)\n"
+              << "  --ramp N                Sessões novas por segundo (padrão: 200; 0 = todas de uma vez)\n"
+              << "  --rate N                Mensagens por segundo por sessão (padrão: 1; 0 = só ligações)\n"
+              << "  --size N                Bytes de conteúdo por mensagem (padrão: 64, máx. " << MAX_CONTENT_SIZE - 1 << ")\n"
+              << "  --private-ratio F       Fração de mensagens privadas, 0 a 1 (padrão: 0)\n"
+              << "  --churn F               Fração das sessões online que reconecta por segundo (padrão: 0)\n"
+              << "  --duration S            Segundos de envio desde o arranque (padrão: 30)\n"
+              << "  --drain S               Segundos a escutar depois de parar de enviar (padrão: 2)\n"
+              << "  --login                 Só LOGIN (as contas já existem); por omissão faz REGISTER\n"
+              << "  --prefix P              Prefixo dos nomes: P000000, P000001, ... (padrão: lg)\n"
+              << "  --password S            Senha de todas as contas (padrão: loadgen1)\n"
+              << "  --protocol v1|v2        Protocolo de rede (padrão: v1)\n"
+              << "  --output FICHEIRO       Relatório JSON (padrão: stdout)\n";
+}
+
+bool resolve(const std::string& host, int port, sockaddr_in& address) {
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    if (inet_pton(AF_INET, host.c_str(), &address.sin_addr) == 1) return true;
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), nullptr, &hints, &result) != 0 || !result) return false;
+    address.sin_addr = reinterpret_cast<sockaddr_in*>(result->ai_addr)->sin_addr;
+    freeaddrinfo(result);
+    return true;
+}
+
+// Cada sessão usa um descritor: sobe o limite flexível até ao rígido
+void raise_fd_limit(int needed) {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) != 0) return;
+    if (limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+    if (limit.rlim_cur != RLIM_INFINITY && static_cast<rlim_t>(needed) + 64 > limit.rlim_cur) {
+        std::cerr << "Aviso: limite de descritores (" << limit.rlim_cur << ") abaixo das " << needed
+                  << " sessões pedidas" << std::endl;
+    }
+}
+
+void write_histogram(std::ostream& out, const HdrHistogram& histogram) {
+    out << "{\"count\": " << histogram.count()
+        << ", \"mean\": " << std::fixed << std::setprecision(1) << histogram.mean()
+        << ", \"p50\": " << histogram.percentile(0.50)
+        << ", \"p90\": " << histogram.percentile(0.90)
+        << ", \"p99\": " << histogram.percentile(0.99)
+        << ", \"p999\": " << histogram.percentile(0.999)
+        << ", \"max\": " << histogram.max() << "}";
+}
+
+std::string json_escape(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') escaped += '\\';
+        escaped += c;
+    }
+    return escaped;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if ((arg == "-s" || arg == "--server") && has_value) {
+            options.host = argv[++i];
+        } else if ((arg == "-p" || arg == "--port") && has_value) {
+            options.port = std::atoi(argv[++i]);
+        } else if (arg == "--clients" && has_value) {
+            options.clients = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--threads" && has_value) {
+            options.threads = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--ramp" && has_value) {
+            options.ramp = std::max(0.0, std::atof(argv[++i]));
+        } else if (arg == "--rate" && has_value) {
+            options.rate = std::max(0.0, std::atof(argv[++i]));
+        } else if (arg == "--size" && has_value) {
+            options.size = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+        } else if (arg == "--private-ratio" && has_value) {
+            options.private_ratio = std::min(1.0, std::max(0.0, std::atof(argv[++i])));
+        } else if (arg == "--churn" && has_value) {
+            options.churn = std::max(0.0, std::atof(argv[++i]));
+        } else if (arg == "--duration" && has_value) {
+            options.duration = std::max(1.0, std::atof(argv[++i]));
+        } else if (arg == "--drain" && has_value) {
+            options.drain = std::max(0.0, std::atof(argv[++i]));
+        } else if (arg == "--login") {
+            options.register_users = false;
+        } else if (arg == "--prefix" && has_value) {
+            options.prefix = argv[++i];
+        } else if (arg == "--password" && has_value) {
+            options.password = argv[++i];
+        } else if (arg == "--protocol" && has_value) {
+            std::string value = argv[++i];
+            options.protocol = value == "v2" ? ProtocolVersion::V2_BINARY : ProtocolVersion::V1_TEXT;
+        } else if (arg == "--output" && has_value) {
+            options.output = argv[++i];
+        } else {
+            print_usage(argv[0]);
+            return arg == "-h" || arg == "--help" ? 0 : 1;
+        }
+    }
+
+    if (!Utils::is_valid_username(username_for(options, options.clients - 1)) ||
+        !Utils::is_valid_password(options.password)) {
+        std::cerr << "Prefixo ou senha inválidos: os nomes gerados têm de ter 3 a 15 caracteres alfanuméricos" << std::endl;
+        return 1;
+    }
+    sockaddr_in address;
+    if (!resolve(options.host, options.port, address)) {
+        std::cerr << "Não foi possível resolver " << options.host << std::endl;
+        return 1;
+    }
+    raise_fd_limit(options.clients);
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    signal(SIGPIPE, SIG_IGN);
+
+    int64_t start_ns = now_ns();
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (int t = 0; t < options.threads; ++t) workers.push_back(std::make_unique<Worker>(options, address, start_ns, t));
+    for (int i = 0; i < options.clients; ++i) workers[i % options.threads]->add_session(i);
+    for (auto& worker : workers) worker->start();
+
+    // Progresso a cada segundo no stderr; o JSON fica limpo no stdout
+    std::thread progress([&]{
+        uint64_t last_sent = 0, last_received = 0;
+        int64_t end = start_ns + static_cast<int64_t>((options.duration + options.drain) * 1e9);
+        while (now_ns() < end && !interrupted.load()) {
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+            uint64_t sent = 0, received = 0;
+            int online = 0;
+            for (auto& worker : workers) {
+                sent += worker->counters.sent.load();
+                received += worker->counters.received.load();
+                online += worker->counters.online.load();
+            }
+            std::cerr << "[" << std::setw(4) << (now_ns() - start_ns) / 1000000000LL << "s] online=" << online
+                      << " enviadas/s=" << sent - last_sent << " recebidas/s=" << received - last_received << std::endl;
+            last_sent = sent;
+            last_received = received;
+        }
+    });
+
+    for (auto& worker : workers) worker->join();
+    double elapsed = (now_ns() - start_ns) / 1e9;
+    interrupted.store(true);
+    progress.join();
+
+    HdrHistogram latency, auth_latency;
+    Counters total;
+    for (auto& worker : workers) {
+        latency.merge(worker->latency_us);
+        auth_latency.merge(worker->auth_latency_us);
+        total.sent += worker->counters.sent.load();
+        total.received += worker->counters.received.load();
+        total.bytes_out += worker->counters.bytes_out.load();
+        total.bytes_in += worker->counters.bytes_in.load();
+        total.connect_errors += worker->counters.connect_errors.load();
+        total.auth_ok += worker->counters.auth_ok.load();
+        total.auth_failed += worker->counters.auth_failed.load();
+        total.auth_busy += worker->counters.auth_busy.load();
+        total.disconnects += worker->counters.disconnects.load();
+        total.churned += worker->counters.churned.load();
+        total.server_errors += worker->counters.server_errors.load();
+        total.throttled += worker->counters.throttled.load();
+        total.skipped += worker->counters.skipped.load();
+        total.pings += worker->counters.pings.load();
+    }
+    double send_seconds = std::min(options.duration, elapsed);
+
+    std::ostringstream json;
+    json << "{\n"
+         << "  \"config\": {\"server\": \"" << json_escape(options.host) << ":" << options.port << "\""
+         << ", \"clients\": " << options.clients << ", \"threads\": " << options.threads
+         << ", \"ramp\": " << options.ramp << ", \"rate\": " << options.rate << ", \"size\": " << options.size
+         << ", \"private_ratio\": " << options.private_ratio << ", \"churn\": " << options.churn
+         << ", \"duration\": " << options.duration << ", \"protocol\": \""
+         << (options.protocol == ProtocolVersion::V2_BINARY ? "v2" : "v1") << "\"},\n"
+         << std::fixed << std::setprecision(3)
+         << "  \"elapsed_s\": " << elapsed << ",\n"
+         << "  \"sessions\": {\"auth_ok\": " << total.auth_ok << ", \"auth_failed\": " << total.auth_failed << ", \"auth_busy\": " << total.auth_busy
+         << ", \"connect_errors\": " << total.connect_errors << ", \"disconnects\": " << total.disconnects
+         << ", \"churned\": " << total.churned << "},\n"
+         << "  \"messages\": {\"sent\": " << total.sent << ", \"received\": " << total.received
+         << ", \"sent_per_s\": " << total.sent / send_seconds << ", \"received_per_s\": " << total.received / send_seconds
+         << ", \"throttled\": " << total.throttled << ", \"server_errors\": " << total.server_errors
+         << ", \"skipped\": " << total.skipped << ", \"pings\": " << total.pings << "},\n"
+         << "  \"bytes\": {\"out\": " << total.bytes_out << ", \"in\": " << total.bytes_in << "},\n"
+         << "  \"latency_us\": ";
+    write_histogram(json, latency);
+    json << ",\n  \"auth_latency_us\": ";
+    write_histogram(json, auth_latency);
+    json << "\n}\n";
+
+    if (options.output.empty()) {
+        std::cout << json.str();
+    } else {
+        std::ofstream file(options.output);
+        file << json.str();
+        if (!file) {
+            std::cerr << "Falha ao escrever " << options.output << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -2,17 +2,44 @@
 #include "libtslog.h"
 #include "error_handler.h"
 #include <iostream>
+#include <algorithm>
 #include <signal.h>
 #include <thread>
 #include <chrono>
 #include <cstring>
+#include <fstream>
 
 using namespace chat;
 
 std::unique_ptr<SimpleChatServer> server = nullptr;
 bool daemon_mode = false;
+volatile sig_atomic_t stop_requested = 0;
+volatile sig_atomic_t dump_requested = 0;
+const char* STATS_DUMP_FILE = "chat_stats.json";
+
+// Escreve as estatísticas em JSON no ficheiro (vazio = stdout)
+bool dump_stats(const SimpleChatServer& server_instance, const std::string& path) {
+    std::string json = server_instance.stats_json();
+    if (path.empty()) {
+        std::cout << json << std::endl;
+        return true;
+    }
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open()) return false;
+    file << json << "\n";
+    return static_cast<bool>(file);
+}
+
+void dump_signal_handler(int) {
+    dump_requested = 1;
+}
 
 void signal_handler(int signum) {
+    if (daemon_mode) {
+        // O sinal pode cair em qualquer thread: a paragem fica para a thread principal
+        stop_requested = 1;
+        return;
+    }
     std::cout << "\n\n🛑 Sinal recebido (" << signum << "). Parando servidor...\n" << std::endl;
     if (server) {
         server->stop();
@@ -32,6 +59,8 @@ void print_help() {
     std::cout << "\n💡 COMANDOS DISPONÍVEIS:\n";
     std::cout << "  help     - Mostrar esta ajuda\n";
     std::cout << "  stats    - Exibir estatísticas do servidor\n";
+    std::cout << "  dump [f] - Estatísticas em JSON (no ficheiro f ou no ecrã)\n";
+    std::cout << "  locks    - Locks ordenados por tempo de espera (make LOCK_PROFILING=1)\n";
     std::cout << "  clients  - Listar clientes online\n";
     std::cout << "  stop     - Parar o servidor\n";
     std::cout << "  quit     - Sair da aplicação\n";
@@ -53,6 +82,13 @@ void interactive_mode(SimpleChatServer& server_instance) {
             print_help();
         } else if (command == "stats") {
             server_instance.print_stats();
+        } else if (command == "dump" || command.rfind("dump ", 0) == 0) {
+            std::string path = command.size() > 5 ? command.substr(5) : "";
+            if (!dump_stats(server_instance, path)) {
+                std::cout << "❌ Não foi possível escrever " << path << "\n";
+            }
+        } else if (command == "locks") {
+            std::cout << "\n" << LockProfiler::report_text() << std::endl;
         } else if (command == "clients") {
             auto usernames = server_instance.get_online_usernames();
             std::cout << "\n👥 CLIENTES ONLINE (" << usernames.size() << "):\n";
@@ -78,41 +114,129 @@ void interactive_mode(SimpleChatServer& server_instance) {
 void daemon_mode_run(SimpleChatServer& server_instance) {
     // Em modo daemon, apenas aguarda sinais ou 60 segundos
     LOG_INFO("Servidor em modo daemon");
-    for (int i = 0; i < 600 && server_instance.is_running(); ++i) {
+    for (int i = 0; i < 600 && server_instance.is_running() && !stop_requested; ++i) {
         std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        // SIGUSR1: estatísticas em JSON sem parar o servidor
+        if (dump_requested) {
+            dump_requested = 0;
+            if (!dump_stats(server_instance, STATS_DUMP_FILE)) {
+                LOG_ERROR("Não foi possível escrever " + std::string(STATS_DUMP_FILE));
+            }
+        }
+    }
+    if (stop_requested) {
+        std::cout << "\n\n🛑 Sinal recebido. Parando servidor...\n" << std::endl;
     }
+    server_instance.stop();
 }
 
 int main(int argc, char* argv[]) {
-    try {
-        tslog::Logger::getInstance().configure("chat_server.log", tslog::LogLevel::INFO, true, true);
-    } catch (const std::exception& e) {
-        std::cerr << "❌ Falha ao configurar logging: " << e.what() << std::endl;
-        return 1;
-    }
-
-    signal(SIGINT, signal_handler);
-    signal(SIGTERM, signal_handler);
-
-    int port = DEFAULT_PORT;
+    ServerConfig config;
+    tslog::LogMode log_mode = tslog::LogMode::SYNC;
     
     // Parse argumentos
     for (int i = 1; i < argc; ++i) {
         if (strcmp(argv[i], "--daemon") == 0) {
             daemon_mode = true;
         } else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
-            port = std::atoi(argv[++i]);
+            config.port = std::atoi(argv[++i]);
         } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
-            port = std::atoi(argv[++i]);
+            config.port = std::atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--engine") == 0 && i + 1 < argc) {
+            std::string engine = argv[++i];
+            if (engine == "epoll") {
+                config.engine = ServerEngine::EPOLL;
+            } else if (engine == "threads") {
+                config.engine = ServerEngine::THREADS;
+            } else {
+                std::cerr << "❌ Motor desconhecido: " << engine << " (use 'threads' ou 'epoll')\n";
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--loops") == 0 && i + 1 < argc) {
+            config.event_loops = std::atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--max-queue") == 0 && i + 1 < argc) {
+            config.outbound.max_messages = static_cast<size_t>(std::atol(argv[++i]));
+        } else if (strcmp(argv[i], "--max-queue-bytes") == 0 && i + 1 < argc) {
+            config.outbound.max_bytes = static_cast<size_t>(std::atol(argv[++i]));
+        } else if (strcmp(argv[i], "--slow-policy") == 0 && i + 1 < argc) {
+            std::string policy = argv[++i];
+            if (policy == "drop-new") {
+                config.outbound.policy = SlowConsumerPolicy::DROP_NEW;
+            } else if (policy == "drop-oldest") {
+                config.outbound.policy = SlowConsumerPolicy::DROP_OLDEST;
+            } else if (policy == "disconnect") {
+                config.outbound.policy = SlowConsumerPolicy::DISCONNECT;
+            } else {
+                std::cerr << "❌ Política desconhecida: " << policy
+                          << " (use 'drop-new', 'drop-oldest' ou 'disconnect')\n";
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--auth-workers") == 0 && i + 1 < argc) {
+            config.auth_workers = std::atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--auth-queue") == 0 && i + 1 < argc) {
+            config.auth_queue_limit = static_cast<size_t>(std::atol(argv[++i]));
+        } else if (strcmp(argv[i], "--kdf-iterations") == 0 && i + 1 < argc) {
+            config.kdf_iterations = static_cast<uint32_t>(std::atol(argv[++i]));
+        } else if (strcmp(argv[i], "--resume-ttl") == 0 && i + 1 < argc) {
+            config.resume_token_ttl = std::atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--history") == 0 && i + 1 < argc) {
+            config.history_size = static_cast<size_t>(std::atol(argv[++i]));
+        } else if (strcmp(argv[i], "--archive") == 0 && i + 1 < argc) {
+            config.archive_dir = argv[++i];
+        } else if (strcmp(argv[i], "--archive-segment-mb") == 0 && i + 1 < argc) {
+            long mb = std::atol(argv[++i]);
+            if (mb > 0) config.archive_segment_size = static_cast<size_t>(mb) * 1024 * 1024;
+        } else if (strcmp(argv[i], "--acceptors") == 0 && i + 1 < argc) {
+            config.acceptors = std::atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--backlog") == 0 && i + 1 < argc) {
+            config.listen_backlog = std::atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--fanout-workers") == 0 && i + 1 < argc) {
+            config.fanout_workers = std::atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--fanout-threshold") == 0 && i + 1 < argc) {
+            config.fanout_threshold = static_cast<size_t>(std::atol(argv[++i]));
+        } else if (strcmp(argv[i], "--msg-rate") == 0 && i + 1 < argc) {
+            config.message_rate.per_second = std::atof(argv[++i]);
+        } else if (strcmp(argv[i], "--msg-burst") == 0 && i + 1 < argc) {
+            config.message_rate.burst = static_cast<uint32_t>(std::max(1, std::atoi(argv[++i])));
+        } else if (strcmp(argv[i], "--conn-rate") == 0 && i + 1 < argc) {
+            config.connection_rate.per_second = std::atof(argv[++i]);
+        } else if (strcmp(argv[i], "--conn-burst") == 0 && i + 1 < argc) {
+            config.connection_rate.burst = static_cast<uint32_t>(std::max(1, std::atoi(argv[++i])));
+        } else if (strcmp(argv[i], "--filter-file") == 0 && i + 1 < argc) {
+            config.filter_file = argv[++i];
+        } else if (strcmp(argv[i], "--handshake-timeout") == 0 && i + 1 < argc) {
+            config.handshake_timeout = std::max(0, std::atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--idle-timeout") == 0 && i + 1 < argc) {
+            config.idle_timeout = std::max(0, std::atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--heartbeat") == 0 && i + 1 < argc) {
+            config.heartbeat_interval = std::max(0, std::atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--admin") == 0 && i + 1 < argc) {
+            config.admin_endpoint = argv[++i];
+        } else if (strcmp(argv[i], "--no-stage-metrics") == 0) {
+            config.stage_metrics = false;
+        } else if (strcmp(argv[i], "--async-log") == 0) {
+            log_mode = tslog::LogMode::ASYNC;
         }
     }
+    int port = config.port;
+
+    try {
+        tslog::Logger::getInstance().configure("chat_server.log", tslog::LogLevel::INFO, true, true, log_mode);
+    } catch (const std::exception& e) {
+        std::cerr << "❌ Falha ao configurar logging: " << e.what() << std::endl;
+        return 1;
+    }
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+    signal(SIGUSR1, dump_signal_handler);
 
     if (!daemon_mode) {
         print_banner();
     }
     
     try {
-        server = std::make_unique<SimpleChatServer>(port);
+        server = std::make_unique<SimpleChatServer>(config);
         std::cout << "🚀 Iniciando servidor na porta " << port << "...\n";
         
         if (!server->start()) {
@@ -1,57 +1,265 @@
 #include "connected_client.h"
 #include "libtslog.h"
+#include "stage_metrics.h"
+#include "sharded_counter.h"
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
 
 namespace chat {
 
-ConnectedClient::ConnectedClient(int socket, const std::string& username)
-    : socket_fd_(socket), username_(username), active_(true) {}
+namespace {
+// Com DROP_OLDEST a fila aceita até o dobro dos limites; o consumidor
+// descarta as mais antigas até voltar a ficar dentro deles
+size_t queue_capacity_for(const OutboundLimits& limits) {
+    return limits.policy == SlowConsumerPolicy::DROP_OLDEST ? limits.max_messages * 2 : limits.max_messages;
+}
+
+int64_t steady_now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+}
+
+ConnectedClient::ConnectedClient(int socket, const std::string& username, ProtocolVersion protocol,
+                                 const OutboundLimits& limits)
+    : socket_fd_(socket), username_(username), protocol_(protocol), active_(true), evicted_(false),
+      last_activity_ms_(steady_now_ms()), throttled_(0),
+      limits_(limits), outgoing_messages_(queue_capacity_for(limits), false),
+      queued_messages_(0), queued_bytes_(0), dropped_new_(0), dropped_oldest_(0) {}
 
 ConnectedClient::~ConnectedClient() {
     disconnect();
 }
 
+bool ConnectedClient::admit_inbound(bool& notify) {
+    notify = false;
+    if (inbound_rate_.try_acquire()) {
+        throttle_notified_ = false;
+        return true;
+    }
+    throttled_.fetch_add(1, std::memory_order_relaxed);
+    notify = !throttle_notified_;
+    throttle_notified_ = true;
+    return false;
+}
+
+void ConnectedClient::mark_activity() {
+    last_activity_ms_.store(steady_now_ms(), std::memory_order_relaxed);
+}
+
+int64_t ConnectedClient::get_idle_ms() const {
+    return steady_now_ms() - last_activity_ms_.load(std::memory_order_relaxed);
+}
+
 void ConnectedClient::queue_message(const Message& msg) {
-    if (active_.load()) outgoing_messages_.push(msg);
+    if (active_.load()) queue_wire(msg.to_wire(protocol_), msg.received_ns);
 }
 
-void ConnectedClient::disconnect() {
-    if (active_.exchange(false)) {
-        outgoing_messages_.shutdown();
-        if (socket_fd_ != -1) {
-            shutdown(socket_fd_, SHUT_RDWR);
-            close(socket_fd_);
-            socket_fd_ = -1;
+void ConnectedClient::queue_wire(WireBuffer wire, int64_t origin_ns) {
+    if (!active_.load()) return;
+
+    size_t size = wire->size();
+    size_t messages = queued_messages_.fetch_add(1, std::memory_order_relaxed) + 1;
+    size_t bytes = queued_bytes_.fetch_add(size, std::memory_order_relaxed) + size;
+
+    size_t max_messages = limits_.max_messages;
+    size_t max_bytes = limits_.max_bytes;
+    if (limits_.policy == SlowConsumerPolicy::DROP_OLDEST) {
+        max_messages *= 2;
+        max_bytes *= 2;
+    }
+
+    if (messages > max_messages || bytes > max_bytes ||
+        !outgoing_messages_.push(OutboundWire{std::move(wire), origin_ns, StageMetrics::now()})) {
+        queued_messages_.fetch_sub(1, std::memory_order_relaxed);
+        queued_bytes_.fetch_sub(size, std::memory_order_relaxed);
+        if (limits_.policy == SlowConsumerPolicy::DISCONNECT) {
+            evict();
+        } else {
+            dropped_new_.fetch_add(1, std::memory_order_relaxed);
         }
-        if (sender_thread_.joinable()) sender_thread_.join();
+        return;
+    }
+    if (reactor_wake_) reactor_wake_();
+}
+
+void ConnectedClient::release_accounting(const OutboundWire& entry) {
+    queued_messages_.fetch_sub(1, std::memory_order_relaxed);
+    queued_bytes_.fetch_sub(entry.wire->size(), std::memory_order_relaxed);
+}
+
+bool ConnectedClient::over_limits() const {
+    if (limits_.policy != SlowConsumerPolicy::DROP_OLDEST) return false;
+    return queued_messages_.load(std::memory_order_relaxed) > limits_.max_messages ||
+           queued_bytes_.load(std::memory_order_relaxed) > limits_.max_bytes;
+}
+
+void ConnectedClient::evict() {
+    if (evicted_.exchange(true)) return;
+    LOG_WARNING("Cliente " + username_ + " expulso: fila de saída excedeu os limites");
+    request_close();
+}
+
+void ConnectedClient::request_close() {
+    if (reactor_wake_) {
+        disconnect();
+        return;
     }
+    // Acorda a thread de leitura (EOF) e a de envio; a limpeza segue o caminho normal.
+    // Inativo já: a thread de envio sai do ciclo em vez de acordar sem nada para enviar
+    active_.store(false);
+    outgoing_messages_.shutdown();
+    std::lock_guard<ProfiledMutex> lock(socket_mutex_);
+    if (socket_fd_ != -1) shutdown(socket_fd_, SHUT_RDWR);
 }
 
-void ConnectedClient::start_sender_thread() {
+void ConnectedClient::disconnect() {
+    bool was_active = active_.exchange(false);
+    outgoing_messages_.shutdown();
+    if (reactor_wake_) {
+        // O event loop é quem fecha o socket ao ver o cliente inativo
+        if (was_active) reactor_wake_();
+        return;
+    }
+    {
+        std::lock_guard<ProfiledMutex> lock(socket_mutex_);
+        if (socket_fd_ != -1) shutdown(socket_fd_, SHUT_RDWR);
+    }
+    // A thread de envio pode já ter marcado o cliente como inativo ao falhar um send()
+    if (sender_thread_.joinable() && sender_thread_.get_id() != std::this_thread::get_id()) {
+        sender_thread_.join();
+    }
+    // Só depois do join: o sendmsg() da thread de envio usa o descritor sem lock e
+    // um número reutilizado por outro accept() seria o socket de outra pessoa
+    std::lock_guard<ProfiledMutex> lock(socket_mutex_);
+    if (socket_fd_ != -1) {
+        close(socket_fd_);
+        socket_fd_ = -1;
+    }
+}
+
+bool ConnectedClient::start_sender_thread() {
+    // Só o modo threads precisa do eventfd; no reactor o event loop esvazia a fila
+    if (!outgoing_messages_.open_wakeup()) {
+        LOG_ERROR("Falha ao criar eventfd para " + username_ + ": " + std::string(strerror(errno)));
+        return false;
+    }
     sender_thread_ = std::thread(&ConnectedClient::sender_thread_func, this);
+    return true;
 }
 
 void ConnectedClient::sender_thread_func() {
-    while (active_.load()) {
+    bool failed = false;
+    while (active_.load() && !failed) {
         try {
-            auto msg_opt = outgoing_messages_.pop_timeout(std::chrono::seconds(1));
-            if (msg_opt.has_value() && !send_message_direct(msg_opt.value())) break;
+            // Dorme no eventfd da fila até haver mensagens ou shutdown
+            outgoing_messages_.wait();
+            if (!take_batch()) {
+                // Depois do shutdown o wait() retorna logo: voltar a ele seria espera ativa
+                if (outgoing_messages_.is_shutdown()) break;
+                continue;
+            }
+            // Tudo o que estava na fila sai em sendmsg() vetoriais, não um send() por mensagem
+            while (pending_index_ < pending_batch_.size()) {
+                if (!active_.load()) { failed = true; break; }
+                ssize_t sent = write_pending(0);
+                if (sent < 0 && errno == EINTR) continue;
+                if (sent <= 0) { failed = true; break; }
+            }
         } catch (...) { break; }
     }
     active_.store(false);
 }
 
-bool ConnectedClient::send_message_direct(const Message& msg) {
-    if (!active_.load()) return false;
-    std::string data = msg.serialize() + "\n";
-    return send(socket_fd_, data.c_str(), data.length(), MSG_NOSIGNAL) > 0;
+bool ConnectedClient::take_batch() {
+    pending_batch_.clear();
+    pending_index_ = 0;
+    pending_offset_ = 0;
+
+    int64_t now = StageMetrics::now();
+    outgoing_messages_.pop_all([this, now](OutboundWire&& entry) {
+        StageMetrics::record(Stage::QUEUE_WAIT, entry.queued_ns, now);
+        pending_batch_.push_back(std::move(entry));
+    });
+    while (pending_index_ < pending_batch_.size() && over_limits()) {
+        release_accounting(pending_batch_[pending_index_]);
+        pending_batch_[pending_index_++].wire.reset();
+        dropped_oldest_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return pending_index_ < pending_batch_.size();
+}
+
+ssize_t ConnectedClient::write_pending(int flags) {
+    const size_t MAX_IOVECS = 256;
+    struct iovec iov[MAX_IOVECS];
+    size_t count = 0;
+    for (size_t i = pending_index_; i < pending_batch_.size() && count < MAX_IOVECS; ++i, ++count) {
+        const std::string& data = *pending_batch_[i].wire;
+        size_t skip = (i == pending_index_) ? pending_offset_ : 0;
+        iov[count].iov_base = const_cast<char*>(data.data() + skip);
+        iov[count].iov_len = data.size() - skip;
+    }
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = count;
+    int64_t start = StageMetrics::now();
+    ssize_t sent = sendmsg(socket_fd_, &msg, flags | MSG_NOSIGNAL);
+    if (sent <= 0) return sent;
+    TrafficCounters::bytes_out.add(static_cast<uint64_t>(sent));
+    int64_t end = StageMetrics::now();
+    StageMetrics::record(Stage::WRITE, start, end);
+
+    // Escrita parcial: avança pelos buffers completos e guarda o deslocamento no último
+    size_t remaining = static_cast<size_t>(sent);
+    while (remaining > 0) {
+        size_t left = pending_batch_[pending_index_].wire->size() - pending_offset_;
+        if (remaining < left) {
+            pending_offset_ += remaining;
+            break;
+        }
+        remaining -= left;
+        release_accounting(pending_batch_[pending_index_]);
+        StageMetrics::record(Stage::END_TO_END, pending_batch_[pending_index_].origin_ns, end);
+        pending_batch_[pending_index_++].wire.reset();
+        pending_offset_ = 0;
+    }
+    return sent;
 }
 
-std::string ConnectedClient::receive_data_blocking(std::string& read_buffer) {
-    return Utils::read_line(socket_fd_, read_buffer);
+bool ConnectedClient::receive_data_blocking(ReadBuffer& read_buffer, std::string_view& frame) {
+    return Utils::read_frame(socket_fd_, read_buffer, protocol_, frame);
 }
 
-} 
+void ConnectedClient::attach_to_reactor(std::function<void()> wake) {
+    reactor_wake_ = std::move(wake);
+}
 
+FlushResult ConnectedClient::flush_nonblocking() {
+    if (socket_fd_ == -1) return FlushResult::FAILED;
+    while (true) {
+        if (pending_index_ >= pending_batch_.size() && !take_batch()) return FlushResult::DONE;
+        ssize_t sent = write_pending(MSG_DONTWAIT);
+        if (sent < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return FlushResult::WOULD_BLOCK;
+            if (errno == EINTR) continue;
+            return FlushResult::FAILED;
+        }
+        if (sent == 0) return FlushResult::FAILED;
+    }
+}
+
+int ConnectedClient::release_socket() {
+    active_.store(false);
+    outgoing_messages_.shutdown();
+    int fd = socket_fd_;
+    socket_fd_ = -1;
+    return fd;
+}
 
+}
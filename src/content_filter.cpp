@@ -0,0 +1,211 @@
+#include "content_filter.h"
+#include "libtslog.h"
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <sys/stat.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <tmmintrin.h>
+#define CONTENT_FILTER_SSSE3 1
+#endif
+
+namespace chat {
+
+namespace {
+// Lista usada enquanto nenhum ficheiro for carregado
+const std::vector<std::string> DEFAULT_WORDS = {"palavraofeia", "chulao", "improprio"};
+
+uint8_t fold(uint8_t byte) {
+    return (byte >= 'A' && byte <= 'Z') ? static_cast<uint8_t>(byte + ('a' - 'A')) : byte;
+}
+
+#ifdef CONTENT_FILTER_SSSE3
+// Um byte é candidato se lo[nibble baixo] & hi[nibble alto] != 0. Compilado para
+// SSSE3 e escolhido em tempo de execução: o resto do binário não o exige.
+__attribute__((target("ssse3")))
+size_t scan_ssse3(const uint8_t* data, size_t from, size_t length, const uint8_t* lo_table,
+                  const uint8_t* hi_table) {
+    const __m128i lo_lut = _mm_load_si128(reinterpret_cast<const __m128i*>(lo_table));
+    const __m128i hi_lut = _mm_load_si128(reinterpret_cast<const __m128i*>(hi_table));
+    const __m128i nibble = _mm_set1_epi8(0x0f);
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = from;
+    for (; i + 16 <= length; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i lo = _mm_shuffle_epi8(lo_lut, _mm_and_si128(bytes, nibble));
+        __m128i hi = _mm_shuffle_epi8(hi_lut, _mm_and_si128(_mm_srli_epi16(bytes, 4), nibble));
+        int misses = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(lo, hi), zero));
+        if (misses != 0xffff) return i + __builtin_ctz(~misses & 0xffff);
+    }
+    return i;
+}
+
+bool detect_ssse3() {
+    // Pode correr antes de main(): inicializa primeiro a deteção do CPU
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("ssse3");
+}
+
+const bool HAS_SSSE3 = detect_ssse3();
+#endif
+}
+
+FilterAutomaton::FilterAutomaton(const std::vector<std::string>& words)
+    : word_count_(0), classes_(1) {
+    memset(class_of_, 0, sizeof(class_of_));
+    memset(start_bits_, 0, sizeof(start_bits_));
+    memset(start_lo_, 0, sizeof(start_lo_));
+    memset(start_hi_, 0, sizeof(start_hi_));
+
+    // Classe 0: bytes que não aparecem em nenhuma palavra
+    uint8_t folded_class[256] = {0};
+    for (const std::string& word : words) {
+        if (word.empty() || word.size() > MAX_WORD_LENGTH) continue;
+        for (unsigned char byte : word) {
+            uint8_t folded = fold(byte);
+            if (folded_class[folded] == 0) folded_class[folded] = static_cast<uint8_t>(classes_++);
+        }
+    }
+    for (int byte = 0; byte < 256; ++byte) class_of_[byte] = folded_class[fold(static_cast<uint8_t>(byte))];
+
+    // Trie das palavras, já na tabela densa (0 = sem transição, a raiz nunca é destino)
+    std::vector<uint8_t> own_len(1, 0);
+    delta_.assign(classes_, 0);
+    for (const std::string& word : words) {
+        if (word.empty() || word.size() > MAX_WORD_LENGTH) continue;
+        uint32_t state = 0;
+        for (unsigned char byte : word) {
+            uint32_t& next = delta_[state * classes_ + class_of_[byte]];
+            if (next == 0) {
+                next = static_cast<uint32_t>(own_len.size());
+                own_len.push_back(0);
+                delta_.resize(delta_.size() + classes_, 0);
+            }
+            state = delta_[state * classes_ + class_of_[byte]];
+        }
+        if (own_len[state] == 0) ++word_count_;
+        own_len[state] = static_cast<uint8_t>(word.size());
+
+        uint8_t first = static_cast<uint8_t>(word[0]);
+        for (uint8_t byte : {fold(first), static_cast<uint8_t>(first >= 'a' && first <= 'z' ? first - ('a' - 'A') : first)}) {
+            start_bits_[byte >> 6] |= uint64_t(1) << (byte & 63);
+            // Balde pelo nibble alto módulo 8: junta só bytes < 0x80 com >= 0x80
+            uint8_t bucket = static_cast<uint8_t>(1u << ((byte >> 4) & 7));
+            start_lo_[byte & 15] |= bucket;
+            start_hi_[byte >> 4] = bucket;
+        }
+    }
+
+    // BFS: as transições em falta herdam as do estado de falha, o que torna o
+    // autómato determinístico; out_len acumula as palavras que são sufixos
+    size_t states = own_len.size();
+    out_len_ = own_len;
+    std::vector<uint32_t> fail(states, 0);
+    std::deque<uint32_t> queue;
+    for (uint32_t c = 0; c < classes_; ++c) {
+        if (c != 0 && delta_[c] != 0) queue.push_back(delta_[c]);
+    }
+    while (!queue.empty()) {
+        uint32_t state = queue.front();
+        queue.pop_front();
+        if (out_len_[fail[state]] > out_len_[state]) out_len_[state] = out_len_[fail[state]];
+        for (uint32_t c = 0; c < classes_; ++c) {
+            uint32_t& next = delta_[state * classes_ + c];
+            uint32_t fallback = delta_[fail[state] * classes_ + c];
+            if (c != 0 && next != 0) {
+                fail[next] = fallback;
+                queue.push_back(next);
+            } else {
+                next = fallback;
+            }
+        }
+    }
+}
+
+size_t FilterAutomaton::next_candidate(const uint8_t* data, size_t from, size_t length) const {
+    size_t i = from;
+#ifdef CONTENT_FILTER_SSSE3
+    if (HAS_SSSE3) i = scan_ssse3(data, i, length, start_lo_, start_hi_);
+#endif
+    while (i < length && !is_start(data[i])) ++i;
+    return i;
+}
+
+size_t FilterAutomaton::mask(char* data, size_t length) const {
+    if (word_count_ == 0) return 0;
+    uint8_t* bytes = reinterpret_cast<uint8_t*>(data);
+    size_t matches = 0;
+    uint32_t state = 0;
+    for (size_t i = 0; i < length; ++i) {
+        if (state == 0) {
+            // Na raiz, os bytes que não iniciam palavras deixam-na na raiz: salta-os
+            i = next_candidate(bytes, i, length);
+            if (i >= length) break;
+        }
+        state = delta_[state * classes_ + class_of_[bytes[i]]];
+        size_t len = out_len_[state];
+        if (len == 0) continue;
+        // Só bytes já consumidos: mascarar no próprio buffer não afeta a procura
+        memset(bytes + i + 1 - len, '*', len);
+        ++matches;
+    }
+    return matches;
+}
+
+ContentFilter::ContentFilter()
+    : automaton_(std::make_shared<const FilterAutomaton>(DEFAULT_WORDS)), filtered_(0),
+      file_mtime_ns_(0), file_size_(-1) {}
+
+bool ContentFilter::load_file(const std::string& path) {
+    std::lock_guard<std::mutex> lock(file_mutex_);
+    // Vigiado mesmo que ainda não exista: tamanho -1 força o carregamento quando aparecer
+    path_ = path;
+    file_size_ = -1;
+    struct stat info;
+    std::ifstream file(path);
+    if (!file.is_open() || stat(path.c_str(), &info) != 0) {
+        LOG_ERROR("Não foi possível abrir a lista de palavras " + path);
+        return false;
+    }
+
+    std::vector<std::string> words;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty() || line[0] == '#') continue;
+        words.push_back(std::move(line));
+    }
+
+    // Compilado fora de qualquer lock partilhado: quem filtra continua com o anterior
+    auto automaton = std::make_shared<const FilterAutomaton>(words);
+    std::atomic_store(&automaton_, std::shared_ptr<const FilterAutomaton>(automaton));
+    file_mtime_ns_ = static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000LL + info.st_mtim.tv_nsec;
+    file_size_ = static_cast<int64_t>(info.st_size);
+    LOG_INFO("Filtro de conteúdo carregado de " + path + ": " + std::to_string(automaton->word_count()) +
+             " palavras, " + std::to_string(automaton->state_count()) + " estados");
+    return true;
+}
+
+bool ContentFilter::reload_if_changed() {
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(file_mutex_);
+        if (path_.empty()) return false;
+        struct stat info;
+        if (stat(path_.c_str(), &info) != 0) return false;
+        int64_t mtime = static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000LL + info.st_mtim.tv_nsec;
+        if (mtime == file_mtime_ns_ && static_cast<int64_t>(info.st_size) == file_size_) return false;
+        path = path_;
+    }
+    return load_file(path);
+}
+
+bool ContentFilter::apply(char* text) const {
+    std::shared_ptr<const FilterAutomaton> automaton = current();
+    if (automaton->mask(text, strlen(text)) == 0) return false;
+    filtered_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+}
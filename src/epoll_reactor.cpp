@@ -0,0 +1,342 @@
+#include "epoll_reactor.h"
+#include "libtslog.h"
+#include "stage_metrics.h"
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace chat {
+
+namespace {
+const int MAX_EVENTS = 256;
+
+bool set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags != -1 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) != -1;
+}
+}
+
+EpollReactor::EpollReactor(int num_loops, Callbacks callbacks, TimerWheel* timers,
+                           std::chrono::milliseconds handshake_timeout)
+    : callbacks_(std::move(callbacks)), running_(false), next_loop_(0), timers_(timers),
+      handshake_timeout_(handshake_timeout), handshake_timeouts_(0) {
+    if (num_loops <= 0) {
+        num_loops = static_cast<int>(std::thread::hardware_concurrency());
+        if (num_loops <= 0) num_loops = 1;
+    }
+    for (int i = 0; i < num_loops; ++i) {
+        loops_.push_back(std::make_unique<Loop>());
+    }
+}
+
+EpollReactor::~EpollReactor() {
+    stop();
+}
+
+bool EpollReactor::start() {
+    if (running_.exchange(true)) return false;
+
+    for (auto& loop : loops_) {
+        loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        loop->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (loop->epoll_fd < 0 || loop->wake_fd < 0) {
+            LOG_ERROR("Falha ao criar epoll/eventfd: " + std::string(strerror(errno)));
+            running_.store(false);
+            return false;
+        }
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.fd = loop->wake_fd;
+        epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, loop->wake_fd, &ev);
+    }
+
+    for (auto& loop : loops_) {
+        Loop* raw = loop.get();
+        loop->thread = std::thread([this, raw]{ run_loop(*raw); });
+    }
+    LOG_INFO("Reactor epoll iniciado com " + std::to_string(loops_.size()) + " event loops");
+    return true;
+}
+
+void EpollReactor::stop() {
+    if (!running_.exchange(false)) return;
+
+    for (auto& loop : loops_) wake(*loop);
+    for (auto& loop : loops_) {
+        if (loop->thread.joinable()) loop->thread.join();
+    }
+
+    for (auto& loop : loops_) {
+        std::vector<int> fds;
+        for (auto const& [fd, _] : loop->sessions) fds.push_back(fd);
+        for (int fd : fds) close_session(*loop, fd, false);
+        for (auto& pending : loop->pending_new) close(pending.first);
+        loop->pending_new.clear();
+        for (auto& completed : loop->pending_handshakes) {
+            if (completed.result.client) completed.result.client->release_socket();
+        }
+        loop->pending_handshakes.clear();
+        loop->pending_timeouts.clear();
+        if (loop->wake_fd != -1) { close(loop->wake_fd); loop->wake_fd = -1; }
+        if (loop->epoll_fd != -1) { close(loop->epoll_fd); loop->epoll_fd = -1; }
+    }
+}
+
+void EpollReactor::add_connection(int fd, const std::string& addr) {
+    if (!running_.load() || !set_nonblocking(fd)) {
+        close(fd);
+        return;
+    }
+    Loop& loop = *loops_[next_loop_.fetch_add(1) % loops_.size()];
+    {
+        std::lock_guard<ProfiledMutex> lock(loop.pending_mutex);
+        loop.pending_new.emplace_back(fd, addr);
+    }
+    wake(loop);
+}
+
+void EpollReactor::add_connections(std::vector<std::pair<int, std::string>>& conns) {
+    if (!running_.load()) {
+        for (auto& conn : conns) close(conn.first);
+        return;
+    }
+    size_t first = next_loop_.fetch_add(static_cast<unsigned>(conns.size()));
+    size_t used = std::min(conns.size(), loops_.size());
+    for (size_t offset = 0; offset < used; ++offset) {
+        Loop& loop = *loops_[(first + offset) % loops_.size()];
+        {
+            std::lock_guard<ProfiledMutex> lock(loop.pending_mutex);
+            for (size_t i = offset; i < conns.size(); i += loops_.size()) {
+                loop.pending_new.push_back(std::move(conns[i]));
+            }
+        }
+        wake(loop);
+    }
+}
+
+void EpollReactor::wake(Loop& loop) {
+    uint64_t one = 1;
+    ssize_t ignored = write(loop.wake_fd, &one, sizeof(one));
+    (void)ignored;
+}
+
+void EpollReactor::request_flush(Loop& loop, int fd) {
+    {
+        std::lock_guard<ProfiledMutex> lock(loop.pending_mutex);
+        loop.pending_flush.push_back(fd);
+    }
+    wake(loop);
+}
+
+void EpollReactor::register_pending(Loop& loop) {
+    std::vector<std::pair<int, std::string>> new_conns;
+    std::vector<int> flushes;
+    std::vector<CompletedHandshake> handshakes;
+    std::vector<std::pair<int, uint64_t>> timeouts;
+    {
+        std::lock_guard<ProfiledMutex> lock(loop.pending_mutex);
+        new_conns.swap(loop.pending_new);
+        flushes.swap(loop.pending_flush);
+        handshakes.swap(loop.pending_handshakes);
+        timeouts.swap(loop.pending_timeouts);
+    }
+
+    for (auto& [fd, addr] : new_conns) {
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.fd = fd;
+        if (epoll_ctl(loop.epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            LOG_ERROR("Falha ao registar socket no epoll: " + std::string(strerror(errno)));
+            close(fd);
+            continue;
+        }
+        uint64_t id = ++loop.next_session_id;
+        Session& session = loop.sessions[fd];
+        session = Session{fd, id, addr, std::make_unique<ReadBuffer>(), ProtocolVersion::V1_TEXT, false, nullptr, {}, 0};
+        if (timers_ && handshake_timeout_.count() > 0) {
+            // O callback corre na thread da roda: só avisa o loop, que é quem fecha
+            session.deadline = timers_->schedule(handshake_timeout_, [this, &loop, fd, id]{
+                {
+                    std::lock_guard<ProfiledMutex> lock(loop.pending_mutex);
+                    loop.pending_timeouts.emplace_back(fd, id);
+                }
+                wake(loop);
+            });
+        }
+    }
+
+    for (auto& [fd, id] : timeouts) {
+        auto it = loop.sessions.find(fd);
+        if (it == loop.sessions.end() || it->second.id != id) continue;
+        if (it->second.client || it->second.authenticating) continue;
+        handshake_timeouts_.fetch_add(1, std::memory_order_relaxed);
+        LOG_WARNING("Cliente " + it->second.addr + " não se autenticou a tempo, conexão fechada.");
+        close_session(loop, fd, false);
+    }
+
+    for (auto& completed : handshakes) complete_handshake(loop, completed);
+
+    for (int fd : flushes) {
+        auto it = loop.sessions.find(fd);
+        if (it == loop.sessions.end() || !it->second.client) continue;
+        if (!it->second.client->is_active()) {
+            close_session(loop, fd, true);
+            continue;
+        }
+        handle_writable(it->second);
+        if (!it->second.client->is_active()) close_session(loop, fd, true);
+    }
+}
+
+void EpollReactor::run_loop(Loop& loop) {
+    struct epoll_event events[MAX_EVENTS];
+    while (running_.load()) {
+        int n = epoll_wait(loop.epoll_fd, events, MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            LOG_ERROR("Falha no epoll_wait: " + std::string(strerror(errno)));
+            break;
+        }
+        for (int i = 0; i < n && running_.load(); ++i) {
+            int fd = events[i].data.fd;
+            if (fd == loop.wake_fd) {
+                uint64_t counter;
+                while (read(loop.wake_fd, &counter, sizeof(counter)) > 0) {}
+                register_pending(loop);
+                continue;
+            }
+
+            auto it = loop.sessions.find(fd);
+            if (it == loop.sessions.end()) continue;
+
+            uint32_t flags = events[i].events;
+            if (flags & EPOLLERR) {
+                close_session(loop, fd, true);
+                continue;
+            }
+            if (flags & EPOLLOUT) {
+                handle_writable(it->second);
+            }
+            if (flags & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) {
+                handle_readable(loop, it->second);
+            }
+        }
+    }
+}
+
+void EpollReactor::complete_handshake(Loop& loop, CompletedHandshake& completed) {
+    std::shared_ptr<ConnectedClient>& client = completed.result.client;
+    auto it = loop.sessions.find(completed.fd);
+    if (it == loop.sessions.end() || it->second.id != completed.session_id) {
+        // A conexão fechou durante a autenticação; o fd pode já ser de outra sessão
+        if (client) {
+            if (callbacks_.on_close) callbacks_.on_close(client);
+            client->release_socket();
+        }
+        return;
+    }
+
+    Session& session = it->second;
+    session.authenticating = false;
+    if (!client) {
+        // Resposta curta num socket recém-aceite: cabe no buffer do kernel
+        const WireBuffer& reply = completed.result.reply;
+        if (reply) send(session.fd, reply->data(), reply->size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+        close_session(loop, session.fd, false);
+        return;
+    }
+
+    session.client = std::move(client);
+    handle_writable(session);
+    // Frames que o cliente enviou logo a seguir ao pedido de autenticação
+    if (process_frames(loop, session) && !session.client->is_active()) {
+        close_session(loop, session.fd, true);
+    }
+}
+
+void EpollReactor::handle_readable(Loop& loop, Session& session) {
+    int fd = session.fd;
+    ReadBuffer& buffer = *session.read_buffer;
+    while (true) {
+        int64_t start = StageMetrics::now();
+        ssize_t n = buffer.fill(fd, MSG_DONTWAIT);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+        if (n <= 0) {
+            close_session(loop, fd, true);
+            return;
+        }
+        session.read_ns = StageMetrics::now();
+        StageMetrics::record(Stage::READ, start, session.read_ns);
+
+        // O primeiro byte recebido decide o protocolo da sessão
+        if (!session.client && !session.authenticating) {
+            session.protocol = Utils::detect_protocol(buffer);
+        }
+        if (!process_frames(loop, session)) return;
+    }
+}
+
+// Retorna false se a sessão foi fechada (a referência deixa de ser válida)
+bool EpollReactor::process_frames(Loop& loop, Session& session) {
+    int fd = session.fd;
+    // As views só valem até o próximo fill(): processa tudo antes de ler de novo
+    std::string_view frame;
+    while (!session.authenticating && Utils::next_frame(*session.read_buffer, session.protocol, frame)) {
+        if (!session.client) {
+            session.authenticating = true;
+            session.deadline.cancel();
+            uint64_t id = session.id;
+            auto wake_fn = [this, &loop, fd]{ request_flush(loop, fd); };
+            auto done_fn = [this, &loop, fd, id](HandshakeResult result) {
+                {
+                    std::lock_guard<ProfiledMutex> lock(loop.pending_mutex);
+                    loop.pending_handshakes.push_back(CompletedHandshake{fd, id, std::move(result)});
+                }
+                wake(loop);
+            };
+            callbacks_.on_handshake(fd, session.addr, frame, session.protocol, wake_fn, done_fn);
+            continue;
+        }
+
+        callbacks_.on_message(session.client, frame, session.read_ns);
+        if (!session.client->is_active()) {
+            close_session(loop, fd, true);
+            return false;
+        }
+    }
+    return true;
+}
+
+void EpollReactor::handle_writable(Session& session) {
+    if (!session.client) return;
+    if (session.client->flush_nonblocking() == FlushResult::FAILED) {
+        session.client->disconnect();
+    }
+}
+
+void EpollReactor::close_session(Loop& loop, int fd, bool notify) {
+    auto it = loop.sessions.find(fd);
+    if (it == loop.sessions.end()) return;
+
+    std::shared_ptr<ConnectedClient> client = std::move(it->second.client);
+    // Síncrono: depois disto o callback do prazo já não toca neste loop
+    it->second.deadline.cancel();
+    loop.sessions.erase(it);
+    epoll_ctl(loop.epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+
+    if (client) {
+        if (notify && callbacks_.on_close) callbacks_.on_close(client);
+        client->release_socket();
+    }
+    close(fd);
+}
+
+}
@@ -0,0 +1,128 @@
+#include "fanout_pool.h"
+#include "stage_metrics.h"
+
+namespace chat {
+
+FanoutPool::FanoutPool(int workers, size_t threshold)
+    : worker_count_(workers), threshold_(threshold), running_(false), pending_jobs_(0),
+      inline_jobs_(0), parallel_jobs_(0), next_seq_(1), completed_seq_(0), progress_waiters_(0) {
+    if (worker_count_ <= 0) {
+        worker_count_ = static_cast<int>(std::thread::hardware_concurrency());
+        if (worker_count_ <= 0) worker_count_ = 1;
+    }
+}
+
+FanoutPool::~FanoutPool() {
+    stop();
+}
+
+void FanoutPool::start() {
+    if (threshold_ == 0 || running_.exchange(true)) return;
+    for (int i = 0; i < worker_count_; ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        workers_[i]->thread = std::thread(&FanoutPool::worker_loop, this, i);
+    }
+}
+
+void FanoutPool::stop() {
+    {
+        std::lock_guard<ProfiledMutex> lock(submit_mutex_);
+        if (!running_.exchange(false)) return;
+    }
+    for (auto& worker : workers_) worker->queue.shutdown();
+    for (auto& worker : workers_) {
+        if (worker->thread.joinable()) worker->thread.join();
+    }
+    workers_.clear();
+}
+
+void FanoutPool::deliver(std::shared_ptr<const ClientList> recipients, const Message& msg,
+                         const ConnectedClient* skip) {
+    if (!recipients || recipients->empty()) return;
+    int64_t start = StageMetrics::now();
+
+    if (!running_.load(std::memory_order_acquire) ||
+        (recipients->size() < threshold_ && pending_jobs_.load(std::memory_order_acquire) == 0)) {
+        inline_jobs_.fetch_add(1, std::memory_order_relaxed);
+        WireCache wires(msg);
+        for (const auto& client : *recipients) {
+            if (client && client.get() != skip) client->queue_wire(wires.get(client->get_protocol()), msg.received_ns);
+        }
+        StageMetrics::record(Stage::FANOUT, start, StageMetrics::now());
+        return;
+    }
+
+    // Os workers partilham os buffers: codifica as duas versões já aqui
+    auto job = std::make_shared<Job>();
+    job->recipients = std::move(recipients);
+    job->skip = skip;
+    job->v1 = msg.to_wire(ProtocolVersion::V1_TEXT);
+    job->v2 = msg.to_wire(ProtocolVersion::V2_BINARY);
+    job->origin_ns = msg.received_ns;
+
+    std::lock_guard<ProfiledMutex> lock(submit_mutex_);
+    if (!running_.load()) {
+        for (const auto& client : *job->recipients) {
+            if (client && client.get() != skip) {
+                client->queue_wire(client->get_protocol() == ProtocolVersion::V1_TEXT ? job->v1 : job->v2,
+                                   job->origin_ns);
+            }
+        }
+        return;
+    }
+    job->seq = next_seq_++;
+    job->remaining.store(static_cast<int>(workers_.size()), std::memory_order_relaxed);
+    pending_jobs_.fetch_add(1, std::memory_order_acq_rel);
+    parallel_jobs_.fetch_add(1, std::memory_order_relaxed);
+    for (auto& worker : workers_) {
+        JobPtr copy = job;
+        // Fila cheia: quem envia espera pelo worker mais lento (contrapressão)
+        while (!worker->queue.push(std::move(copy))) std::this_thread::yield();
+    }
+    StageMetrics::record(Stage::FANOUT, start, StageMetrics::now());
+}
+
+void FanoutPool::run_slice(size_t index, Job& job) {
+    // Um cliente desta fatia pode ter estado noutra no job anterior
+    if (completed_seq_.load() + 1 < job.seq) {
+        std::unique_lock<std::mutex> lock(progress_mutex_);
+        progress_waiters_.fetch_add(1);
+        progress_cv_.wait(lock, [this, &job]{ return completed_seq_.load() + 1 >= job.seq; });
+        progress_waiters_.fetch_sub(1);
+    }
+
+    const ClientList& clients = *job.recipients;
+    size_t begin = clients.size() * index / workers_.size();
+    size_t end = clients.size() * (index + 1) / workers_.size();
+    for (size_t i = begin; i < end; ++i) {
+        const auto& client = clients[i];
+        if (!client || client.get() == job.skip) continue;
+        client->queue_wire(client->get_protocol() == ProtocolVersion::V1_TEXT ? job.v1 : job.v2, job.origin_ns);
+    }
+
+    if (job.remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        completed_seq_.store(job.seq);
+        if (progress_waiters_.load() > 0) {
+            // Quem esperava já testou o predicado com o mutex ou está dentro do wait()
+            { std::lock_guard<std::mutex> lock(progress_mutex_); }
+            progress_cv_.notify_all();
+        }
+        pending_jobs_.fetch_sub(1, std::memory_order_acq_rel);
+    }
+}
+
+void FanoutPool::worker_loop(size_t index) {
+    auto run = [this, index](JobPtr&& job) { run_slice(index, *job); };
+
+    // Dorme no eventfd da fila até haver jobs; o shutdown() também a acorda
+    MpscQueue<JobPtr>& queue = workers_[index]->queue;
+    while (!queue.is_shutdown()) {
+        queue.wait();
+        queue.pop_all(run);
+    }
+    queue.pop_all(run);
+}
+
+}
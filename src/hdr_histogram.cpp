@@ -0,0 +1,62 @@
+#include "hdr_histogram.h"
+
+namespace chat {
+
+void HdrHistogram::merge(const HdrHistogram& other) {
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        uint64_t count = other.counts_[i].load(std::memory_order_relaxed);
+        if (count) counts_[i].fetch_add(count, std::memory_order_relaxed);
+    }
+    total_.fetch_add(other.total_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    sum_.fetch_add(other.sum_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    uint64_t other_max = other.max_.load(std::memory_order_relaxed);
+    uint64_t max = max_.load(std::memory_order_relaxed);
+    while (other_max > max && !max_.compare_exchange_weak(max, other_max, std::memory_order_relaxed)) {}
+}
+
+void HdrHistogram::reset() {
+    for (auto& count : counts_) count.store(0, std::memory_order_relaxed);
+    total_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+double HdrHistogram::mean() const {
+    uint64_t total = count();
+    return total ? static_cast<double>(sum_.load(std::memory_order_relaxed)) / total : 0.0;
+}
+
+uint64_t HdrHistogram::upper_bound_of(size_t bucket) {
+    if (bucket < 2 * SUB_BUCKETS) return bucket;
+    uint64_t shift = bucket / SUB_BUCKETS - 1;
+    uint64_t sub = bucket % SUB_BUCKETS + SUB_BUCKETS;
+    return ((sub + 1) << shift) - 1;
+}
+
+uint64_t HdrHistogram::percentile(double q) const {
+    // Os buckets são lidos um a um: com escritas concorrentes o total pode não
+    // bater certo com a soma, por isso o alvo usa a soma efetivamente lida
+    uint64_t counts[BUCKETS];
+    uint64_t total = 0;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        counts[i] = counts_[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    if (total == 0) return 0;
+    if (q < 0) q = 0;
+    if (q > 1) q = 1;
+    uint64_t target = static_cast<uint64_t>(q * total + 0.5);
+    if (target == 0) target = 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        seen += counts[i];
+        if (seen >= target) {
+            uint64_t bound = upper_bound_of(i);
+            uint64_t max = max_.load(std::memory_order_relaxed);
+            return bound < max ? bound : max;
+        }
+    }
+    return max_.load(std::memory_order_relaxed);
+}
+
+}
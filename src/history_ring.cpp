@@ -0,0 +1,59 @@
+#include "history_ring.h"
+#include <algorithm>
+
+namespace chat {
+
+HistoryRing::HistoryRing(size_t capacity) : slots_(capacity), last_seq_(0), first_seq_(1) {
+    static const char HEX[] = "0123456789abcdef";
+    uint8_t random[6];
+    Utils::random_bytes(random, sizeof(random));
+    for (uint8_t byte : random) {
+        epoch_ += HEX[byte >> 4];
+        epoch_ += HEX[byte & 15];
+    }
+}
+
+uint64_t HistoryRing::append(Message& msg) {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    msg.seq = ++last_seq_;
+    if (!slots_.empty()) slots_[msg.seq % slots_.size()] = msg;
+    return msg.seq;
+}
+
+void HistoryRing::resume_from(uint64_t seq) {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    last_seq_ = seq;
+    first_seq_ = seq + 1;
+}
+
+size_t HistoryRing::encode_since(uint64_t since, ProtocolVersion version, std::string& out) const {
+    std::vector<Message> backlog;
+    {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        if (slots_.empty() || since >= last_seq_) return 0;
+        uint64_t oldest = std::max(first_seq_, last_seq_ >= slots_.size() ? last_seq_ - slots_.size() + 1 : 1);
+        uint64_t first = std::max(since + 1, oldest);
+        backlog.reserve(last_seq_ - first + 1);
+        for (uint64_t seq = first; seq <= last_seq_; ++seq) {
+            backlog.push_back(slots_[seq % slots_.size()]);
+        }
+    }
+
+    // A codificação fica fora do lock: os broadcasts não esperam pelo replay
+    for (const Message& msg : backlog) {
+        if (version == ProtocolVersion::V2_BINARY) {
+            msg.serialize_binary(out);
+        } else {
+            out += msg.serialize();
+            out += '\n';
+        }
+    }
+    return backlog.size();
+}
+
+uint64_t HistoryRing::last_seq() const {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    return last_seq_;
+}
+
+}
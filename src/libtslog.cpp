@@ -2,15 +2,17 @@
 #include <iostream>
 #include <iomanip>
 #include <thread>
+#include <cstdio>
+#include <ctime>
 
 namespace tslog {
 
 // Inicialização dos membros estáticos
 std::unique_ptr<Logger> Logger::instance_ = nullptr;
-std::mutex Logger::instance_mutex_;
+chat::ProfiledMutex Logger::instance_mutex_("log.instance");
 
 Logger& Logger::getInstance() {
-    std::lock_guard<std::mutex> lock(instance_mutex_);
+    std::lock_guard<chat::ProfiledMutex> lock(instance_mutex_);
     if (!instance_) {
         instance_ = std::unique_ptr<Logger>(new Logger());
         // Configuração padrão inicial
@@ -22,8 +24,14 @@ Logger& Logger::getInstance() {
 void Logger::configure(const std::string& filename, 
                        LogLevel min_level,
                        bool console, 
-                       bool file) {
-    std::lock_guard<std::mutex> lock(log_mutex_);
+                       bool file,
+                       LogMode mode,
+                       const AsyncOptions& async_options) {
+    // Novos registos passam pelo caminho síncrono até a reconfiguração terminar
+    async_.store(false);
+    stop_writer();
+
+    std::lock_guard<chat::ProfiledMutex> lock(log_mutex_);
     
     min_level_ = min_level;
     console_output_ = console;
@@ -41,12 +49,29 @@ void Logger::configure(const std::string& filename,
             file_output_ = false;
         }
     }
+
+    if (mode == LogMode::ASYNC) {
+        if (!ring_ || ring_->capacity() < async_options.ring_capacity) {
+            ring_ = std::make_unique<MpscRing<LogRecord>>(async_options.ring_capacity);
+            // O flush() compara written_ com o enqueued() do anel: um anel novo recomeça do zero
+            // (a thread de escrita está parada e esvaziou o anterior)
+            written_.store(0);
+        }
+        async_options_ = async_options;
+        start_writer();
+        async_.store(true);
+    }
 }
 
 void Logger::log(LogLevel level, const std::string& message) {
     if (level < min_level_) {
         return;
     }
+
+    if (async_.load(std::memory_order_acquire)) {
+        enqueue(level, message);
+        return;
+    }
     
     // Formata a mensagem fora do lock para otimizar
     std::stringstream formatted_msg;
@@ -58,7 +83,7 @@ void Logger::log(LogLevel level, const std::string& message) {
     std::string final_msg = formatted_msg.str();
     
     // Bloqueia apenas para a escrita
-    std::lock_guard<std::mutex> lock(log_mutex_);
+    std::lock_guard<chat::ProfiledMutex> lock(log_mutex_);
     
     if (console_output_) {
         if (level >= LogLevel::ERROR) {
@@ -93,8 +118,141 @@ void Logger::critical(const std::string& message) {
     log(LogLevel::CRITICAL, message);
 }
 
+void Logger::enqueue(LogLevel level, const std::string& message) {
+    // Formatação (timestamp, id da thread) fica para a thread de escrita
+    LogRecord record{level, std::chrono::system_clock::now(), std::this_thread::get_id(), message};
+    if (ring_->try_push(std::move(record))) {
+        wake_writer();
+        return;
+    }
+
+    if (async_options_.overflow == OverflowPolicy::BLOCK) {
+        // try_push só move o registo quando tem sucesso
+        while (!ring_->try_push(std::move(record))) {
+            wake_writer();
+            std::this_thread::yield();
+        }
+        wake_writer();
+    } else {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void Logger::wake_writer() {
+    if (writer_idle_.load(std::memory_order_relaxed)) {
+        writer_cv_.notify_one();
+    }
+}
+
+void Logger::start_writer() {
+    writer_running_.store(true);
+    writer_thread_ = std::thread(&Logger::writer_loop, this);
+}
+
+void Logger::stop_writer() {
+    if (!writer_running_.exchange(false)) return;
+    writer_cv_.notify_one();
+    if (writer_thread_.joinable()) writer_thread_.join();
+}
+
+void Logger::writer_loop() {
+    const size_t MAX_BATCH = 512;
+    std::string out_batch, err_batch, file_batch;
+    LogRecord record;
+    auto last_flush = std::chrono::steady_clock::now();
+    uint64_t reported_drops = dropped_.load();
+
+    // Caches da formatação: a data só muda uma vez por segundo e os lotes
+    // costumam vir de poucas threads
+    std::time_t cached_second = -1;
+    std::string cached_date;
+    std::thread::id cached_thread;
+    std::string cached_thread_str = format_thread_id(cached_thread);
+    auto format_time = [&](std::chrono::system_clock::time_point time) {
+        std::time_t second = std::chrono::system_clock::to_time_t(time);
+        if (second != cached_second) {
+            std::stringstream ss;
+            ss << std::put_time(std::localtime(&second), "%Y-%m-%d %H:%M:%S");
+            cached_date = ss.str();
+            cached_second = second;
+        }
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()) % 1000;
+        char millis[8];
+        snprintf(millis, sizeof(millis), ".%03d", static_cast<int>(ms.count()));
+        return cached_date + millis;
+    };
+
+    while (true) {
+        size_t count = 0;
+        while (count < MAX_BATCH && ring_->try_pop(record)) {
+            if (record.thread != cached_thread) {
+                cached_thread = record.thread;
+                cached_thread_str = format_thread_id(cached_thread);
+            }
+            std::string line = "[" + format_time(record.time) + "]"
+                             + "[" + level_to_string(record.level) + "]"
+                             + "[" + cached_thread_str + "] "
+                             + record.message + "\n";
+            if (console_output_) {
+                (record.level >= LogLevel::ERROR ? err_batch : out_batch) += line;
+            }
+            if (file_output_) file_batch += line;
+            ++count;
+        }
+
+        if (async_options_.overflow == OverflowPolicy::DROP_AND_REPORT) {
+            uint64_t drops = dropped_.load(std::memory_order_relaxed);
+            if (drops != reported_drops) {
+                std::string line = "[" + get_timestamp() + "][" + level_to_string(LogLevel::WARNING) +
+                                   "][" + get_thread_id() + "] [TSLOG] " +
+                                   std::to_string(drops - reported_drops) +
+                                   " registos descartados (anel cheio)\n";
+                if (console_output_) err_batch += line;
+                if (file_output_) file_batch += line;
+                reported_drops = drops;
+            }
+        }
+
+        if (!out_batch.empty()) { std::cout << out_batch; out_batch.clear(); }
+        if (!err_batch.empty()) { std::cerr << err_batch; err_batch.clear(); }
+        if (!file_batch.empty() && log_file_.is_open()) { log_file_ << file_batch; file_batch.clear(); }
+        written_.fetch_add(count, std::memory_order_release);
+
+        if (count == MAX_BATCH) continue;
+
+        auto now = std::chrono::steady_clock::now();
+        bool stopping = !writer_running_.load();
+        if (flush_requested_.load() || stopping || now - last_flush >= async_options_.flush_interval) {
+            if (log_file_.is_open()) log_file_.flush();
+            std::cout.flush();
+            last_flush = now;
+            flush_requested_.store(false);
+        }
+        if (stopping && ring_->size_approx() == 0) break;
+
+        std::unique_lock<std::mutex> lock(writer_mutex_);
+        writer_idle_.store(true);
+        writer_cv_.wait_for(lock, async_options_.flush_interval, [this]{
+            return ring_->size_approx() > 0 || flush_requested_.load() || !writer_running_.load();
+        });
+        writer_idle_.store(false);
+    }
+}
+
 void Logger::flush() {
-    std::lock_guard<std::mutex> lock(log_mutex_);
+    if (async_.load()) {
+        uint64_t target = ring_->enqueued();
+        flush_requested_.store(true);
+        writer_cv_.notify_one();
+        while (writer_running_.load() &&
+               (written_.load(std::memory_order_acquire) < target || flush_requested_.load())) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            writer_cv_.notify_one();
+        }
+        return;
+    }
+
+    std::lock_guard<chat::ProfiledMutex> lock(log_mutex_);
     if (log_file_.is_open()) {
         log_file_.flush();
     }
@@ -103,7 +261,10 @@ void Logger::flush() {
 }
 
 std::string Logger::get_timestamp() const {
-    auto now = std::chrono::system_clock::now();
+    return format_timestamp(std::chrono::system_clock::now());
+}
+
+std::string Logger::format_timestamp(std::chrono::system_clock::time_point now) const {
     auto time_t_now = std::chrono::system_clock::to_time_t(now);
     auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()) % 1000;
     
@@ -126,12 +287,18 @@ std::string Logger::level_to_string(LogLevel level) const {
 }
 
 std::string Logger::get_thread_id() const {
+    return format_thread_id(std::this_thread::get_id());
+}
+
+std::string Logger::format_thread_id(std::thread::id id) const {
     std::stringstream ss;
-    ss << std::this_thread::get_id();
+    ss << id;
     return ss.str();
 }
 
 Logger::~Logger() {
+    async_.store(false);
+    stop_writer();
     if (log_file_.is_open()) {
         log_file_.close();
     }
@@ -0,0 +1,219 @@
+#include "password_hash.h"
+#include "chat_common.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace chat {
+
+namespace {
+const char* HASH_PREFIX = "pbkdf2$";
+
+// SHA-256 (FIPS 180-4), só o necessário para o HMAC
+struct Sha256 {
+    uint32_t state[8];
+    uint8_t block[64];
+    size_t block_len;
+    uint64_t total_len;
+
+    static uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+    Sha256() { reset(); }
+
+    void reset() {
+        static const uint32_t INIT[8] = {
+            0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+            0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+        };
+        memcpy(state, INIT, sizeof(state));
+        block_len = 0;
+        total_len = 0;
+    }
+
+    void compress(const uint8_t* data) {
+        static const uint32_t K[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+        };
+        uint32_t w[64];
+        for (int i = 0; i < 16; ++i) {
+            w[i] = (uint32_t(data[i * 4]) << 24) | (uint32_t(data[i * 4 + 1]) << 16) |
+                   (uint32_t(data[i * 4 + 2]) << 8) | uint32_t(data[i * 4 + 3]);
+        }
+        for (int i = 16; i < 64; ++i) {
+            uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 64; ++i) {
+            uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+            uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g; g = f; f = e; e = d + t1;
+            d = c; c = b; b = a; a = t1 + t2;
+        }
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+    }
+
+    void update(const uint8_t* data, size_t len) {
+        total_len += len;
+        while (len > 0) {
+            size_t take = std::min(len, sizeof(block) - block_len);
+            memcpy(block + block_len, data, take);
+            block_len += take;
+            data += take;
+            len -= take;
+            if (block_len == sizeof(block)) {
+                compress(block);
+                block_len = 0;
+            }
+        }
+    }
+
+    void final(uint8_t out[32]) {
+        uint64_t bits = total_len * 8;
+        uint8_t pad = 0x80;
+        update(&pad, 1);
+        uint8_t zero = 0;
+        while (block_len != 56) update(&zero, 1);
+        uint8_t len_be[8];
+        for (int i = 0; i < 8; ++i) len_be[i] = static_cast<uint8_t>(bits >> (56 - 8 * i));
+        update(len_be, 8);
+        for (int i = 0; i < 8; ++i) {
+            out[i * 4] = static_cast<uint8_t>(state[i] >> 24);
+            out[i * 4 + 1] = static_cast<uint8_t>(state[i] >> 16);
+            out[i * 4 + 2] = static_cast<uint8_t>(state[i] >> 8);
+            out[i * 4 + 3] = static_cast<uint8_t>(state[i]);
+        }
+    }
+};
+
+// HMAC com os estados interno e externo pré-calculados: cada iteração do
+// PBKDF2 custa só duas compressões em vez de quatro
+struct HmacSha256 {
+    Sha256 inner, outer;
+
+    explicit HmacSha256(const std::string& key) {
+        uint8_t k[64] = {0};
+        if (key.size() > sizeof(k)) {
+            Sha256 h;
+            h.update(reinterpret_cast<const uint8_t*>(key.data()), key.size());
+            h.final(k);
+        } else {
+            memcpy(k, key.data(), key.size());
+        }
+        uint8_t ipad[64], opad[64];
+        for (int i = 0; i < 64; ++i) {
+            ipad[i] = k[i] ^ 0x36;
+            opad[i] = k[i] ^ 0x5c;
+        }
+        inner.update(ipad, sizeof(ipad));
+        outer.update(opad, sizeof(opad));
+    }
+
+    void mac(const uint8_t* data, size_t len, uint8_t out[32]) const {
+        Sha256 in = inner;
+        in.update(data, len);
+        uint8_t digest[32];
+        in.final(digest);
+        Sha256 out_ctx = outer;
+        out_ctx.update(digest, sizeof(digest));
+        out_ctx.final(out);
+    }
+};
+
+std::string to_hex(const uint8_t* data, size_t len) {
+    static const char* DIGITS = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(len * 2);
+    for (size_t i = 0; i < len; ++i) {
+        hex.push_back(DIGITS[data[i] >> 4]);
+        hex.push_back(DIGITS[data[i] & 0x0f]);
+    }
+    return hex;
+}
+
+bool from_hex(const std::string& hex, uint8_t* out, size_t len) {
+    if (hex.size() != len * 2) return false;
+    auto nibble = [](char c) -> int {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        return -1;
+    };
+    for (size_t i = 0; i < len; ++i) {
+        int hi = nibble(hex[i * 2]), lo = nibble(hex[i * 2 + 1]);
+        if (hi < 0 || lo < 0) return false;
+        out[i] = static_cast<uint8_t>((hi << 4) | lo);
+    }
+    return true;
+}
+
+// Comparação em tempo constante para não revelar o prefixo correto
+bool equal_constant_time(const uint8_t* a, const uint8_t* b, size_t len) {
+    uint8_t diff = 0;
+    for (size_t i = 0; i < len; ++i) diff |= a[i] ^ b[i];
+    return diff == 0;
+}
+}
+
+void PasswordHasher::pbkdf2_sha256(const std::string& password, const uint8_t* salt, size_t salt_len,
+                                   uint32_t iterations, uint8_t out[HASH_SIZE]) {
+    HmacSha256 hmac(password);
+    // Um único bloco: HASH_SIZE é igual ao tamanho do SHA-256
+    std::string first(reinterpret_cast<const char*>(salt), salt_len);
+    first.append("\x00\x00\x00\x01", 4);
+    uint8_t u[32];
+    hmac.mac(reinterpret_cast<const uint8_t*>(first.data()), first.size(), u);
+    memcpy(out, u, HASH_SIZE);
+    for (uint32_t i = 1; i < iterations; ++i) {
+        hmac.mac(u, sizeof(u), u);
+        for (size_t j = 0; j < HASH_SIZE; ++j) out[j] ^= u[j];
+    }
+}
+
+std::string PasswordHasher::hash(const std::string& password, uint32_t iterations) {
+    if (iterations == 0) iterations = 1;
+    uint8_t salt[SALT_SIZE];
+    Utils::random_bytes(salt, sizeof(salt));
+    uint8_t derived[HASH_SIZE];
+    pbkdf2_sha256(password, salt, sizeof(salt), iterations, derived);
+    return std::string(HASH_PREFIX) + std::to_string(iterations) + "$" +
+           to_hex(salt, sizeof(salt)) + "$" + to_hex(derived, sizeof(derived));
+}
+
+bool PasswordHasher::is_hashed(const std::string& stored) {
+    return stored.compare(0, strlen(HASH_PREFIX), HASH_PREFIX) == 0;
+}
+
+bool PasswordHasher::verify(const std::string& password, const std::string& stored) {
+    if (!is_hashed(stored)) {
+        return stored.size() == password.size() &&
+               equal_constant_time(reinterpret_cast<const uint8_t*>(stored.data()),
+                                   reinterpret_cast<const uint8_t*>(password.data()), stored.size());
+    }
+
+    size_t p1 = strlen(HASH_PREFIX);
+    size_t p2 = stored.find('$', p1);
+    size_t p3 = p2 == std::string::npos ? p2 : stored.find('$', p2 + 1);
+    if (p3 == std::string::npos) return false;
+
+    uint32_t iterations = static_cast<uint32_t>(std::strtoul(stored.c_str() + p1, nullptr, 10));
+    uint8_t salt[SALT_SIZE], expected[HASH_SIZE], derived[HASH_SIZE];
+    if (iterations == 0 ||
+        !from_hex(stored.substr(p2 + 1, p3 - p2 - 1), salt, sizeof(salt)) ||
+        !from_hex(stored.substr(p3 + 1), expected, sizeof(expected))) {
+        return false;
+    }
+    pbkdf2_sha256(password, salt, sizeof(salt), iterations, derived);
+    return equal_constant_time(derived, expected, sizeof(derived));
+}
+
+}
@@ -0,0 +1,137 @@
+#include "profiled_mutex.h"
+#include "hdr_histogram.h"
+#include "sharded_counter.h"
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <memory>
+
+namespace chat {
+
+// Histogramas de um site para um thread_shard(): threads de shards
+// diferentes não disputam as mesmas linhas de cache ao registar
+struct LockSiteShard {
+    HdrHistogram wait_ns;
+    HdrHistogram hold_ns;
+};
+
+struct LockSite {
+    std::string name;
+    ShardedCounter acquisitions;
+    ShardedCounter contended;
+    // Criados na primeira escrita da thread e nunca libertados, como os sites
+    std::atomic<LockSiteShard*> shards[THREAD_SHARDS] = {};
+};
+
+namespace {
+// Um std::mutex simples: o registo não se pode medir a si próprio. Nunca
+// destruídos, porque há mutexes estáticos que vivem até ao fim do processo
+struct Registry {
+    std::mutex mutex;
+    std::map<std::string, LockSite*> sites;
+};
+
+Registry& registry() {
+    static Registry* instance = new Registry();
+    return *instance;
+}
+
+LockSiteShard* shard_for_thread(LockSite* site) {
+    std::atomic<LockSiteShard*>& slot = site->shards[thread_shard()];
+    LockSiteShard* shard = slot.load(std::memory_order_acquire);
+    if (shard) return shard;
+    LockSiteShard* created = new LockSiteShard();
+    if (slot.compare_exchange_strong(shard, created, std::memory_order_acq_rel)) return created;
+    delete created;
+    return shard;
+}
+}
+
+LockSite* LockProfiler::site(const char* name) {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    LockSite*& site = reg.sites[name];
+    if (!site) {
+        site = new LockSite();
+        site->name = name;
+    }
+    return site;
+}
+
+void LockProfiler::acquired(LockSite* site, bool contended, int64_t wait_ns) {
+    site->acquisitions.add(1);
+    if (!contended) return;
+    site->contended.add(1);
+    shard_for_thread(site)->wait_ns.record(static_cast<uint64_t>(std::max<int64_t>(wait_ns, 0)));
+}
+
+void LockProfiler::released(LockSite* site, int64_t hold_ns) {
+    shard_for_thread(site)->hold_ns.record(static_cast<uint64_t>(std::max<int64_t>(hold_ns, 0)));
+}
+
+std::vector<LockReport> LockProfiler::report() {
+    std::vector<LockSite*> sites;
+    {
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        for (const auto& entry : reg.sites) sites.push_back(entry.second);
+    }
+
+    std::vector<LockReport> result;
+    // Alocados: cada histograma tem dezenas de KB
+    auto wait = std::make_unique<HdrHistogram>();
+    auto hold = std::make_unique<HdrHistogram>();
+    for (const LockSite* site : sites) {
+        wait->reset();
+        hold->reset();
+        for (const auto& slot : site->shards) {
+            const LockSiteShard* shard = slot.load(std::memory_order_acquire);
+            if (!shard) continue;
+            wait->merge(shard->wait_ns);
+            hold->merge(shard->hold_ns);
+        }
+        LockReport report;
+        report.name = site->name;
+        report.acquisitions = site->acquisitions.load();
+        report.contended = site->contended.load();
+        report.wait_total_ns = static_cast<uint64_t>(wait->mean() * wait->count());
+        report.wait_p50_ns = wait->percentile(0.50);
+        report.wait_p99_ns = wait->percentile(0.99);
+        report.wait_max_ns = wait->max();
+        report.hold_p50_ns = hold->percentile(0.50);
+        report.hold_p99_ns = hold->percentile(0.99);
+        report.hold_max_ns = hold->max();
+        result.push_back(report);
+    }
+    std::sort(result.begin(), result.end(), [](const LockReport& a, const LockReport& b) {
+        if (a.wait_total_ns != b.wait_total_ns) return a.wait_total_ns > b.wait_total_ns;
+        return a.contended > b.contended;
+    });
+    return result;
+}
+
+std::string LockProfiler::report_text() {
+    if (!ENABLED) return "Perfil de locks desativado: compile com make LOCK_PROFILING=1.\n";
+
+    std::string out = "Locks por tempo total de espera (tempos em µs)\n";
+    char line[256];
+    // Cabeçalho alinhado à mão: o printf conta bytes e os acentos ocupam dois
+    out += "  site                       aquisições  contenção espera total         espera p50/p99/máx"
+           "          posse p50/p99/máx\n";
+    for (const LockReport& report : report()) {
+        double contention = report.acquisitions ? 100.0 * report.contended / report.acquisitions : 0.0;
+        char wait[64];
+        char hold[64];
+        snprintf(wait, sizeof(wait), "%.1f/%.1f/%.1f", report.wait_p50_ns / 1e3, report.wait_p99_ns / 1e3,
+                 report.wait_max_ns / 1e3);
+        snprintf(hold, sizeof(hold), "%.1f/%.1f/%.1f", report.hold_p50_ns / 1e3, report.hold_p99_ns / 1e3,
+                 report.hold_max_ns / 1e3);
+        snprintf(line, sizeof(line), "  %-24s %12llu %9.2f%% %12.1f %26s %26s\n", report.name.c_str(),
+                 static_cast<unsigned long long>(report.acquisitions), contention, report.wait_total_ns / 1e3,
+                 wait, hold);
+        out += line;
+    }
+    return out;
+}
+
+}
@@ -0,0 +1,79 @@
+#include "rate_limiter.h"
+
+namespace chat {
+
+namespace {
+int64_t interval_for(const RateLimit& limit) {
+    if (!limit.enabled()) return 0;
+    int64_t interval = static_cast<int64_t>(1e9 / limit.per_second);
+    return interval > 0 ? interval : 1;
+}
+
+int64_t tolerance_for(const RateLimit& limit, int64_t interval) {
+    uint32_t burst = limit.burst > 0 ? limit.burst : 1;
+    return interval * static_cast<int64_t>(burst - 1);
+}
+}
+
+void TokenBucket::configure(const RateLimit& limit) {
+    interval_ns_ = interval_for(limit);
+    tolerance_ns_ = tolerance_for(limit, interval_ns_);
+    tat_ns_.store(0, std::memory_order_relaxed);
+}
+
+IpRateLimiter::IpRateLimiter(const RateLimit& limit)
+    : interval_ns_(interval_for(limit)), tolerance_ns_(tolerance_for(limit, interval_ns_)) {}
+
+bool IpRateLimiter::try_acquire(uint32_t ip) {
+    if (interval_ns_ == 0) return true;
+    int64_t now = TokenBucket::now_ns();
+    // Mistura os bits: IPs da mesma rede diferem só nos bits baixos
+    Shard& shard = shards_[(ip * 2654435761u) >> 28];
+    std::lock_guard<ProfiledMutex> lock(shard.mutex);
+
+    auto it = shard.tat_ns.find(ip);
+    if (it == shard.tat_ns.end()) {
+        if (shard.tat_ns.size() >= MAX_ENTRIES_PER_SHARD && prune_shard(shard, now) == 0) return true;
+        shard.tat_ns.emplace(ip, now + interval_ns_);
+        return true;
+    }
+    int64_t base = it->second > now ? it->second : now;
+    if (base - now > tolerance_ns_) return false;
+    it->second = base + interval_ns_;
+    return true;
+}
+
+size_t IpRateLimiter::prune_shard(Shard& shard, int64_t now) {
+    size_t removed = 0;
+    for (auto it = shard.tat_ns.begin(); it != shard.tat_ns.end();) {
+        if (it->second <= now) {
+            it = shard.tat_ns.erase(it);
+            ++removed;
+        } else {
+            ++it;
+        }
+    }
+    return removed;
+}
+
+size_t IpRateLimiter::prune() {
+    if (interval_ns_ == 0) return 0;
+    int64_t now = TokenBucket::now_ns();
+    size_t removed = 0;
+    for (Shard& shard : shards_) {
+        std::lock_guard<ProfiledMutex> lock(shard.mutex);
+        removed += prune_shard(shard, now);
+    }
+    return removed;
+}
+
+size_t IpRateLimiter::size() const {
+    size_t total = 0;
+    for (const Shard& shard : shards_) {
+        std::lock_guard<ProfiledMutex> lock(shard.mutex);
+        total += shard.tat_ns.size();
+    }
+    return total;
+}
+
+}
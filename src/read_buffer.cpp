@@ -0,0 +1,60 @@
+#include "read_buffer.h"
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <sys/socket.h>
+
+namespace chat {
+
+ReadBuffer::ReadBuffer(size_t capacity, size_t max_size)
+    : data_(capacity), read_pos_(0), write_pos_(0), scan_pos_(0), max_size_(max_size) {}
+
+void ReadBuffer::make_room() {
+    if (read_pos_ == write_pos_) {
+        clear();
+        return;
+    }
+    if (write_pos_ < data_.size()) return;
+
+    // Move a linha parcial para o início; só cresce se ela ocupar tudo
+    if (read_pos_ > 0) {
+        size_t pending = write_pos_ - read_pos_;
+        memmove(data_.data(), data_.data() + read_pos_, pending);
+        scan_pos_ -= read_pos_;
+        read_pos_ = 0;
+        write_pos_ = pending;
+    } else if (data_.size() < max_size_) {
+        data_.resize(std::min(data_.size() * 2, max_size_));
+    }
+}
+
+ssize_t ReadBuffer::fill(int socket_fd, int flags) {
+    make_room();
+    if (write_pos_ == data_.size()) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+    ssize_t n = recv(socket_fd, data_.data() + write_pos_, data_.size() - write_pos_, flags);
+    if (n > 0) write_pos_ += static_cast<size_t>(n);
+    return n;
+}
+
+void ReadBuffer::consume(size_t n) {
+    read_pos_ += std::min(n, write_pos_ - read_pos_);
+    if (scan_pos_ < read_pos_) scan_pos_ = read_pos_;
+}
+
+bool ReadBuffer::next_line(std::string_view& line) {
+    const char* base = data_.data();
+    const void* found = memchr(base + scan_pos_, '\n', write_pos_ - scan_pos_);
+    if (!found) {
+        scan_pos_ = write_pos_;
+        return false;
+    }
+    size_t pos = static_cast<const char*>(found) - base;
+    line = std::string_view(base + read_pos_, pos - read_pos_);
+    read_pos_ = scan_pos_ = pos + 1;
+    return true;
+}
+
+}
@@ -0,0 +1,76 @@
+#include "resume_tokens.h"
+#include "chat_common.h"
+
+namespace chat {
+
+namespace {
+// 64 símbolos: 6 bits por carácter, sem '|' nem ':' (delimitadores do protocolo e do BD)
+const char TOKEN_ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+const std::chrono::seconds PURGE_INTERVAL(10);
+}
+
+ResumeTokenStore::ResumeTokenStore(int ttl_seconds)
+    : ttl_(ttl_seconds > 0 ? ttl_seconds : 0), next_purge_(Clock::now() + PURGE_INTERVAL) {}
+
+std::string ResumeTokenStore::issue(const std::string& username) {
+    if (!enabled()) return std::string();
+
+    uint8_t random[TOKEN_LENGTH];
+    Utils::random_bytes(random, sizeof(random));
+    std::string token(TOKEN_LENGTH, '\0');
+    for (size_t i = 0; i < TOKEN_LENGTH; ++i) token[i] = TOKEN_ALPHABET[random[i] & 63];
+
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    Clock::time_point now = Clock::now();
+    if (now >= next_purge_) purge_expired(now);
+    erase_user_token(username);
+    by_token_[token] = Entry{username, Clock::time_point::max()};
+    by_user_[username] = token;
+    return token;
+}
+
+bool ResumeTokenStore::redeem(const std::string& token, const std::string& username) {
+    if (!enabled() || token.size() != TOKEN_LENGTH) return false;
+
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    auto it = by_token_.find(token);
+    if (it == by_token_.end() || it->second.username != username) return false;
+    bool valid = Clock::now() < it->second.expires;
+    by_user_.erase(it->second.username);
+    by_token_.erase(it);
+    return valid;
+}
+
+void ResumeTokenStore::release(const std::string& username) {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    auto user_it = by_user_.find(username);
+    if (user_it == by_user_.end()) return;
+    auto it = by_token_.find(user_it->second);
+    if (it != by_token_.end()) it->second.expires = Clock::now() + ttl_;
+}
+
+size_t ResumeTokenStore::size() const {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    return by_token_.size();
+}
+
+void ResumeTokenStore::erase_user_token(const std::string& username) {
+    auto user_it = by_user_.find(username);
+    if (user_it == by_user_.end()) return;
+    by_token_.erase(user_it->second);
+    by_user_.erase(user_it);
+}
+
+void ResumeTokenStore::purge_expired(Clock::time_point now) {
+    for (auto it = by_token_.begin(); it != by_token_.end();) {
+        if (now >= it->second.expires) {
+            by_user_.erase(it->second.username);
+            it = by_token_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    next_purge_ = now + PURGE_INTERVAL;
+}
+
+}
@@ -0,0 +1,97 @@
+#include "room_registry.h"
+#include <algorithm>
+#include <functional>
+
+namespace chat {
+
+RoomRegistry::RoomRegistry() : room_count_(0) {}
+
+RoomRegistry::RoomShard& RoomRegistry::room_shard(const std::string& room) {
+    return room_shards_[std::hash<std::string>{}(room) % SHARD_COUNT];
+}
+
+RoomRegistry::ClientShard& RoomRegistry::client_shard(const ConnectedClient* client) {
+    // Os bits baixos do ponteiro são sempre zero por causa do alinhamento
+    return client_shards_[(reinterpret_cast<uintptr_t>(client) >> 6) % SHARD_COUNT];
+}
+
+// Ordem dos locks: shard do cliente e depois shard da sala
+RoomRegistry::JoinResult RoomRegistry::join(const std::string& room,
+                                            const std::shared_ptr<ConnectedClient>& client,
+                                            size_t& member_count) {
+    ClientShard& cshard = client_shard(client.get());
+    std::lock_guard<ProfiledMutex> client_lock(cshard.mutex);
+    std::vector<std::string>& joined = cshard.rooms[client.get()];
+    if (std::find(joined.begin(), joined.end(), room) != joined.end()) {
+        return JoinResult::ALREADY_MEMBER;
+    }
+    if (joined.size() >= MAX_ROOMS_PER_CLIENT) return JoinResult::TOO_MANY_ROOMS;
+    joined.push_back(room);
+
+    RoomShard& rshard = room_shard(room);
+    std::lock_guard<ProfiledMutex> room_lock(rshard.mutex);
+    auto [it, created] = rshard.rooms.try_emplace(room);
+    if (created) room_count_.fetch_add(1, std::memory_order_relaxed);
+    it->second.members.emplace(client.get(), client);
+    it->second.snapshot.reset();
+    member_count = it->second.members.size();
+    return JoinResult::JOINED;
+}
+
+bool RoomRegistry::leave(const std::string& room, const std::shared_ptr<ConnectedClient>& client) {
+    ClientShard& cshard = client_shard(client.get());
+    std::lock_guard<ProfiledMutex> client_lock(cshard.mutex);
+    auto cit = cshard.rooms.find(client.get());
+    if (cit == cshard.rooms.end()) return false;
+    auto pos = std::find(cit->second.begin(), cit->second.end(), room);
+    if (pos == cit->second.end()) return false;
+    cit->second.erase(pos);
+    if (cit->second.empty()) cshard.rooms.erase(cit);
+
+    RoomShard& rshard = room_shard(room);
+    std::lock_guard<ProfiledMutex> room_lock(rshard.mutex);
+    return remove_member(rshard, room, client.get());
+}
+
+void RoomRegistry::leave_all(const std::shared_ptr<ConnectedClient>& client) {
+    ClientShard& cshard = client_shard(client.get());
+    std::lock_guard<ProfiledMutex> client_lock(cshard.mutex);
+    auto cit = cshard.rooms.find(client.get());
+    if (cit == cshard.rooms.end()) return;
+    for (const std::string& room : cit->second) {
+        RoomShard& rshard = room_shard(room);
+        std::lock_guard<ProfiledMutex> room_lock(rshard.mutex);
+        remove_member(rshard, room, client.get());
+    }
+    cshard.rooms.erase(cit);
+}
+
+bool RoomRegistry::remove_member(RoomShard& shard, const std::string& room, const ConnectedClient* client) {
+    auto it = shard.rooms.find(room);
+    if (it == shard.rooms.end() || it->second.members.erase(client) == 0) return false;
+    if (it->second.members.empty()) {
+        shard.rooms.erase(it);
+        room_count_.fetch_sub(1, std::memory_order_relaxed);
+    } else {
+        it->second.snapshot.reset();
+    }
+    return true;
+}
+
+std::shared_ptr<const RoomRegistry::Members> RoomRegistry::members_if_member(const std::string& room,
+                                                                             const ConnectedClient* client) {
+    RoomShard& shard = room_shard(room);
+    std::lock_guard<ProfiledMutex> lock(shard.mutex);
+    auto it = shard.rooms.find(room);
+    if (it == shard.rooms.end() || it->second.members.count(client) == 0) return nullptr;
+    Room& entry = it->second;
+    if (!entry.snapshot) {
+        auto members = std::make_shared<Members>();
+        members->reserve(entry.members.size());
+        for (const auto& pair : entry.members) members->push_back(pair.second);
+        entry.snapshot = std::move(members);
+    }
+    return entry.snapshot;
+}
+
+}
@@ -9,24 +9,11 @@
 
 namespace chat {
 
-// Função de leitura robusta, lê do socket até encontrar um '\n'
-static std::string read_line_from_socket(int socket_fd) {
-    std::string line;
-    char buffer;
-    ssize_t bytes_read;
-    while ((bytes_read = recv(socket_fd, &buffer, 1, 0)) > 0) {
-        if (buffer == '\n') {
-            break;
-        }
-        line += buffer;
-    }
-    if (bytes_read <= 0) return ""; // Conexão fechada ou erro
-    return line;
-}
-
 SimpleChatClient::SimpleChatClient(const std::string& server_addr, int port)
     : socket_fd_(-1), is_connected_(false), is_authenticated_(false),
-      server_address_(server_addr), server_port_(port), should_stop_(false) {}
+      server_address_(server_addr), server_port_(port),
+      protocol_(ProtocolVersion::V2_BINARY), auto_reconnect_(true), last_seq_(0),
+      should_stop_(false) {}
 
 SimpleChatClient::~SimpleChatClient() {
     disconnect();
@@ -47,15 +34,38 @@ bool SimpleChatClient::establish_connection() {
         cleanup_connection();
         return false;
     }
+    read_buffer_.clear();
     return true;
 }
 
-bool SimpleChatClient::handle_auth_response(const std::string& response_data, const std::string& original_username) {
-    if (response_data.empty()) {
+// Envia o pedido de autenticação e lê a resposta; guarda o token de sessão recebido
+bool SimpleChatClient::exchange_auth(const Message& request, Message& response) {
+    Message with_since = request;
+    std::string since = std::to_string(last_seq_.load());
+    if (!history_epoch_.empty()) since = history_epoch_ + ":" + since;
+    strncpy(with_since.content, since.c_str(), MAX_CONTENT_SIZE - 1);
+    if (!send_message(with_since)) return false;
+    std::string_view response_data;
+    if (!Utils::read_frame(socket_fd_, read_buffer_, protocol_, response_data) || response_data.empty()) {
+        return false;
+    }
+    response = Message::decode(response_data, protocol_);
+    if (response.type == MessageType::AUTH_SUCCESS) {
+        resume_token_ = response.password;
+        // Servidor reiniciado: a numeração recomeçou e o replay já vem desde o início
+        if (history_epoch_ != response.target_user) {
+            history_epoch_ = response.target_user;
+            last_seq_.store(0);
+        }
+    }
+    return true;
+}
+
+bool SimpleChatClient::handle_auth_response(bool received, const Message& response_msg, const std::string& original_username) {
+    if (!received) {
         std::cerr << "❌ Servidor fechou a conexão inesperadamente.\n";
         return false;
     }
-    Message response_msg = Message::deserialize(response_data);
     if (response_msg.type == MessageType::AUTH_SUCCESS) {
         is_connected_.store(true);
         is_authenticated_.store(true);
@@ -75,20 +85,55 @@ bool SimpleChatClient::connect_and_login(const std::string& username, const std:
     if (!establish_connection()) return false;
     Message request_msg(MessageType::LOGIN_REQUEST, username, "");
     strncpy(request_msg.password, password.c_str(), MAX_PASSWORD_SIZE - 1);
-    if (!send_data(request_msg.serialize())) return false;
-    
-    std::string response_data = read_line_from_socket(socket_fd_);
-    return handle_auth_response(response_data, username);
+    password_ = password;
+    resume_token_.clear();
+
+    Message response_msg;
+    bool received = exchange_auth(request_msg, response_msg);
+    return handle_auth_response(received, response_msg, username);
 }
 
 bool SimpleChatClient::connect_and_register(const std::string& username, const std::string& password) {
     if (!establish_connection()) return false;
     Message request_msg(MessageType::REGISTER_REQUEST, username, "");
     strncpy(request_msg.password, password.c_str(), MAX_PASSWORD_SIZE - 1);
-    if (!send_data(request_msg.serialize())) return false;
+    password_ = password;
+    resume_token_.clear();
 
-    std::string response_data = read_line_from_socket(socket_fd_);
-    return handle_auth_response(response_data, username);
+    Message response_msg;
+    bool received = exchange_auth(request_msg, response_msg);
+    return handle_auth_response(received, response_msg, username);
+}
+
+bool SimpleChatClient::resume_session() {
+    for (int attempt = 0; attempt < MAX_RESUME_ATTEMPTS && !should_stop_.load(); ++attempt) {
+        // Espera crescente com jitter para que uma queda geral não reconecte todos ao mesmo tempo;
+        // o jitter é uniforme em [0, espera) para continuar a espalhá-los nas esperas longas
+        uint32_t backoff_ms = 100u << attempt;
+        uint32_t jitter = 0;
+        try { Utils::random_bytes(reinterpret_cast<uint8_t*>(&jitter), sizeof(jitter)); } catch (...) {}
+        std::this_thread::sleep_for(std::chrono::milliseconds(backoff_ms + jitter % backoff_ms));
+        if (should_stop_.load()) break;
+
+        cleanup_connection();
+        if (!establish_connection()) continue;
+
+        bool with_token = !resume_token_.empty();
+        Message request(with_token ? MessageType::RESUME_REQUEST : MessageType::LOGIN_REQUEST, username_, "");
+        strncpy(request.password, with_token ? resume_token_.c_str() : password_.c_str(), MAX_PASSWORD_SIZE - 1);
+
+        Message response;
+        if (!exchange_auth(request, response)) continue;
+        if (response.type == MessageType::AUTH_SUCCESS) {
+            LOG_INFO(std::string("Sessão retomada ") + (with_token ? "com token." : "com senha."));
+            rejoin_rooms();
+            return true;
+        }
+        // Token expirado ou recusado: a próxima tentativa usa a senha
+        if (with_token) resume_token_.clear();
+        else break;
+    }
+    return false;
 }
 
 void SimpleChatClient::disconnect() {
@@ -97,7 +142,7 @@ void SimpleChatClient::disconnect() {
     should_stop_.store(true);
     if (is_authenticated_.load()) {
         Message disconnect_msg(MessageType::DISCONNECT_REQUEST, username_, "");
-        send_data(disconnect_msg.serialize());
+        send_message(disconnect_msg);
     }
     cleanup_connection();
     if (receiver_thread_.joinable()) receiver_thread_.join();
@@ -107,29 +152,75 @@ void SimpleChatClient::disconnect() {
 void SimpleChatClient::send_broadcast(const std::string& message) {
     if (!is_authenticated_.load()) return;
     Message msg(MessageType::CHAT_BROADCAST, username_, message);
-    send_data(msg.serialize());
+    send_message(msg);
 }
 
 void SimpleChatClient::send_private(const std::string& target, const std::string& message) {
     if (!is_authenticated_.load()) return;
     Message msg(MessageType::PRIVATE_MESSAGE, username_, message);
     strncpy(msg.target_user, target.c_str(), MAX_USERNAME_SIZE - 1);
-    send_data(msg.serialize());
+    send_message(msg);
+}
+
+void SimpleChatClient::join_room(const std::string& room) {
+    if (!is_authenticated_.load()) return;
+    Message msg(MessageType::JOIN_ROOM, username_, "");
+    strncpy(msg.target_user, room.c_str(), MAX_USERNAME_SIZE - 1);
+    if (send_message(msg)) {
+        std::lock_guard<std::mutex> lock(rooms_mutex_);
+        rooms_.insert(room);
+    }
+}
+
+void SimpleChatClient::leave_room(const std::string& room) {
+    if (!is_authenticated_.load()) return;
+    Message msg(MessageType::LEAVE_ROOM, username_, "");
+    strncpy(msg.target_user, room.c_str(), MAX_USERNAME_SIZE - 1);
+    send_message(msg);
+    std::lock_guard<std::mutex> lock(rooms_mutex_);
+    rooms_.erase(room);
+}
+
+void SimpleChatClient::send_room(const std::string& room, const std::string& message) {
+    if (!is_authenticated_.load()) return;
+    Message msg(MessageType::ROOM_MESSAGE, username_, message);
+    strncpy(msg.target_user, room.c_str(), MAX_USERNAME_SIZE - 1);
+    send_message(msg);
+}
+
+void SimpleChatClient::rejoin_rooms() {
+    std::lock_guard<std::mutex> lock(rooms_mutex_);
+    for (const std::string& room : rooms_) {
+        Message msg(MessageType::JOIN_ROOM, username_, "");
+        strncpy(msg.target_user, room.c_str(), MAX_USERNAME_SIZE - 1);
+        send_message(msg);
+    }
 }
 
 void SimpleChatClient::receiver_thread_func() {
     LOG_INFO("Thread de receção iniciada.");
     while (!should_stop_.load()) {
-        std::string data = read_line_from_socket(socket_fd_);
-        if (data.empty()) {
+        std::string_view data;
+        if (!Utils::read_frame(socket_fd_, read_buffer_, protocol_, data) || data.empty()) {
+            if (should_stop_.load()) break;
+            is_authenticated_.store(false);
+            if (auto_reconnect_ && resume_session()) {
+                is_authenticated_.store(true);
+                std::cout << "\n🔄 Conexão restabelecida.\n" << std::endl;
+                continue;
+            }
             if (!should_stop_.load()) {
                 is_connected_.store(false);
-                is_authenticated_.store(false);
                 std::cout << "\n\n❌ Conexão com o servidor perdida. Pressione Enter para sair.\n" << std::endl;
             }
             break;
         }
-        Message msg = Message::deserialize(data);
+        Message msg = Message::decode(data, protocol_);
+        if (msg.seq != 0) {
+            // Após uma retoma o replay pode repetir mensagens já mostradas
+            if (msg.seq <= last_seq_.load()) continue;
+            last_seq_.store(msg.seq);
+        }
         process_chat_message(msg);
     }
     LOG_INFO("Thread de receção finalizada.");
@@ -141,27 +232,33 @@ void SimpleChatClient::process_chat_message(const Message& msg) {
             std::cout << "\n[" << Utils::get_timestamp_str() << "] " << msg.username << ": " << msg.content << std::endl; break;
         case MessageType::PRIVATE_MESSAGE:
             std::cout << "\n[" << Utils::get_timestamp_str() << "] (privado de " << msg.username << "): " << msg.content << std::endl; break;
+        case MessageType::ROOM_MESSAGE:
+            std::cout << "\n[" << Utils::get_timestamp_str() << "] #" << msg.target_user << " " << msg.username << ": " << msg.content << std::endl; break;
         case MessageType::SERVER_MESSAGE:
             std::cout << "\n>>> SERVIDOR: " << msg.content << std::endl; break;
         case MessageType::ERROR_MSG:
             std::cout << "\n!!! ERRO: " << msg.content << std::endl; break;
+        case MessageType::PING:
+            send_message(Message(MessageType::PONG, username_, "")); break;
+        case MessageType::PONG:
+            break;
         default:
             LOG_WARNING("Mensagem de tipo desconhecido recebida: " + std::to_string(static_cast<int>(msg.type))); break;
     }
 }
 
 void SimpleChatClient::cleanup_connection() {
-    if (socket_fd_ != -1) {
-        shutdown(socket_fd_, SHUT_RDWR);
-        close(socket_fd_);
-        socket_fd_ = -1;
+    int fd = socket_fd_.exchange(-1);
+    if (fd != -1) {
+        shutdown(fd, SHUT_RDWR);
+        close(fd);
     }
 }
 
-bool SimpleChatClient::send_data(const std::string& data) {
+bool SimpleChatClient::send_message(const Message& msg) {
     if (socket_fd_ == -1) return false;
-    std::string full_data = data + "\n";
-    return send(socket_fd_, full_data.c_str(), full_data.length(), MSG_NOSIGNAL) > 0;
+    WireBuffer data = msg.to_wire(protocol_);
+    return send(socket_fd_, data->data(), data->length(), MSG_NOSIGNAL) > 0;
 }
 
 } // namespace chat
@@ -1,7 +1,16 @@
 #include "simple_chat_server.h"
 #include "libtslog.h"
+#include "stage_metrics.h"
+#include "sharded_counter.h"
 #include <iostream>
+#include <cstdio>
 #include <cstring>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <algorithm>
+#include <future>
+#include <iomanip>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
@@ -9,161 +18,337 @@
 
 namespace chat {
 
+namespace {
+ServerConfig config_for_port(int port) {
+    ServerConfig config;
+    config.port = port;
+    return config;
+}
+}
+
 SimpleChatServer::SimpleChatServer(int port)
-    : server_socket_(-1), port_(port), running_(false), 
-      total_connections_(0), total_messages_processed_(0) {}
+    : SimpleChatServer(config_for_port(port)) {}
+
+SimpleChatServer::SimpleChatServer(const ServerConfig& config)
+    : port_(config.port), config_(config), running_(false), 
+      user_db_("users.db", config.kdf_iterations),
+      auth_pool_(config.auth_workers, config.auth_queue_limit),
+      resume_tokens_(config.resume_token_ttl),
+      history_(config.history_size),
+      fanout_(config.fanout_workers, config.fanout_threshold),
+      connection_limiter_(config.connection_rate),
+      online_users_(std::make_shared<const OnlineUsers>()), online_list_(std::make_shared<const ClientList>()),
+      threaded_sessions_(0), total_connections_(0), total_messages_processed_(0),
+      retired_dropped_new_(0), retired_dropped_oldest_(0), evicted_clients_(0),
+      handshake_timeouts_(0), idle_disconnects_(0), throttled_messages_(0), rejected_connections_(0) {
+    if (!config.archive_dir.empty()) {
+        ArchiveOptions options;
+        options.directory = config.archive_dir;
+        options.segment_size = config.archive_segment_size;
+        archive_ = std::make_unique<ChatArchive>(options);
+    }
+}
 
 SimpleChatServer::~SimpleChatServer() {
-    if (is_running()) stop();
+    stop();
 }
 
 bool SimpleChatServer::start() {
     if (running_.exchange(true)) return false;
-    if (!setup_server_socket()) { 
+    acceptors_ = std::make_unique<AcceptorPool>(port_, config_.acceptors, config_.listen_backlog,
+                                                config_.engine == ServerEngine::EPOLL);
+    if (!acceptors_->open()) {
+        acceptors_.reset();
         running_.store(false); 
         return false; 
     }
-    accept_thread_ = std::thread(&SimpleChatServer::accept_connections, this);
-    LOG_INFO("Servidor iniciado na porta " + std::to_string(port_));
+    if (!config_.filter_file.empty() && !filter_.load_file(config_.filter_file)) {
+        LOG_WARNING("A usar a lista de palavras embutida; o ficheiro continua a ser vigiado.");
+    }
+    if (archive_ && !archive_->start()) {
+        acceptors_.reset();
+        running_.store(false);
+        return false;
+    }
+    if (archive_) history_.resume_from(archive_->recovered_seq());
+    StageMetrics::set_enabled(config_.stage_metrics);
+    timers_.start();
+    schedule_rate_prune();
+    schedule_filter_reload();
+    auth_pool_.start();
+    LOG_INFO("Pool de autenticação iniciado com " + std::to_string(auth_pool_.get_worker_count()) + " threads");
+    fanout_.start();
+    if (fanout_.get_threshold() > 0) {
+        LOG_INFO("Fan-out paralelo com " + std::to_string(fanout_.get_worker_count()) +
+                 " threads a partir de " + std::to_string(fanout_.get_threshold()) + " destinatários");
+    }
+    if (config_.engine == ServerEngine::EPOLL) {
+        EpollReactor::Callbacks callbacks;
+        callbacks.on_handshake = [this](int fd, const std::string& addr, std::string_view frame,
+                                        ProtocolVersion protocol, std::function<void()> wake,
+                                        EpollReactor::HandshakeDone done) {
+            reactor_handshake(fd, addr, frame, protocol, std::move(wake), std::move(done));
+        };
+        callbacks.on_message = [this](const std::shared_ptr<ConnectedClient>& client, std::string_view frame,
+                                      int64_t received_ns) {
+            handle_client_line(frame, client, received_ns);
+        };
+        callbacks.on_close = [this](const std::shared_ptr<ConnectedClient>& client) {
+            LOG_INFO(client->get_username() + " desconectado.");
+            remove_online_user(client);
+        };
+        reactor_ = std::make_unique<EpollReactor>(config_.event_loops, std::move(callbacks), &timers_,
+                                                  std::chrono::seconds(config_.handshake_timeout));
+        if (!reactor_->start()) {
+            reactor_.reset();
+            auth_pool_.stop();
+            timers_.stop();
+            fanout_.stop();
+            if (archive_) archive_->stop();
+            acceptors_.reset();
+            running_.store(false);
+            return false;
+        }
+    }
+    acceptors_->start([this](std::vector<AcceptorPool::Accepted>& batch) { on_accepted(batch); });
+    if (!config_.admin_endpoint.empty()) {
+        admin_ = std::make_unique<AdminServer>(config_.admin_endpoint);
+        admin_->route("/metrics", "text/plain; version=0.0.4; charset=utf-8", [this]{ return metrics_text(); });
+        admin_->route("/stats.json", "application/json", [this]{ return stats_json(); });
+        admin_->route("/locks", "text/plain; charset=utf-8", []{ return LockProfiler::report_text(); });
+        if (!admin_->start()) {
+            admin_.reset();
+            LOG_WARNING("O servidor continua sem o listener de administração.");
+        }
+    }
+    LOG_INFO("Servidor iniciado na porta " + std::to_string(port_) + " (motor " +
+             (config_.engine == ServerEngine::EPOLL ? "epoll" : "threads") + ")");
     return true;
 }
 
 void SimpleChatServer::stop() {
+    // O handler de sinal pode estar a parar o servidor noutra thread enquanto
+    // main() já sai e destrói o objeto: o destrutor espera aqui
+    std::lock_guard<std::mutex> lock(stop_mutex_);
     if (!running_.exchange(false)) return;
     LOG_INFO("A parar o servidor...");
-    cleanup_server_socket();
-    if (accept_thread_.joinable()) accept_thread_.join();
+    if (admin_) {
+        admin_->stop();
+        admin_.reset();
+    }
+    if (acceptors_) acceptors_->stop();
+    // Antes do reactor: os handshakes pendentes ainda entregam o resultado aos loops
+    auth_pool_.stop();
+    std::shared_ptr<const OnlineUsers> users;
     {
-        std::lock_guard<std::mutex> lock(online_users_mutex_);
-        for (auto const& [_, client] : online_users_) {
-            if(client) client->disconnect();
-        }
-        online_users_.clear();
+        std::lock_guard<ProfiledMutex> lock(online_users_write_mutex_);
+        users = std::atomic_load(&online_users_);
+        publish_online_users(std::make_shared<const OnlineUsers>());
+    }
+    for (auto const& [_, client] : *users) {
+        if(client) client->request_close();
     }
+    if (reactor_) {
+        reactor_->stop();
+        reactor_.reset();
+    }
+    // As threads destacadas ainda vão anunciar a saída dos seus clientes; a última acorda-nos
+    {
+        std::unique_lock<std::mutex> lock(sessions_mutex_);
+        sessions_cv_.wait_for(lock, std::chrono::seconds(SESSION_DRAIN_SECONDS),
+                              [this]{ return threaded_sessions_ == 0; });
+    }
+    fanout_.stop();
+    timers_.stop();
+    // Por último: grava o que ainda estiver na fila do arquivo
+    if (archive_) archive_->stop();
     LOG_INFO("Servidor parado.");
 }
 
-bool SimpleChatServer::setup_server_socket() {
-    server_socket_ = socket(AF_INET, SOCK_STREAM, 0);
-    if (server_socket_ < 0) {
-        LOG_ERROR("Falha ao criar socket: " + std::string(strerror(errno)));
-        return false;
+void SimpleChatServer::on_accepted(std::vector<AcceptorPool::Accepted>& batch) {
+    total_connections_ += static_cast<int>(batch.size());
+    if (connection_limiter_.enabled()) {
+        size_t before = batch.size();
+        auto rejected = std::remove_if(batch.begin(), batch.end(), [this](const AcceptorPool::Accepted& accepted) {
+            if (connection_limiter_.try_acquire(accepted.ip)) return false;
+            close(accepted.fd);
+            return true;
+        });
+        batch.erase(rejected, batch.end());
+        if (batch.size() != before) {
+            rejected_connections_ += before - batch.size();
+            LOG_WARNING(std::to_string(before - batch.size()) + " conexões recusadas por excesso de taxa por IP.");
+        }
+        if (batch.empty()) return;
     }
-
-    // Permite reutilizar a porta imediatamente após fechar
-    int opt = 1;
-    if (setsockopt(server_socket_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
-        LOG_WARNING("Falha ao definir SO_REUSEADDR");
+    if (reactor_) {
+        std::vector<std::pair<int, std::string>> conns;
+        conns.reserve(batch.size());
+        for (auto& accepted : batch) conns.emplace_back(accepted.fd, std::move(accepted.addr));
+        reactor_->add_connections(conns);
+        return;
+    }
+    for (auto& accepted : batch) {
+        std::thread(&SimpleChatServer::handle_client, this, accepted.fd, std::move(accepted.addr)).detach();
     }
+}
 
-    struct sockaddr_in server_addr;
-    memset(&server_addr, 0, sizeof(server_addr));
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_addr.s_addr = INADDR_ANY;
-    server_addr.sin_port = htons(port_);
+bool SimpleChatServer::authenticate(const Message& auth_msg, std::string& response_text) {
+    std::string username = auth_msg.username;
+    std::string password = auth_msg.password;
+    bool success = false;
 
-    if (bind(server_socket_, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
-        LOG_ERROR("Falha no bind da porta " + std::to_string(port_) + ": " + std::string(strerror(errno)));
-        close(server_socket_);
-        server_socket_ = -1;
+    // Os frames v2 aceitam qualquer byte no nome: nada chega à base de dados sem esta validação
+    if (!Utils::is_valid_username(username)) {
+        response_text = "Nome de utilizador inválido.";
         return false;
     }
-
-    if (listen(server_socket_, MAX_CLIENTS) < 0) {
-        LOG_ERROR("Falha no listen: " + std::string(strerror(errno)));
-        close(server_socket_);
-        server_socket_ = -1;
-        return false;
+    if (auth_msg.type == MessageType::LOGIN_REQUEST) {
+        if (user_db_.validate_user(username, password)) {
+            // Verificar se usuário já está online
+            if (online_snapshot()->count(username)) {
+                success = false;
+                response_text = "Utilizador já está online.";
+            } else {
+                success = true;
+                response_text = "Login bem-sucedido!";
+            }
+        } else {
+            response_text = "Nome ou senha inválidos.";
+        }
+    } else if (auth_msg.type == MessageType::RESUME_REQUEST) {
+        if (resume_tokens_.redeem(auth_msg.password, username)) {
+            // O token prova a identidade: uma sessão antiga ainda registada é a
+            // mesma conexão que caiu sem o servidor dar conta. Só shutdown(): o socket
+            // antigo é fechado pelas threads dessa sessão, não por esta
+            auto users = online_snapshot();
+            auto it = users->find(username);
+            if (it != users->end() && it->second) it->second->request_close();
+            success = true;
+            response_text = "Sessão retomada.";
+        } else {
+            response_text = "Token de sessão inválido ou expirado.";
+        }
+    } else if (auth_msg.type == MessageType::REGISTER_REQUEST) {
+        if (user_db_.add_user(username, password)) {
+            success = true;
+            response_text = "Conta criada com sucesso!";
+        } else {
+            response_text = "Nome de utilizador já existe.";
+        }
+    } else {
+        response_text = "Pedido inválido.";
     }
+    return success;
+}
 
-    LOG_INFO("Socket do servidor configurado com sucesso na porta " + std::to_string(port_));
-    return true;
+void SimpleChatServer::authenticate_async(const Message& auth_msg,
+                                          std::function<void(bool, const std::string&)> done) {
+    auto job = [this, auth_msg, done]{
+        std::string response_text;
+        bool success = false;
+        try {
+            success = authenticate(auth_msg, response_text);
+        } catch (const std::exception& e) {
+            LOG_ERROR(std::string("Exceção ao autenticar ") + auth_msg.username + ": " + e.what());
+            response_text = "Erro interno do servidor.";
+        }
+        done(success, response_text);
+    };
+    // A retoma é só uma consulta em memória: não vale a pena passar pelo pool
+    if (auth_msg.type == MessageType::RESUME_REQUEST) {
+        job();
+        return;
+    }
+    if (!auth_pool_.submit(std::move(job))) {
+        LOG_WARNING(std::string("Pool de autenticação saturado, pedido de ") + auth_msg.username + " recusado.");
+        done(false, "Servidor ocupado, tente novamente.");
+    }
 }
 
-void SimpleChatServer::cleanup_server_socket() {
-    if (server_socket_ != -1) {
-        shutdown(server_socket_, SHUT_RDWR);
-        close(server_socket_);
-        server_socket_ = -1;
+Message SimpleChatServer::make_auth_response(bool success, const std::string& text,
+                                             const std::string& username) {
+    Message response(success ? MessageType::AUTH_SUCCESS : MessageType::AUTH_FAILURE, "SERVER", text);
+    if (success) {
+        std::string token = resume_tokens_.issue(username);
+        strncpy(response.password, token.c_str(), MAX_PASSWORD_SIZE - 1);
+        strncpy(response.target_user, history_.epoch().c_str(), MAX_USERNAME_SIZE - 1);
     }
+    return response;
 }
 
-void SimpleChatServer::accept_connections() {
-    LOG_INFO("Thread de aceitação iniciada");
-    while (running_.load()) {
-        struct sockaddr_in client_addr;
-        socklen_t client_len = sizeof(client_addr);
-        int client_socket = accept(server_socket_, (struct sockaddr*)&client_addr, &client_len);
-        
-        if (client_socket < 0) {
-            if (running_.load()) {
-                LOG_ERROR("Falha no accept: " + std::string(strerror(errno)));
-            }
-            continue;
-        }
-        
-        total_connections_++;
-        
-        char client_ip_str[INET_ADDRSTRLEN];
-        inet_ntop(AF_INET, &client_addr.sin_addr, client_ip_str, INET_ADDRSTRLEN);
-        std::string client_ip(client_ip_str);
-        LOG_INFO("Nova conexão de " + client_ip);
-        
-        std::thread(&SimpleChatServer::handle_client, this, client_socket, client_ip).detach();
+void SimpleChatServer::replay_history(const std::shared_ptr<ConnectedClient>& client, const Message& auth_msg) {
+    // "época:seq" ou só "seq"; noutra época os números já não correspondem e
+    // o cliente recebe o anel todo
+    const char* since_text = auth_msg.content;
+    const char* colon = strchr(since_text, ':');
+    bool other_epoch = false;
+    if (colon) {
+        other_epoch = std::string(since_text, colon - since_text) != history_.epoch();
+        since_text = colon + 1;
     }
-    LOG_INFO("Thread de aceitação finalizada.");
+    if (*since_text == '\0') return;
+    char* end = nullptr;
+    uint64_t since = std::strtoull(since_text, &end, 10);
+    if (*end != '\0') return;
+    if (other_epoch) since = 0;
+
+    std::string backlog;
+    size_t count = history_.encode_since(since, client->get_protocol(), backlog);
+    if (count == 0) return;
+    client->queue_wire(std::make_shared<const std::string>(std::move(backlog)));
+    LOG_DEBUG("Replay de " + std::to_string(count) + " mensagens para " + client->get_username());
 }
 
 void SimpleChatServer::handle_client(int client_socket, std::string client_addr) {
-    std::string read_buffer;
+    ReadBuffer read_buffer;
     std::string username;
+    std::shared_ptr<ConnectedClient> client_ptr;
+    bool session_counted = false;
     
+    // Um cliente que conecta e não diz nada prenderia esta thread para sempre:
+    // o shutdown() acorda o recv() bloqueado
+    TimerWheel::Handle deadline;
+    if (config_.handshake_timeout > 0) {
+        deadline = timers_.schedule(std::chrono::seconds(config_.handshake_timeout), [this, client_socket]{
+            handshake_timeouts_++;
+            shutdown(client_socket, SHUT_RDWR);
+        });
+    }
+
     try {
-        std::string initial_data = Utils::read_line(client_socket, read_buffer);
-        if (initial_data.empty()) {
+        // O primeiro byte decide a versão do protocolo desta conexão
+        while (read_buffer.buffered() == 0) {
+            ssize_t bytes_read = read_buffer.fill(client_socket);
+            if (bytes_read < 0 && errno == EINTR) continue;
+            if (bytes_read <= 0) break;
+        }
+        ProtocolVersion protocol = Utils::detect_protocol(read_buffer);
+
+        std::string_view initial_data;
+        bool got_frame = Utils::read_frame(client_socket, read_buffer, protocol, initial_data);
+        // Antes de qualquer close(): o fd não pode ser reutilizado com o prazo ainda ativo
+        deadline.cancel();
+        if (!got_frame || initial_data.empty()) {
             LOG_WARNING("Cliente " + client_addr + " desconectou antes do handshake.");
             close(client_socket);
             return;
         }
 
-        Message auth_msg = Message::deserialize(initial_data);
+        Message auth_msg = Message::decode(initial_data, protocol);
         username = auth_msg.username;
-        std::string password = auth_msg.password;
-        bool success = false;
-        std::string response_text;
+        // A thread da conexão só espera; o KDF corre no pool de autenticação
+        std::promise<std::pair<bool, std::string>> verdict;
+        std::future<std::pair<bool, std::string>> pending = verdict.get_future();
+        authenticate_async(auth_msg, [&verdict](bool ok, const std::string& text) {
+            verdict.set_value(std::make_pair(ok, text));
+        });
+        auto [success, response_text] = pending.get();
 
-        if (auth_msg.type == MessageType::LOGIN_REQUEST) {
-            if (user_db_.validate_user(username, password)) {
-                // Verificar se usuário já está online
-                {
-                    std::lock_guard<std::mutex> lock(online_users_mutex_);
-                    if (online_users_.count(username)) {
-                        success = false;
-                        response_text = "Utilizador já está online.";
-                    } else {
-                        success = true;
-                        response_text = "Login bem-sucedido!";
-                    }
-                }
-            } else {
-                response_text = "Nome ou senha inválidos.";
-            }
-        } else if (auth_msg.type == MessageType::REGISTER_REQUEST) {
-            if (user_db_.add_user(username, password)) {
-                success = true;
-                response_text = "Conta criada com sucesso!";
-            } else {
-                response_text = "Nome de utilizador já existe.";
-            }
-        } else {
-            response_text = "Pedido inválido.";
-        }
-
-        Message auth_response(success ? MessageType::AUTH_SUCCESS : MessageType::AUTH_FAILURE, 
-                             "SERVER", response_text);
-        std::string response_data = auth_response.serialize() + "\n";
+        Message auth_response = make_auth_response(success, response_text, username);
+        WireBuffer response_data = auth_response.to_wire(protocol);
         
-        ssize_t sent = send(client_socket, response_data.c_str(), response_data.length(), MSG_NOSIGNAL);
+        ssize_t sent = send(client_socket, response_data->data(), response_data->length(), MSG_NOSIGNAL);
         if (sent <= 0) {
             LOG_ERROR("Falha ao enviar resposta de autenticação para " + client_addr);
             close(client_socket);
@@ -177,39 +362,152 @@ void SimpleChatServer::handle_client(int client_socket, std::string client_addr)
 
         LOG_INFO(username + " conectado com sucesso de " + client_addr);
 
-        auto client_ptr = std::make_shared<ConnectedClient>(client_socket, username);
-        add_online_user(username, client_ptr);
+        client_ptr = std::make_shared<ConnectedClient>(client_socket, username, protocol, config_.outbound);
+        client_ptr->set_inbound_rate(config_.message_rate);
+        if (!client_ptr->start_sender_thread()) {
+            client_ptr.reset(); // fecha o socket
+            return;
+        }
+        session_counted = true;
+        {
+            std::lock_guard<std::mutex> lock(sessions_mutex_);
+            ++threaded_sessions_;
+        }
+        {
+            // Na mesma ordem dos broadcasts: cada um chega no replay ou em direto, nunca em nenhum
+            std::lock_guard<ProfiledMutex> lock(broadcast_order_mutex_);
+            add_online_user(username, client_ptr);
+            replay_history(client_ptr, auth_msg);
+        }
+        arm_heartbeat(client_ptr);
         
         while (running_.load() && client_ptr->is_active()) {
-            std::string data = client_ptr->receive_data_blocking(read_buffer);
-            if (data.empty()) break;
-            
-            Message msg = Message::deserialize(data);
-            total_messages_processed_++;
-            process_client_message(msg, client_ptr);
+            std::string_view data;
+            if (!client_ptr->receive_data_blocking(read_buffer, data) || data.empty()) break;
+            // O recv() bloqueante inclui a espera pelo cliente: aqui só se mede a partir do frame
+            handle_client_line(data, client_ptr, StageMetrics::now());
         }
     } catch (const std::exception& e) {
+        deadline.cancel();
         LOG_ERROR("Exceção ao lidar com cliente " + client_addr + ": " + e.what());
     }
     
-    if (!username.empty()) {
+    if (client_ptr) {
         LOG_INFO(username + " desconectado.");
-        remove_online_user(username);
+        remove_online_user(client_ptr);
+    }
+    if (session_counted) {
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+        if (--threaded_sessions_ == 0) sessions_cv_.notify_all();
     }
 }
 
+void SimpleChatServer::reactor_handshake(int client_socket, const std::string& client_addr,
+                                         std::string_view initial_data, ProtocolVersion protocol,
+                                         std::function<void()> wake, EpollReactor::HandshakeDone done) {
+    Message auth_msg = Message::decode(initial_data, protocol);
+    authenticate_async(auth_msg, [this, auth_msg, client_socket, client_addr, protocol,
+                                  wake = std::move(wake), done = std::move(done)](bool success,
+                                                                                 const std::string& response_text) {
+        std::string username = auth_msg.username;
+        Message auth_response = make_auth_response(success, response_text, username);
+        if (!success) {
+            done(EpollReactor::HandshakeResult{nullptr, auth_response.to_wire(protocol)});
+            return;
+        }
+
+        LOG_INFO(username + " conectado com sucesso de " + client_addr);
+
+        auto client_ptr = std::make_shared<ConnectedClient>(client_socket, username, protocol, config_.outbound);
+        client_ptr->set_inbound_rate(config_.message_rate);
+        client_ptr->attach_to_reactor(wake);
+        client_ptr->queue_message(auth_response);
+        {
+            // Na mesma ordem dos broadcasts: cada um chega no replay ou em direto, nunca em nenhum
+            std::lock_guard<ProfiledMutex> lock(broadcast_order_mutex_);
+            add_online_user(username, client_ptr);
+            replay_history(client_ptr, auth_msg);
+        }
+        arm_heartbeat(client_ptr);
+        done(EpollReactor::HandshakeResult{client_ptr, nullptr});
+    });
+}
+
+void SimpleChatServer::handle_client_line(std::string_view data, std::shared_ptr<ConnectedClient> client,
+                                          int64_t received_ns) {
+    int64_t start = StageMetrics::now();
+    Message msg = Message::decode(data, client->get_protocol());
+    StageMetrics::record(Stage::PARSE, start, StageMetrics::now());
+    msg.received_ns = received_ns;
+    // Só o histórico numera mensagens: um seq forjado num privado faria o
+    // destinatário descartar todos os broadcasts seguintes
+    msg.seq = 0;
+    TrafficCounters::bytes_in.add(data.size());
+    client->mark_activity();
+    total_messages_processed_++;
+    process_client_message(msg, client);
+}
+
 void SimpleChatServer::process_client_message(const Message& msg, std::shared_ptr<ConnectedClient> client) {
+    // Antes de qualquer fan-out ou log: uma rajada recusada custa só o CAS do bucket
+    if (client && msg.type != MessageType::PONG && msg.type != MessageType::DISCONNECT_REQUEST) {
+        bool notify = false;
+        if (!client->admit_inbound(notify)) {
+            throttled_messages_++;
+            if (notify) {
+                LOG_WARNING(client->get_username() + " excedeu o limite de mensagens.");
+                client->queue_message(Message(MessageType::ERROR_MSG, "SERVER",
+                                              "Demasiadas mensagens: aguarde antes de enviar mais."));
+            }
+            return;
+        }
+    }
+
     switch (msg.type) {
         case MessageType::CHAT_BROADCAST:
-            broadcast_message(msg);
+        {
+            Message stamped = msg;
+            filter_content(stamped);
+            size_t recipients;
+            {
+                std::lock_guard<ProfiledMutex> lock(broadcast_order_mutex_);
+                history_.append(stamped);
+                if (archive_) archive_->append(stamped);
+                recipients = broadcast_message(stamped);
+            }
             LOG_INFO("Mensagem de " + std::string(msg.username) + " retransmitida para " + 
-                    std::to_string(get_online_user_count() - 1) + " clientes");
+                    std::to_string(recipients > 0 ? recipients - 1 : 0) + " clientes");
             break;
+        }
         case MessageType::PRIVATE_MESSAGE:
-            send_private_message(msg);
+        {
+            Message filtered = msg;
+            filter_content(filtered);
+            if (archive_) archive_->append(filtered);
+            send_private_message(filtered);
             LOG_INFO("Mensagem privada de " + std::string(msg.username) + 
                     " para " + std::string(msg.target_user));
             break;
+        }
+        case MessageType::JOIN_ROOM:
+        case MessageType::LEAVE_ROOM:
+            if (client) handle_room_request(msg, client);
+            break;
+        case MessageType::ROOM_MESSAGE:
+            if (client) {
+                Message filtered = msg;
+                filter_content(filtered);
+                size_t recipients = send_room_message(filtered, client);
+                LOG_INFO("Mensagem de " + std::string(msg.username) + " na sala #" + msg.target_user +
+                         " retransmitida para " + std::to_string(recipients > 0 ? recipients - 1 : 0) + " membros");
+            }
+            break;
+        case MessageType::PING:
+            if (client) client->queue_message(Message(MessageType::PONG, "SERVER", ""));
+            break;
+        case MessageType::PONG:
+            // Basta ter chegado: handle_client_line já renovou a atividade
+            break;
         case MessageType::DISCONNECT_REQUEST:
             if(client) client->disconnect();
             break;
@@ -220,46 +518,129 @@ void SimpleChatServer::process_client_message(const Message& msg, std::shared_pt
     }
 }
 
+void SimpleChatServer::filter_content(Message& msg) {
+    int64_t start = StageMetrics::now();
+    filter_.apply(msg.content);
+    StageMetrics::record(Stage::FILTER, start, StageMetrics::now());
+}
+
+void SimpleChatServer::arm_heartbeat(const std::shared_ptr<ConnectedClient>& client) {
+    const int64_t heartbeat_ms = config_.heartbeat_interval * 1000LL;
+    const int64_t idle_limit_ms = config_.idle_timeout * 1000LL;
+    if (heartbeat_ms <= 0 && idle_limit_ms <= 0) return;
+
+    // Acorda no próximo instante em que há algo a decidir: o PING devido ou o fim do prazo
+    int64_t idle_ms = client->get_idle_ms();
+    int64_t delay_ms = INT64_MAX;
+    if (heartbeat_ms > 0) delay_ms = idle_ms < heartbeat_ms ? heartbeat_ms - idle_ms : heartbeat_ms;
+    if (idle_limit_ms > 0) delay_ms = std::min(delay_ms, idle_limit_ms - idle_ms);
+    delay_ms = std::max<int64_t>(delay_ms, timers_.tick().count());
+
+    // weak_ptr: o temporizador não prolonga a vida de uma sessão já terminada
+    std::weak_ptr<ConnectedClient> weak = client;
+    timers_.schedule(std::chrono::milliseconds(delay_ms), [this, weak]{ check_liveness(weak); });
+}
+
+void SimpleChatServer::check_liveness(const std::weak_ptr<ConnectedClient>& weak) {
+    std::shared_ptr<ConnectedClient> client = weak.lock();
+    if (!client || !client->is_active() || !running_.load()) return;
+
+    int64_t idle_ms = client->get_idle_ms();
+    if (config_.idle_timeout > 0 && idle_ms >= config_.idle_timeout * 1000LL) {
+        LOG_WARNING(client->get_username() + " sem atividade há " + std::to_string(idle_ms / 1000) +
+                    " s, conexão fechada.");
+        idle_disconnects_++;
+        // Corre na thread dos timers: fechar aqui o descritor competiria com as threads da sessão
+        client->request_close();
+        return;
+    }
+    if (config_.heartbeat_interval > 0 && idle_ms >= config_.heartbeat_interval * 1000LL) {
+        client->queue_message(Message(MessageType::PING, "SERVER", ""));
+    }
+    arm_heartbeat(client);
+}
+
+void SimpleChatServer::schedule_rate_prune() {
+    if (!connection_limiter_.enabled()) return;
+    timers_.schedule(std::chrono::seconds(30), [this]{
+        if (!running_.load()) return;
+        connection_limiter_.prune();
+        schedule_rate_prune();
+    });
+}
+
+void SimpleChatServer::schedule_filter_reload() {
+    if (config_.filter_file.empty()) return;
+    timers_.schedule(std::chrono::seconds(5), [this]{
+        if (!running_.load()) return;
+        filter_.reload_if_changed();
+        schedule_filter_reload();
+    });
+}
+
+std::shared_ptr<const SimpleChatServer::OnlineUsers> SimpleChatServer::online_snapshot() const {
+    return std::atomic_load(&online_users_);
+}
+
 void SimpleChatServer::add_online_user(const std::string& username, 
                                        std::shared_ptr<ConnectedClient> client) {
+    std::shared_ptr<const OnlineUsers> users;
     {
-        std::lock_guard<std::mutex> lock(online_users_mutex_);
-        online_users_[username] = client;
+        std::lock_guard<ProfiledMutex> lock(online_users_write_mutex_);
+        auto next = std::make_shared<OnlineUsers>(*std::atomic_load(&online_users_));
+        (*next)[username] = client;
+        users = std::move(next);
+        publish_online_users(users);
     }
     
-    client->start_sender_thread();
-    
     Message join_notification(MessageType::SERVER_MESSAGE, "SERVER", 
                              "*** " + username + " entrou no chat ***");
-    
-    std::lock_guard<std::mutex> lock(online_users_mutex_);
-    for (const auto& pair : online_users_) {
-        if (pair.first != username && pair.second) {
-            pair.second->queue_message(join_notification);
-        }
+    broadcast_message(join_notification, client.get());
+}
+
+void SimpleChatServer::publish_online_users(std::shared_ptr<const OnlineUsers> users) {
+    auto list = std::make_shared<ClientList>();
+    list->reserve(users->size());
+    for (const auto& pair : *users) {
+        if (pair.second) list->push_back(pair.second);
     }
+    std::atomic_store(&online_users_, std::move(users));
+    std::atomic_store(&online_list_, std::shared_ptr<const ClientList>(std::move(list)));
 }
 
-void SimpleChatServer::remove_online_user(const std::string& username) {
+void SimpleChatServer::remove_online_user(const std::shared_ptr<ConnectedClient>& client) {
+    const std::string& username = client->get_username();
+    bool removed = false;
     {
-        std::lock_guard<std::mutex> lock(online_users_mutex_);
-        if (online_users_.count(username)) {
-            online_users_.erase(username);
+        std::lock_guard<ProfiledMutex> lock(online_users_write_mutex_);
+        std::shared_ptr<const OnlineUsers> current = std::atomic_load(&online_users_);
+        auto it = current->find(username);
+        // Após uma retoma o nome já pode pertencer à nova sessão
+        if (it != current->end() && it->second == client) {
+            auto next = std::make_shared<OnlineUsers>(*current);
+            next->erase(username);
+            publish_online_users(std::move(next));
+            removed = true;
         }
     }
-    
+    retired_dropped_new_ += client->get_dropped_new();
+    retired_dropped_oldest_ += client->get_dropped_oldest();
+    if (client->was_evicted()) evicted_clients_++;
+    // As salas guardam o ponteiro da sessão, não o nome: sai sempre
+    rooms_.leave_all(client);
+    if (!removed) return;
+
+    resume_tokens_.release(username);
     Message leave_notification(MessageType::SERVER_MESSAGE, "SERVER", 
                               "*** " + username + " saiu do chat ***");
     broadcast_message(leave_notification);
 }
 
-void SimpleChatServer::broadcast_message(const Message& msg) {
-    std::lock_guard<std::mutex> lock(online_users_mutex_);
-    for (const auto& pair : online_users_) {
-        if (pair.second) {
-            pair.second->queue_message(msg);
-        }
-    }
+size_t SimpleChatServer::broadcast_message(const Message& msg, const ConnectedClient* skip) {
+    std::shared_ptr<const ClientList> clients = std::atomic_load(&online_list_);
+    size_t count = clients->size();
+    fanout_.deliver(std::move(clients), msg, skip);
+    return count;
 }
 
 void SimpleChatServer::send_private_message(const Message& msg) {
@@ -269,14 +650,17 @@ void SimpleChatServer::send_private_message(const Message& msg) {
     std::shared_ptr<ConnectedClient> target_client, sender_client;
     
     {
-        std::lock_guard<std::mutex> lock(online_users_mutex_);
-        if (online_users_.count(target)) target_client = online_users_.at(target);
-        if (online_users_.count(sender)) sender_client = online_users_.at(sender);
+        std::shared_ptr<const OnlineUsers> users = online_snapshot();
+        auto it = users->find(target);
+        if (it != users->end()) target_client = it->second;
+        it = users->find(sender);
+        if (it != users->end()) sender_client = it->second;
     }
     
     if (target_client && sender_client) {
-        target_client->queue_message(msg);
-        sender_client->queue_message(msg);
+        // Pelo fan-out para não ultrapassar broadcasts ainda a ser entregues
+        auto pair = std::make_shared<ClientList>(ClientList{target_client, sender_client});
+        fanout_.deliver(std::move(pair), msg);
     } else if (sender_client) {
         Message error_msg(MessageType::ERROR_MSG, "SERVER", 
                          "Utilizador '" + target + "' não encontrado.");
@@ -284,16 +668,63 @@ void SimpleChatServer::send_private_message(const Message& msg) {
     }
 }
 
+void SimpleChatServer::handle_room_request(const Message& msg, const std::shared_ptr<ConnectedClient>& client) {
+    std::string room = msg.target_user;
+    if (!Utils::is_valid_username(room)) {
+        client->queue_message(Message(MessageType::ERROR_MSG, "SERVER",
+                                      "Nome de sala inválido (3 a 15 caracteres alfanuméricos)."));
+        return;
+    }
+
+    if (msg.type == MessageType::LEAVE_ROOM) {
+        if (rooms_.leave(room, client)) {
+            client->queue_message(Message(MessageType::SERVER_MESSAGE, "SERVER", "Saiu da sala #" + room + "."));
+        } else {
+            client->queue_message(Message(MessageType::ERROR_MSG, "SERVER", "Não está na sala #" + room + "."));
+        }
+        return;
+    }
+
+    size_t members = 0;
+    switch (rooms_.join(room, client, members)) {
+        case RoomRegistry::JoinResult::JOINED:
+            LOG_INFO(client->get_username() + " entrou na sala #" + room);
+            client->queue_message(Message(MessageType::SERVER_MESSAGE, "SERVER",
+                                          "Entrou na sala #" + room + " (" + std::to_string(members) + " membros)."));
+            break;
+        case RoomRegistry::JoinResult::ALREADY_MEMBER:
+            client->queue_message(Message(MessageType::SERVER_MESSAGE, "SERVER", "Já está na sala #" + room + "."));
+            break;
+        case RoomRegistry::JoinResult::TOO_MANY_ROOMS:
+            client->queue_message(Message(MessageType::ERROR_MSG, "SERVER",
+                                          "Limite de " + std::to_string(RoomRegistry::MAX_ROOMS_PER_CLIENT) +
+                                          " salas por sessão atingido."));
+            break;
+    }
+}
+
+size_t SimpleChatServer::send_room_message(const Message& msg, const std::shared_ptr<ConnectedClient>& sender) {
+    std::shared_ptr<const RoomRegistry::Members> members = rooms_.members_if_member(msg.target_user, sender.get());
+    if (!members) {
+        sender->queue_message(Message(MessageType::ERROR_MSG, "SERVER",
+                                      "Não está na sala #" + std::string(msg.target_user) + "."));
+        return 0;
+    }
+    if (archive_) archive_->append(msg);
+    size_t count = members->size();
+    fanout_.deliver(std::move(members), msg);
+    return count;
+}
+
 int SimpleChatServer::get_online_user_count() const {
-    std::lock_guard<std::mutex> lock(online_users_mutex_);
-    return static_cast<int>(online_users_.size());
+    return static_cast<int>(online_snapshot()->size());
 }
 
 std::vector<std::string> SimpleChatServer::get_online_usernames() const {
-    std::lock_guard<std::mutex> lock(online_users_mutex_);
+    std::shared_ptr<const OnlineUsers> users = online_snapshot();
     std::vector<std::string> usernames;
-    usernames.reserve(online_users_.size());
-    for (const auto& pair : online_users_) {
+    usernames.reserve(users->size());
+    for (const auto& pair : *users) {
         usernames.push_back(pair.first);
     }
     return usernames;
@@ -304,9 +735,250 @@ void SimpleChatServer::print_stats() const {
     std::cout << "══════════════════════════════\n";
     std::cout << "  Clientes online: " << get_online_user_count() << "\n";
     std::cout << "  Total de conexões: " << total_connections_.load() << "\n";
+    if (acceptors_) {
+        AcceptorPool::Stats accept = acceptors_->stats();
+        std::cout << "  Aceitação (último segundo/pico): " << accept.last_second << "/" << accept.peak_second
+                  << " conexões/s, erros: " << accept.errors << "\n";
+        std::cout << "  Aceites por acceptor:";
+        for (uint64_t count : accept.per_acceptor) std::cout << " " << count;
+        std::cout << "\n";
+    }
     std::cout << "  Mensagens processadas: " << total_messages_processed_.load() << "\n";
     std::cout << "  Utilizadores registrados: " << user_db_.get_user_count() << "\n";
+    std::cout << "  Salas ativas: " << rooms_.room_count() << "\n";
+
+    uint64_t dropped_new = retired_dropped_new_.load();
+    uint64_t dropped_oldest = retired_dropped_oldest_.load();
+    size_t queued = 0;
+    for (const auto& pair : *online_snapshot()) {
+        dropped_new += pair.second->get_dropped_new();
+        dropped_oldest += pair.second->get_dropped_oldest();
+        queued += pair.second->get_queue_depth();
+    }
+    std::cout << "  Mensagens em filas de saída: " << queued << "\n";
+    std::cout << "  Descartadas (novas/antigas): " << dropped_new << "/" << dropped_oldest << "\n";
+    std::cout << "  Clientes lentos expulsos: " << evicted_clients_.load() << "\n";
+    std::cout << "  Limitados por taxa (mensagens/conexões): " << throttled_messages_.load() << "/"
+              << rejected_connections_.load() << " (IPs seguidos: " << connection_limiter_.size() << ")\n";
+    uint64_t handshake_timeouts = handshake_timeouts_.load() + (reactor_ ? reactor_->get_handshake_timeouts() : 0);
+    std::shared_ptr<const FilterAutomaton> filter = filter_.current();
+    std::cout << "  Filtro de conteúdo: " << filter->word_count() << " palavras, "
+              << filter_.get_filtered() << " mensagens censuradas\n";
+    std::cout << "  Temporizadores ativos: " << timers_.size() << "\n";
+    std::cout << "  Expirados (handshake/inatividade): " << handshake_timeouts << "/" << idle_disconnects_.load() << "\n";
+    std::cout << "  Fan-out (em linha/paralelo): " << fanout_.get_inline() << "/" << fanout_.get_parallel() << "\n";
+
+    AuthPool::LatencyStats auth = auth_pool_.latency();
+    std::cout << "  Autenticações (concluídas/recusadas): " << auth_pool_.get_completed()
+              << "/" << auth_pool_.get_rejected() << "\n";
+    std::cout << std::fixed << std::setprecision(1)
+              << "  Latência de autenticação p50/p95/p99/máx: " << auth.p50_ms << "/" << auth.p95_ms
+              << "/" << auth.p99_ms << "/" << auth.max_ms << " ms\n";
+    std::cout.unsetf(std::ios::floatfield);
+    if (archive_) {
+        std::cout << "  Arquivo (gravadas/descartadas): " << archive_->get_written()
+                  << "/" << archive_->get_dropped() << "\n";
+    }
+    if (StageMetrics::enabled()) {
+        std::cout << "  Latência por estágio (µs)     amostras      p50      p99    p99.9     máx\n";
+        for (const StageMetrics::Summary& stage : StageMetrics::summarize()) {
+            std::cout << "    " << std::left << std::setw(26) << StageMetrics::name(stage.stage) << std::right
+                      << std::setw(10) << stage.count << std::fixed << std::setprecision(1)
+                      << std::setw(9) << stage.p50_ns / 1000.0 << std::setw(9) << stage.p99_ns / 1000.0
+                      << std::setw(9) << stage.p999_ns / 1000.0 << std::setw(8) << stage.max_ns / 1000.0 << "\n";
+        }
+        std::cout.unsetf(std::ios::floatfield);
+    }
     std::cout << "══════════════════════════════\n" << std::endl;
 }
 
-} 
+std::string SimpleChatServer::stats_json() const {
+    uint64_t dropped_new = retired_dropped_new_.load();
+    uint64_t dropped_oldest = retired_dropped_oldest_.load();
+    size_t queued = 0;
+    for (const auto& pair : *online_snapshot()) {
+        dropped_new += pair.second->get_dropped_new();
+        dropped_oldest += pair.second->get_dropped_oldest();
+        queued += pair.second->get_queue_depth();
+    }
+    uint64_t handshake_timeouts = handshake_timeouts_.load() + (reactor_ ? reactor_->get_handshake_timeouts() : 0);
+
+    std::string out = "{";
+    out += "\"online\":" + std::to_string(get_online_user_count());
+    out += ",\"connections\":" + std::to_string(total_connections_.load());
+    out += ",\"messages\":" + std::to_string(total_messages_processed_.load());
+    out += ",\"queued\":" + std::to_string(queued);
+    out += ",\"dropped_new\":" + std::to_string(dropped_new);
+    out += ",\"dropped_oldest\":" + std::to_string(dropped_oldest);
+    out += ",\"evicted\":" + std::to_string(evicted_clients_.load());
+    out += ",\"throttled_messages\":" + std::to_string(throttled_messages_.load());
+    out += ",\"rejected_connections\":" + std::to_string(rejected_connections_.load());
+    out += ",\"handshake_timeouts\":" + std::to_string(handshake_timeouts);
+    out += ",\"idle_disconnects\":" + std::to_string(idle_disconnects_.load());
+    out += ",\"filtered\":" + std::to_string(filter_.get_filtered());
+    out += ",\"stage_metrics\":" + std::string(StageMetrics::enabled() ? "true" : "false");
+    out += ",\"stages_ns\":" + StageMetrics::to_json();
+    out += "}";
+    return out;
+}
+
+
+namespace {
+void metric_family(std::string& out, const char* name, const char* type, const char* help) {
+    out += "# HELP ";
+    out += name;
+    out += " ";
+    out += help;
+    out += "\n# TYPE ";
+    out += name;
+    out += " ";
+    out += type;
+    out += "\n";
+}
+
+void metric_value(std::string& out, const std::string& series, double value) {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.9g", value);
+    out += series + " " + buffer + "\n";
+}
+
+void metric_value(std::string& out, const std::string& series, uint64_t value) {
+    out += series + " " + std::to_string(value) + "\n";
+}
+
+// Valor de label entre aspas, com os escapes do formato de texto
+std::string label_value(const std::string& value) {
+    std::string out = "\"";
+    for (char c : value) {
+        if (c == '\\' || c == '"') out += '\\';
+        if (c == '\n') {
+            out += "\\n";
+            continue;
+        }
+        out += c;
+    }
+    return out + "\"";
+}
+}
+
+std::string SimpleChatServer::metrics_text() const {
+    std::string out;
+    std::shared_ptr<const OnlineUsers> users = online_snapshot();
+
+    metric_family(out, "chat_connections_total", "counter", "Conexões autenticadas desde o arranque.");
+    metric_value(out, "chat_connections_total", static_cast<uint64_t>(total_connections_.load()));
+    metric_family(out, "chat_online_clients", "gauge", "Clientes online.");
+    metric_value(out, "chat_online_clients", static_cast<uint64_t>(users->size()));
+    metric_family(out, "chat_messages_processed_total", "counter", "Mensagens recebidas de clientes autenticados.");
+    metric_value(out, "chat_messages_processed_total", static_cast<uint64_t>(total_messages_processed_.load()));
+    metric_family(out, "chat_received_bytes_total", "counter", "Bytes de mensagens recebidos dos clientes.");
+    metric_value(out, "chat_received_bytes_total", TrafficCounters::bytes_in.load());
+    metric_family(out, "chat_sent_bytes_total", "counter", "Bytes escritos nos sockets dos clientes.");
+    metric_value(out, "chat_sent_bytes_total", TrafficCounters::bytes_out.load());
+
+    uint64_t dropped_new = retired_dropped_new_.load();
+    uint64_t dropped_oldest = retired_dropped_oldest_.load();
+    metric_family(out, "chat_client_queue_depth", "gauge", "Mensagens na fila de saída de cada cliente.");
+    for (const auto& [username, client] : *users) {
+        metric_value(out, "chat_client_queue_depth{user=" + label_value(username) + "}",
+                     static_cast<uint64_t>(client->get_queue_depth()));
+        dropped_new += client->get_dropped_new();
+        dropped_oldest += client->get_dropped_oldest();
+    }
+    metric_family(out, "chat_client_queued_bytes", "gauge", "Bytes na fila de saída de cada cliente.");
+    for (const auto& [username, client] : *users) {
+        metric_value(out, "chat_client_queued_bytes{user=" + label_value(username) + "}",
+                     static_cast<uint64_t>(client->get_queued_bytes()));
+    }
+    metric_family(out, "chat_dropped_messages_total", "counter",
+                  "Mensagens descartadas por filas de saída cheias, por política.");
+    metric_value(out, "chat_dropped_messages_total{policy=\"drop_new\"}", dropped_new);
+    metric_value(out, "chat_dropped_messages_total{policy=\"drop_oldest\"}", dropped_oldest);
+    metric_family(out, "chat_evicted_clients_total", "counter", "Clientes lentos expulsos.");
+    metric_value(out, "chat_evicted_clients_total", evicted_clients_.load());
+    metric_family(out, "chat_throttled_messages_total", "counter", "Mensagens recusadas pelo limite por sessão.");
+    metric_value(out, "chat_throttled_messages_total", throttled_messages_.load());
+    metric_family(out, "chat_rejected_connections_total", "counter", "Conexões recusadas pelo limite por IP.");
+    metric_value(out, "chat_rejected_connections_total", rejected_connections_.load());
+    metric_family(out, "chat_filtered_messages_total", "counter", "Mensagens censuradas pelo filtro de conteúdo.");
+    metric_value(out, "chat_filtered_messages_total", filter_.get_filtered());
+
+    uint64_t handshake_timeouts = handshake_timeouts_.load() + (reactor_ ? reactor_->get_handshake_timeouts() : 0);
+    metric_family(out, "chat_timeouts_total", "counter", "Conexões fechadas por prazo expirado.");
+    metric_value(out, "chat_timeouts_total{kind=\"handshake\"}", handshake_timeouts);
+    metric_value(out, "chat_timeouts_total{kind=\"idle\"}", idle_disconnects_.load());
+    metric_family(out, "chat_timers_active", "gauge", "Temporizadores agendados na roda.");
+    metric_value(out, "chat_timers_active", static_cast<uint64_t>(timers_.size()));
+    metric_family(out, "chat_fanout_jobs_total", "counter", "Fan-outs feitos na thread de quem envia ou pelo pool.");
+    metric_value(out, "chat_fanout_jobs_total{path=\"inline\"}", fanout_.get_inline());
+    metric_value(out, "chat_fanout_jobs_total{path=\"parallel\"}", fanout_.get_parallel());
+
+    metric_family(out, "chat_auth_completed_total", "counter", "Autenticações concluídas pelo pool.");
+    metric_value(out, "chat_auth_completed_total", auth_pool_.get_completed());
+    metric_family(out, "chat_auth_rejected_total", "counter", "Pedidos de login recusados com a fila cheia.");
+    metric_value(out, "chat_auth_rejected_total", auth_pool_.get_rejected());
+    metric_family(out, "chat_auth_queue_depth", "gauge", "Pedidos de login à espera de um worker.");
+    metric_value(out, "chat_auth_queue_depth", static_cast<uint64_t>(auth_pool_.get_queue_depth()));
+    AuthPool::LatencyStats auth = auth_pool_.latency();
+    metric_family(out, "chat_auth_latency_seconds", "gauge",
+                  "Latência de autenticação nas amostras mais recentes, por quantil.");
+    metric_value(out, "chat_auth_latency_seconds{quantile=\"0.5\"}", auth.p50_ms / 1e3);
+    metric_value(out, "chat_auth_latency_seconds{quantile=\"0.95\"}", auth.p95_ms / 1e3);
+    metric_value(out, "chat_auth_latency_seconds{quantile=\"0.99\"}", auth.p99_ms / 1e3);
+    metric_value(out, "chat_auth_latency_seconds{quantile=\"1\"}", auth.max_ms / 1e3);
+
+    tslog::Logger& logger = tslog::Logger::getInstance();
+    metric_family(out, "chat_log_ring_occupancy", "gauge", "Registos no anel do log assíncrono por gravar.");
+    metric_value(out, "chat_log_ring_occupancy", static_cast<uint64_t>(logger.ring_occupancy()));
+    metric_family(out, "chat_log_ring_capacity", "gauge", "Capacidade do anel do log assíncrono (0 = log síncrono).");
+    metric_value(out, "chat_log_ring_capacity", static_cast<uint64_t>(logger.ring_capacity()));
+    metric_family(out, "chat_log_dropped_total", "counter", "Registos descartados com o anel cheio.");
+    metric_value(out, "chat_log_dropped_total", logger.dropped_count());
+
+    if (archive_) {
+        metric_family(out, "chat_archive_records_total", "counter", "Mensagens gravadas e descartadas pelo arquivo.");
+        metric_value(out, "chat_archive_records_total{result=\"written\"}", archive_->get_written());
+        metric_value(out, "chat_archive_records_total{result=\"dropped\"}", archive_->get_dropped());
+    }
+
+    if (StageMetrics::enabled()) {
+        metric_family(out, "chat_stage_latency_seconds", "summary", "Latência de cada estágio do caminho das mensagens.");
+        for (const StageMetrics::Summary& stage : StageMetrics::summarize()) {
+            std::string label = "stage=\"" + std::string(StageMetrics::name(stage.stage)) + "\"";
+            metric_value(out, "chat_stage_latency_seconds{" + label + ",quantile=\"0.5\"}", stage.p50_ns / 1e9);
+            metric_value(out, "chat_stage_latency_seconds{" + label + ",quantile=\"0.99\"}", stage.p99_ns / 1e9);
+            metric_value(out, "chat_stage_latency_seconds{" + label + ",quantile=\"0.999\"}", stage.p999_ns / 1e9);
+            metric_value(out, "chat_stage_latency_seconds_sum{" + label + "}", stage.mean_ns * stage.count / 1e9);
+            metric_value(out, "chat_stage_latency_seconds_count{" + label + "}", stage.count);
+        }
+    }
+
+    if (LockProfiler::ENABLED) {
+        std::vector<LockReport> locks = LockProfiler::report();
+        metric_family(out, "chat_lock_acquisitions_total", "counter", "Aquisições de cada site de lock.");
+        for (const LockReport& lock : locks) {
+            metric_value(out, "chat_lock_acquisitions_total{lock=" + label_value(lock.name) + "}", lock.acquisitions);
+        }
+        metric_family(out, "chat_lock_contended_total", "counter", "Aquisições que tiveram de esperar pelo lock.");
+        for (const LockReport& lock : locks) {
+            metric_value(out, "chat_lock_contended_total{lock=" + label_value(lock.name) + "}", lock.contended);
+        }
+        metric_family(out, "chat_lock_wait_seconds", "summary", "Espera das aquisições com contenção.");
+        for (const LockReport& lock : locks) {
+            std::string label = "lock=" + label_value(lock.name);
+            metric_value(out, "chat_lock_wait_seconds{" + label + ",quantile=\"0.5\"}", lock.wait_p50_ns / 1e9);
+            metric_value(out, "chat_lock_wait_seconds{" + label + ",quantile=\"0.99\"}", lock.wait_p99_ns / 1e9);
+            metric_value(out, "chat_lock_wait_seconds_sum{" + label + "}", lock.wait_total_ns / 1e9);
+            metric_value(out, "chat_lock_wait_seconds_count{" + label + "}", lock.contended);
+        }
+        metric_family(out, "chat_lock_hold_seconds", "gauge", "Tempo de posse exclusiva, por quantil.");
+        for (const LockReport& lock : locks) {
+            std::string label = "lock=" + label_value(lock.name);
+            metric_value(out, "chat_lock_hold_seconds{" + label + ",quantile=\"0.5\"}", lock.hold_p50_ns / 1e9);
+            metric_value(out, "chat_lock_hold_seconds{" + label + ",quantile=\"0.99\"}", lock.hold_p99_ns / 1e9);
+        }
+    }
+    return out;
+}
+
+}
@@ -0,0 +1,99 @@
+#include "stage_metrics.h"
+#include "hdr_histogram.h"
+#include "sharded_counter.h"
+#include <chrono>
+#include <cstdio>
+#include <memory>
+
+namespace chat {
+
+std::atomic<bool> StageMetrics::enabled_(true);
+
+namespace {
+const size_t STAGE_COUNT = static_cast<size_t>(Stage::COUNT);
+
+struct Shard {
+    HdrHistogram histograms[STAGE_COUNT];
+};
+
+// Nunca libertados: uma thread pode registar até ao fim do processo
+std::atomic<Shard*> shards[THREAD_SHARDS];
+
+Shard* shard_for_thread() {
+    thread_local Shard* local = nullptr;
+    if (local) return local;
+    std::atomic<Shard*>& slot = shards[thread_shard()];
+    Shard* shard = slot.load(std::memory_order_acquire);
+    if (!shard) {
+        Shard* created = new Shard();
+        if (slot.compare_exchange_strong(shard, created, std::memory_order_acq_rel)) {
+            shard = created;
+        } else {
+            delete created;
+        }
+    }
+    local = shard;
+    return local;
+}
+}
+
+int64_t StageMetrics::now() {
+    if (!enabled()) return 0;
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void StageMetrics::record_value(Stage stage, uint64_t ns) {
+    shard_for_thread()->histograms[static_cast<size_t>(stage)].record(ns);
+}
+
+const char* StageMetrics::name(Stage stage) {
+    switch (stage) {
+        case Stage::READ: return "read";
+        case Stage::PARSE: return "parse";
+        case Stage::FILTER: return "filter";
+        case Stage::FANOUT: return "fanout";
+        case Stage::QUEUE_WAIT: return "queue_wait";
+        case Stage::WRITE: return "write";
+        case Stage::END_TO_END: return "end_to_end";
+        default: return "?";
+    }
+}
+
+std::vector<StageMetrics::Summary> StageMetrics::summarize() {
+    std::vector<Summary> result;
+    for (size_t s = 0; s < STAGE_COUNT; ++s) {
+        // Alocado: cada histograma tem dezenas de KB
+        auto merged = std::make_unique<HdrHistogram>();
+        for (auto& slot : shards) {
+            Shard* shard = slot.load(std::memory_order_acquire);
+            if (shard) merged->merge(shard->histograms[s]);
+        }
+        result.push_back(Summary{static_cast<Stage>(s), merged->count(), merged->mean(),
+                                 merged->percentile(0.50), merged->percentile(0.99),
+                                 merged->percentile(0.999), merged->max()});
+    }
+    return result;
+}
+
+std::string StageMetrics::to_json() {
+    std::string out = "{";
+    char buffer[256];
+    bool first = true;
+    for (const Summary& summary : summarize()) {
+        snprintf(buffer, sizeof(buffer),
+                 "%s\"%s\":{\"count\":%llu,\"mean_ns\":%.0f,\"p50_ns\":%llu,\"p99_ns\":%llu,"
+                 "\"p999_ns\":%llu,\"max_ns\":%llu}",
+                 first ? "" : ",", name(summary.stage), static_cast<unsigned long long>(summary.count),
+                 summary.mean_ns, static_cast<unsigned long long>(summary.p50_ns),
+                 static_cast<unsigned long long>(summary.p99_ns),
+                 static_cast<unsigned long long>(summary.p999_ns),
+                 static_cast<unsigned long long>(summary.max_ns));
+        out += buffer;
+        first = false;
+    }
+    out += "}";
+    return out;
+}
+
+}
@@ -0,0 +1,441 @@
+#include "read_buffer.h"
+#include "chat_common.h"
+#include "mpsc_queue.h"
+#include "timer_wheel.h"
+#include "history_ring.h"
+#include "password_hash.h"
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <atomic>
+#include <cerrno>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Verificações automáticas das peças do servidor que não precisam de rede
+// (./test_chat). Cada grupo imprime uma linha por verificação e o processo
+// sai com código != 0 se alguma falhar.
+
+using namespace chat;
+
+bool check(bool condition, const std::string& name, const std::string& detail) {
+    std::cout << (condition ? "  OK      " : "  FALHOU  ") << name << " (" << detail << ")" << std::endl;
+    return condition;
+}
+
+// --- ReadBuffer ---
+
+// Escreve bytes numa ponta de um socketpair e faz um fill() na outra
+bool feed(int fds[2], ReadBuffer& buffer, const std::string& bytes) {
+    if (send(fds[1], bytes.data(), bytes.size(), 0) != static_cast<ssize_t>(bytes.size())) return false;
+    return buffer.fill(fds[0]) == static_cast<ssize_t>(bytes.size());
+}
+
+// Repete fill() até haver uma linha completa, como o servidor faz
+std::string read_line(int fd, ReadBuffer& buffer) {
+    std::string_view line;
+    while (!buffer.next_line(line)) {
+        if (buffer.fill(fd, MSG_DONTWAIT) <= 0) return "<sem linha>";
+    }
+    return std::string(line);
+}
+
+bool run_read_buffer_checks() {
+    std::cout << "ReadBuffer" << std::endl;
+    bool ok = true;
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+        return check(false, "socketpair", std::to_string(errno));
+    }
+
+    ReadBuffer buffer;
+    std::string_view line;
+    feed(fds, buffer, "abc\ndef\ngh");
+    bool first = buffer.next_line(line) && line == "abc";
+    bool second = buffer.next_line(line) && line == "def";
+    bool partial = !buffer.next_line(line) && buffer.buffered() == 2;
+    ok &= check(first && second && partial, "várias linhas num só recv()", "abc, def e \"gh\" pendente");
+
+    feed(fds, buffer, "i\n");
+    std::string joined = read_line(fds[0], buffer);
+    ok &= check(joined == "ghi", "linha partida entre dois recv()", joined);
+
+    // Capacidade inicial pequena: a linha parcial é movida para o início e o buffer cresce
+    ReadBuffer small(8, 64);
+    feed(fds, small, "12345\n67");
+    std::string head = read_line(fds[0], small);
+    send(fds[1], "89abcdefghijklm\n", 16, 0);
+    std::string grown = read_line(fds[0], small);
+    ok &= check(head == "12345" && grown == "6789abcdefghijklm", "linha maior que a capacidade inicial", grown);
+
+    ReadBuffer bounded(8, 16);
+    std::string oversized(16, 'x');
+    feed(fds, bounded, oversized.substr(0, 8));
+    feed(fds, bounded, oversized.substr(8));
+    errno = 0;
+    bool rejected = bounded.fill(fds[0], MSG_DONTWAIT) == -1 && errno == EMSGSIZE;
+    ok &= check(rejected, "linha acima de max_size falha com EMSGSIZE", std::to_string(errno));
+
+    close(fds[0]);
+    close(fds[1]);
+    return ok;
+}
+
+// --- Protocolo v1/v2 ---
+
+Message sample_message(uint64_t seq) {
+    Message msg(MessageType::PRIVATE_MESSAGE, "alice", "ola | com separador\ne quebra");
+    strncpy(msg.password, "segredo", MAX_PASSWORD_SIZE - 1);
+    strncpy(msg.target_user, "bob", MAX_USERNAME_SIZE - 1);
+    msg.seq = seq;
+    return msg;
+}
+
+bool same_message(const Message& a, const Message& b) {
+    return a.type == b.type && a.seq == b.seq &&
+           strcmp(a.username, b.username) == 0 && strcmp(a.password, b.password) == 0 &&
+           strcmp(a.target_user, b.target_user) == 0 && strcmp(a.content, b.content) == 0;
+}
+
+bool run_protocol_checks() {
+    std::cout << "Protocolo" << std::endl;
+    bool ok = true;
+
+    Message with_seq = sample_message(0x0102030405060708ULL);
+    WireBuffer wire = with_seq.to_wire(ProtocolVersion::V2_BINARY);
+    Message decoded = Message::decode(*wire, ProtocolVersion::V2_BINARY);
+    ok &= check(same_message(with_seq, decoded), "v2: to_wire/decode preserva todos os campos e o seq",
+                std::to_string(wire->size()) + " bytes");
+
+    Message without_seq = sample_message(0);
+    WireBuffer plain = without_seq.to_wire(ProtocolVersion::V2_BINARY);
+    bool no_flag = (static_cast<uint8_t>((*plain)[2]) & PROTOCOL_V2_FLAG_SEQ) == 0 &&
+                   plain->size() + PROTOCOL_V2_SEQ_SIZE == wire->size();
+    ok &= check(no_flag && same_message(without_seq, Message::decode(*plain, ProtocolVersion::V2_BINARY)),
+                "v2: sem seq não leva a flag nem os 8 bytes", std::to_string(plain->size()) + " bytes");
+
+    Message broadcast(MessageType::CHAT_BROADCAST, "alice", "ola a todos");
+    broadcast.seq = 42;
+    WireBuffer line = broadcast.to_wire(ProtocolVersion::V1_TEXT);
+    Message from_line = Message::decode(std::string_view(*line).substr(0, line->size() - 1), ProtocolVersion::V1_TEXT);
+    ok &= check(line->back() == '\n' && same_message(broadcast, from_line), "v1: to_wire/decode com seq",
+                line->substr(0, line->size() - 1));
+
+    std::string truncated = wire->substr(0, wire->size() - 1);
+    bool rejected = Message::decode(truncated, ProtocolVersion::V2_BINARY).type == MessageType::ERROR_MSG;
+    ok &= check(rejected, "v2: frame com tamanho errado vira ERROR_MSG", "último byte cortado");
+
+    // Dois frames v2 seguidos, entregues um byte de cada vez
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+        return check(false, "socketpair", std::to_string(errno));
+    }
+    std::string stream = *wire + *plain;
+    ReadBuffer buffer;
+    std::vector<Message> frames;
+    for (char byte : stream) {
+        feed(fds, buffer, std::string(1, byte));
+        std::string_view frame;
+        while (Utils::next_frame(buffer, Utils::detect_protocol(buffer), frame)) {
+            frames.push_back(Message::decode(frame, ProtocolVersion::V2_BINARY));
+        }
+    }
+    bool split_ok = frames.size() == 2 && same_message(frames[0], with_seq) && same_message(frames[1], without_seq);
+    ok &= check(split_ok && buffer.buffered() == 0, "v2: next_frame remonta frames partidos byte a byte",
+                std::to_string(frames.size()) + " frames");
+    close(fds[0]);
+    close(fds[1]);
+    return ok;
+}
+
+// --- MpscRing / MpscQueue ---
+
+bool run_mpsc_checks() {
+    std::cout << "MpscRing / MpscQueue" << std::endl;
+    bool ok = true;
+
+    MpscRing<int> ring(5);
+    int pushed = 0;
+    while (ring.try_push(int(pushed))) ++pushed;
+    ok &= check(ring.capacity() == 8 && pushed == 8, "capacidade arredonda para potência de 2 e recusa quando cheia",
+                std::to_string(pushed) + " de " + std::to_string(ring.capacity()));
+
+    // Várias voltas ao anel com metade ocupada: a ordem FIFO mantém-se
+    bool fifo = true;
+    int next_out = 0, value = 0;
+    for (int i = 0; i < 4; ++i) fifo &= ring.try_pop(value) && value == next_out++;
+    for (int round = 0; round < 100; ++round) {
+        fifo &= ring.try_push(int(pushed++));
+        fifo &= ring.try_pop(value) && value == next_out++;
+    }
+    while (ring.try_pop(value)) fifo &= value == next_out++;
+    ok &= check(fifo && next_out == pushed, "FIFO ao dar a volta ao anel", std::to_string(next_out) + " itens");
+
+    // Vários produtores contra um consumidor: nada se perde e a ordem de cada produtor mantém-se
+    const int PRODUCERS = 4;
+    const int PER_PRODUCER = 50000;
+    MpscRing<uint64_t> shared(64);
+    std::vector<std::thread> producers;
+    for (int p = 0; p < PRODUCERS; ++p) {
+        producers.emplace_back([&shared, p] {
+            for (uint64_t i = 0; i < PER_PRODUCER; ++i) {
+                uint64_t item = (static_cast<uint64_t>(p) << 32) | i;
+                while (!shared.try_push(std::move(item))) std::this_thread::yield();
+            }
+        });
+    }
+    std::vector<uint64_t> expected(PRODUCERS, 0);
+    bool ordered = true;
+    int received = 0;
+    uint64_t item;
+    while (received < PRODUCERS * PER_PRODUCER) {
+        if (!shared.try_pop(item)) {
+            std::this_thread::yield();
+            continue;
+        }
+        size_t producer = item >> 32;
+        ordered &= producer < expected.size() && (item & 0xFFFFFFFFu) == expected[producer]++;
+        ++received;
+    }
+    for (auto& producer : producers) producer.join();
+    ok &= check(ordered && !shared.try_pop(item), "produtores concorrentes sem perdas nem reordenação",
+                std::to_string(received) + " itens de " + std::to_string(PRODUCERS) + " threads");
+
+    // wait() dorme no eventfd até um push de outra thread, e shutdown() acorda-o
+    MpscQueue<int> queue(16);
+    std::thread late_producer([&queue] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        queue.push(7);
+    });
+    bool woke = queue.wait(5000) && queue.try_pop(value) && value == 7;
+    late_producer.join();
+    ok &= check(woke, "MpscQueue::wait() acorda com um push", std::to_string(value));
+
+    std::thread stopper([&queue] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        queue.shutdown();
+    });
+    auto start = std::chrono::steady_clock::now();
+    bool empty_after_shutdown = !queue.wait(5000);
+    auto waited = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    stopper.join();
+    ok &= check(empty_after_shutdown && waited.count() < 5000 && !queue.push(8),
+                "shutdown() acorda wait() e recusa novos push", std::to_string(waited.count()) + "ms");
+    return ok;
+}
+
+// --- TimerWheel ---
+
+bool run_timer_wheel_checks() {
+    std::cout << "TimerWheel" << std::endl;
+    bool ok = true;
+    using Clock = std::chrono::steady_clock;
+    using std::chrono::milliseconds;
+
+    TimerWheel wheel(milliseconds(1));
+    wheel.start();
+    Clock::time_point start = Clock::now();
+
+    // Agendados fora de ordem; 150 ms passa do nível 0 (64 ticks) e tem de descer
+    std::mutex fired_mutex;
+    std::vector<std::pair<int, long>> fired;
+    for (int delay : {40, 10, 150, 25}) {
+        wheel.schedule(milliseconds(delay), [&fired_mutex, &fired, delay, start] {
+            long elapsed = std::chrono::duration_cast<milliseconds>(Clock::now() - start).count();
+            std::lock_guard<std::mutex> lock(fired_mutex);
+            fired.emplace_back(delay, elapsed);
+        });
+    }
+    std::atomic<bool> cancelled_ran{false};
+    TimerWheel::Handle handle = wheel.schedule(milliseconds(20), [&cancelled_ran] { cancelled_ran = true; });
+    handle.cancel();
+
+    std::this_thread::sleep_for(milliseconds(400));
+    std::vector<std::pair<int, long>> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(fired_mutex);
+        snapshot = fired;
+    }
+    bool in_order = snapshot.size() == 4;
+    bool never_early = true;
+    std::string detail;
+    for (size_t i = 0; i < snapshot.size(); ++i) {
+        if (i > 0) in_order &= snapshot[i - 1].first < snapshot[i].first;
+        never_early &= snapshot[i].second >= snapshot[i].first;
+        detail += (i ? ", " : "") + std::to_string(snapshot[i].first) + "→" + std::to_string(snapshot[i].second) + "ms";
+    }
+    ok &= check(in_order, "expiram uma vez cada, por ordem de atraso", detail);
+    ok &= check(never_early, "nunca antes do atraso pedido (incluindo a descida de nível)", detail);
+    ok &= check(!cancelled_ran && wheel.size() == 0, "cancel() impede o callback", "tamanho " + std::to_string(wheel.size()));
+
+    std::atomic<bool> pending_ran{false};
+    wheel.schedule(milliseconds(10000), [&pending_ran] { pending_ran = true; });
+    bool armed = wheel.size() == 1;
+    wheel.stop();
+    bool refused = !wheel.schedule(milliseconds(1), [] {});
+    ok &= check(armed && wheel.size() == 0 && !pending_ran && refused,
+                "stop() descarta os pendentes e recusa novos", "tamanho " + std::to_string(wheel.size()));
+    return ok;
+}
+
+// --- HistoryRing ---
+
+// Separa um replay nos frames que o cliente receberia
+std::vector<Message> decode_backlog(const std::string& bytes, ProtocolVersion version) {
+    std::vector<Message> messages;
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) return messages;
+    ReadBuffer buffer;
+    std::string_view frame;
+    if (bytes.empty() || feed(fds, buffer, bytes)) {
+        while (Utils::next_frame(buffer, version, frame)) messages.push_back(Message::decode(frame, version));
+    }
+    close(fds[0]);
+    close(fds[1]);
+    return messages;
+}
+
+// Os seq das mensagens são consecutivos de first a last e o conteúdo corresponde ao seq
+bool replay_matches(const std::vector<Message>& messages, uint64_t first, uint64_t last) {
+    if (messages.size() != last - first + 1) return false;
+    for (size_t i = 0; i < messages.size(); ++i) {
+        uint64_t seq = first + i;
+        if (messages[i].seq != seq || std::string(messages[i].content) != "msg " + std::to_string(seq)) return false;
+    }
+    return true;
+}
+
+bool run_history_checks() {
+    std::cout << "HistoryRing" << std::endl;
+    bool ok = true;
+
+    HistoryRing ring(8);
+    HistoryRing other(8);
+    bool hex = ring.epoch().size() == 12 &&
+               ring.epoch().find_first_not_of("0123456789abcdef") == std::string::npos;
+    ok &= check(hex && ring.epoch().size() < static_cast<size_t>(MAX_USERNAME_SIZE) && ring.epoch() != other.epoch(),
+                "época: 12 dígitos hex, diferente a cada instância", ring.epoch() + " / " + other.epoch());
+
+    // O seq vem sempre do anel, mesmo que a mensagem já traga um
+    bool numbered = true;
+    for (uint64_t i = 1; i <= 5; ++i) {
+        Message msg(MessageType::CHAT_BROADCAST, "alice", "msg " + std::to_string(i));
+        msg.seq = 1000;
+        numbered &= ring.append(msg) == i && msg.seq == i;
+    }
+    ok &= check(numbered && ring.last_seq() == 5, "append() numera 1, 2, 3... e ignora o seq recebido",
+                "último " + std::to_string(ring.last_seq()));
+
+    std::string out;
+    size_t count = ring.encode_since(0, ProtocolVersion::V1_TEXT, out);
+    ok &= check(count == 5 && replay_matches(decode_backlog(out, ProtocolVersion::V1_TEXT), 1, 5),
+                "replay completo antes de o anel dar a volta", std::to_string(count) + " mensagens");
+
+    for (uint64_t i = 6; i <= 20; ++i) {
+        Message msg(MessageType::CHAT_BROADCAST, "alice", "msg " + std::to_string(i));
+        ring.append(msg);
+    }
+    out.clear();
+    count = ring.encode_since(3, ProtocolVersion::V2_BINARY, out);
+    ok &= check(count == 8 && replay_matches(decode_backlog(out, ProtocolVersion::V2_BINARY), 13, 20),
+                "depois de dar a volta só reenvia o que ainda está no anel", "seq 13 a 20 de " + std::to_string(count));
+
+    out.clear();
+    count = ring.encode_since(15, ProtocolVersion::V2_BINARY, out);
+    ok &= check(count == 5 && replay_matches(decode_backlog(out, ProtocolVersion::V2_BINARY), 16, 20),
+                "replay a partir do último seq visto", "seq 16 a 20 de " + std::to_string(count));
+
+    // Um cliente em dia, ou vindo de uma época anterior com números maiores, não recebe nada
+    out.clear();
+    bool nothing = ring.encode_since(20, ProtocolVersion::V1_TEXT, out) == 0 &&
+                   ring.encode_since(500, ProtocolVersion::V1_TEXT, out) == 0 && out.empty();
+    ok &= check(nothing, "nada a reenviar para seq >= último", "since 20 e 500");
+
+    // Depois de um arranque com arquivo: continua a numeração do disco, mas o
+    // replay nunca inclui números que o anel não guardou
+    HistoryRing resumed(8);
+    resumed.resume_from(100);
+    for (uint64_t i = 101; i <= 103; ++i) {
+        Message msg(MessageType::CHAT_BROADCAST, "alice", "msg " + std::to_string(i));
+        resumed.append(msg);
+    }
+    out.clear();
+    count = resumed.encode_since(0, ProtocolVersion::V1_TEXT, out);
+    ok &= check(resumed.last_seq() == 103 && count == 3 &&
+                replay_matches(decode_backlog(out, ProtocolVersion::V1_TEXT), 101, 103),
+                "resume_from() continua a numeração sem reenviar antes dela", "seq 101 a 103 de " + std::to_string(count));
+    return ok;
+}
+
+// --- PBKDF2-HMAC-SHA256 ---
+
+struct Pbkdf2Vector {
+    std::string password;
+    std::string salt;
+    uint32_t iterations;
+    const char* expected_hex; // primeiros 32 bytes da chave derivada
+};
+
+std::string to_hex(const uint8_t* data, size_t len) {
+    static const char HEX[] = "0123456789abcdef";
+    std::string hex;
+    for (size_t i = 0; i < len; ++i) {
+        hex += HEX[data[i] >> 4];
+        hex += HEX[data[i] & 15];
+    }
+    return hex;
+}
+
+bool run_password_hash_checks() {
+    std::cout << "PBKDF2-HMAC-SHA256" << std::endl;
+    bool ok = true;
+
+    // Vetores publicados (RFC 7914 §11 e os equivalentes SHA-256 dos do RFC 6070);
+    // o último, com uma senha maior que o bloco do HMAC, vem do hashlib do Python
+    const Pbkdf2Vector vectors[] = {
+        {"password", "salt", 1, "120fb6cffcf8b32c43e7225256c4f837a86548c92ccc35480805987cb70be17b"},
+        {"password", "salt", 2, "ae4d0c95af6b46d32d0adff928f06dd02a303f8ef3c251dfd6e2d85a95474c43"},
+        {"password", "salt", 4096, "c5e478d59288c841aa530db6845c4c8d962893a001ce4e11a4963873aa98134a"},
+        {"passwordPASSWORDpassword", "saltSALTsaltSALTsaltSALTsaltSALTsalt", 4096,
+         "348c89dbcbd32b2f32d814b8116e84cf2b17347ebc1800181c4e2a1fb8dd53e1"},
+        {std::string("pass\0word", 9), std::string("sa\0lt", 5), 4096,
+         "89b69d0516f829893c696226650a86878c029ac13ee276509d5ae58b6466a724"},
+        {"passwd", "salt", 1, "55ac046e56e3089fec1691c22544b605f94185216dde0465e68b9d57c20dacbc"},
+        {std::string(100, 'x'), "salt", 2, "d43a18cd77bafc1a4b0c6025dbbf29c7e6d67acce6ad02a736d4a3003b6a3c26"},
+    };
+    for (const Pbkdf2Vector& vector : vectors) {
+        uint8_t derived[PasswordHasher::HASH_SIZE];
+        PasswordHasher::pbkdf2_sha256(vector.password, reinterpret_cast<const uint8_t*>(vector.salt.data()),
+                                      vector.salt.size(), vector.iterations, derived);
+        std::string hex = to_hex(derived, sizeof(derived));
+        ok &= check(hex == vector.expected_hex,
+                    "vetor conhecido, " + std::to_string(vector.password.size()) + " bytes de senha, c=" +
+                        std::to_string(vector.iterations),
+                    hex.substr(0, 16) + "...");
+    }
+
+    std::string stored = PasswordHasher::hash("segredo", 1000);
+    bool format = stored.rfind("pbkdf2$1000$", 0) == 0 && PasswordHasher::is_hashed(stored);
+    ok &= check(format && PasswordHasher::verify("segredo", stored) && !PasswordHasher::verify("Segredo", stored),
+                "hash()/verify() aceitam a senha certa e recusam outra", stored.substr(0, 24) + "...");
+    ok &= check(PasswordHasher::hash("segredo", 1000) != stored, "salt aleatório em cada hash()", "dois hashes diferentes");
+    return ok;
+}
+
+int main() {
+    std::cout << "=== VERIFICAÇÕES DO CHAT ===" << std::endl;
+    bool ok = true;
+    ok &= run_read_buffer_checks();
+    ok &= run_protocol_checks();
+    ok &= run_mpsc_checks();
+    ok &= run_timer_wheel_checks();
+    ok &= run_history_checks();
+    ok &= run_password_hash_checks();
+    std::cout << (ok ? "Todas as verificações passaram." : "Há verificações que falharam.") << std::endl;
+    return ok ? 0 : 1;
+}
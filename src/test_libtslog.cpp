@@ -4,6 +4,9 @@
 #include <random>
 #include <chrono>
 #include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdio>
 
 void worker_thread(int thread_id, int num_messages) {
     std::random_device rd;
@@ -52,7 +55,87 @@ void stress_test() {
     LOG_INFO("Tempo total: " + std::to_string(duration.count()) + "ms");
 }
 
-int main() {
+// --- Verificações do modo assíncrono (./test_libtslog --async) ---
+
+const char* ASYNC_LOG_FILE = "test_libtslog_async.log";
+
+size_t count_lines_with(const std::string& marker) {
+    std::ifstream file(ASYNC_LOG_FILE);
+    std::string line;
+    size_t count = 0;
+    while (std::getline(file, line)) {
+        if (line.find(marker) != std::string::npos) ++count;
+    }
+    return count;
+}
+
+// Várias threads registam num anel de capacidade ring_capacity; retorna as linhas no ficheiro
+size_t log_async(const std::string& marker, tslog::OverflowPolicy policy, size_t ring_capacity,
+                 int threads, int per_thread) {
+    std::remove(ASYNC_LOG_FILE);
+    tslog::AsyncOptions options;
+    options.ring_capacity = ring_capacity;
+    options.overflow = policy;
+    tslog::Logger::getInstance().configure(ASYNC_LOG_FILE, tslog::LogLevel::DEBUG, false, true,
+                                           tslog::LogMode::ASYNC, options);
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&marker, t, per_thread] {
+            for (int i = 0; i < per_thread; ++i) {
+                LOG_INFO(marker + " " + std::to_string(t) + "/" + std::to_string(i));
+            }
+        });
+    }
+    for (auto& worker : workers) worker.join();
+    tslog::Logger::getInstance().flush();
+    return count_lines_with(marker);
+}
+
+bool check(bool condition, const std::string& name, const std::string& detail) {
+    std::cout << (condition ? "  OK      " : "  FALHOU  ") << name << " (" << detail << ")" << std::endl;
+    return condition;
+}
+
+int run_async_checks() {
+    std::cout << "=== VERIFICAÇÕES DO MODO ASSÍNCRONO ===" << std::endl;
+    const int THREADS = 8;
+    const int PER_THREAD = 5000;
+    const size_t TOTAL = static_cast<size_t>(THREADS) * PER_THREAD;
+    tslog::Logger& logger = tslog::Logger::getInstance();
+    bool ok = true;
+
+    // Anel minúsculo e DROP: os produtores ultrapassam a thread de escrita
+    uint64_t dropped_before = logger.dropped_count();
+    size_t lines = log_async("drop-check", tslog::OverflowPolicy::DROP, 64, THREADS, PER_THREAD);
+    uint64_t dropped = logger.dropped_count() - dropped_before;
+    ok &= check(dropped > 0, "DROP avança o contador de descartes", std::to_string(dropped) + " descartados");
+    ok &= check(lines + dropped == TOTAL, "DROP: gravados + descartados = registados",
+                std::to_string(lines) + " + " + std::to_string(dropped) + " de " + std::to_string(TOTAL));
+
+    // O mesmo anel com BLOCK: os produtores esperam e nada se perde
+    dropped_before = logger.dropped_count();
+    lines = log_async("block-check", tslog::OverflowPolicy::BLOCK, 64, THREADS, PER_THREAD);
+    dropped = logger.dropped_count() - dropped_before;
+    ok &= check(lines == TOTAL && dropped == 0, "BLOCK não perde registos",
+                std::to_string(lines) + " de " + std::to_string(TOTAL));
+
+    // Um anel maior substitui o anterior: o flush() tem de esperar pelos registos do novo
+    dropped_before = logger.dropped_count();
+    lines = log_async("flush-check", tslog::OverflowPolicy::DROP_AND_REPORT, 16384, THREADS, PER_THREAD);
+    dropped = logger.dropped_count() - dropped_before;
+    ok &= check(lines + dropped == TOTAL, "flush() deixa tudo no ficheiro",
+                std::to_string(lines) + " gravados, " + std::to_string(dropped) + " descartados");
+
+    logger.configure("", tslog::LogLevel::INFO, false, false);
+    std::remove(ASYNC_LOG_FILE);
+    std::cout << (ok ? "Todas as verificações passaram." : "Há verificações que falharam.") << std::endl;
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && std::string(argv[1]) == "--async") return run_async_checks();
+
     std::cout << "=== TESTE DA BIBLIOTECA LIBTSLOG ===" << std::endl;
     std::cout << "Logs serão salvos em 'test_libtslog.log'" << std::endl;
     
@@ -0,0 +1,123 @@
+#include "timer_wheel.h"
+#include "libtslog.h"
+
+namespace chat {
+
+void TimerWheel::Handle::cancel() {
+    EntryPtr entry = entry_.lock();
+    if (!entry) return;
+    std::lock_guard<std::mutex> lock(entry->mutex);
+    entry->cancelled = true;
+    entry->callback = nullptr; // solta já o que o callback capturou
+}
+
+TimerWheel::TimerWheel(std::chrono::milliseconds tick)
+    : tick_(tick.count() > 0 ? tick : std::chrono::milliseconds(1)), now_tick_(0), running_(false), armed_(0) {}
+
+TimerWheel::~TimerWheel() {
+    stop();
+}
+
+void TimerWheel::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) return;
+    running_ = true;
+    thread_ = std::thread(&TimerWheel::run, this);
+}
+
+void TimerWheel::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) return;
+        running_ = false;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) thread_.join();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& level : wheel_) {
+        for (auto& slot : level) slot.clear();
+    }
+    armed_.store(0);
+}
+
+TimerWheel::Handle TimerWheel::schedule(std::chrono::milliseconds delay, std::function<void()> callback) {
+    auto entry = std::make_shared<Entry>();
+    entry->callback = std::move(callback);
+    // Arredonda para cima: nunca dispara antes do atraso pedido
+    uint64_t ticks = static_cast<uint64_t>((delay.count() + tick_.count() - 1) / tick_.count());
+    if (ticks == 0) ticks = 1;
+    const uint64_t max_ticks = (SLOTS << (SLOT_BITS * (LEVELS - 1))) - (uint64_t(1) << (SLOT_BITS * (LEVELS - 1)));
+    if (ticks > max_ticks) ticks = max_ticks;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running_) return Handle();
+    entry->expires = now_tick_ + ticks;
+    Handle handle{std::weak_ptr<Entry>(entry)};
+    insert(std::move(entry));
+    armed_.fetch_add(1, std::memory_order_relaxed);
+    return handle;
+}
+
+void TimerWheel::insert(EntryPtr entry) {
+    // Nível mais baixo em que a expiração cabe nas 64 posições à frente da atual;
+    // assim a posição nunca coincide com a que acabou de descer
+    int level = 0;
+    while (level < LEVELS - 1 &&
+           (entry->expires >> (SLOT_BITS * level)) - (now_tick_ >> (SLOT_BITS * level)) >= SLOTS) {
+        ++level;
+    }
+    uint64_t slot = (entry->expires >> (SLOT_BITS * level)) & SLOT_MASK;
+    wheel_[level][slot].push_back(std::move(entry));
+}
+
+void TimerWheel::advance(std::vector<EntryPtr>& expired) {
+    ++now_tick_;
+    // Ao completar uma volta de um nível, a posição correspondente do nível acima desce
+    for (int level = 1; level < LEVELS; ++level) {
+        if ((now_tick_ & ((uint64_t(1) << (SLOT_BITS * level)) - 1)) != 0) break;
+        Slot cascade;
+        cascade.swap(wheel_[level][(now_tick_ >> (SLOT_BITS * level)) & SLOT_MASK]);
+        for (auto& entry : cascade) insert(std::move(entry));
+    }
+
+    // No nível 0 a posição atual só contém o que expira neste tick
+    Slot& slot = wheel_[0][now_tick_ & SLOT_MASK];
+    for (auto& entry : slot) expired.push_back(std::move(entry));
+    slot.clear();
+}
+
+void TimerWheel::run() {
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point next = Clock::now() + tick_;
+    std::vector<EntryPtr> expired;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        if (cv_.wait_until(lock, next, [this]{ return !running_; })) break;
+        // Se a thread atrasou, recupera todos os ticks em falta
+        Clock::time_point now = Clock::now();
+        while (next <= now) {
+            advance(expired);
+            next += tick_;
+        }
+        if (expired.empty()) continue;
+
+        armed_.fetch_sub(expired.size(), std::memory_order_relaxed);
+        lock.unlock();
+        for (auto& entry : expired) {
+            std::lock_guard<std::mutex> entry_lock(entry->mutex);
+            if (entry->cancelled || !entry->callback) continue;
+            try {
+                entry->callback();
+            } catch (const std::exception& e) {
+                LOG_ERROR(std::string("Exceção num temporizador: ") + e.what());
+            }
+            entry->callback = nullptr;
+        }
+        expired.clear();
+        lock.lock();
+    }
+}
+
+}
@@ -2,74 +2,318 @@
 #include "libtslog.h"
 #include <fstream>
 #include <sstream>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
 
 namespace chat {
 
-UserDatabase::UserDatabase(const std::string& filepath) : db_filepath_(filepath) {
+namespace {
+bool write_all(int fd, const std::string& data) {
+    size_t offset = 0;
+    while (offset < data.size()) {
+        ssize_t n = write(fd, data.data() + offset, data.size() - offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        offset += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// fsync do diretório para que o rename() sobreviva a uma queda de energia
+void sync_parent_dir(const std::string& path) {
+    size_t slash = path.find_last_of('/');
+    std::string dir = slash == std::string::npos ? "." : path.substr(0, slash == 0 ? 1 : slash);
+    int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd == -1) return;
+    fsync(fd);
+    close(fd);
+}
+}
+
+UserDatabase::UserDatabase(const std::string& filepath, uint32_t kdf_iterations)
+    : db_filepath_(filepath), journal_filepath_(filepath + ".journal"),
+      kdf_iterations_(kdf_iterations), user_count_(0), journal_fd_(-1), journal_records_(0), journal_dirty_(false), rotated_pending_(false),
+      compact_requested_(false), stopping_(false) {
     load();
+    compaction_thread_ = std::thread(&UserDatabase::compaction_loop, this);
 }
 
-void UserDatabase::load() {
-    std::lock_guard<std::mutex> lock(db_mutex_);
-    std::ifstream file(db_filepath_);
-    if (!file.is_open()) {
-        LOG_WARNING("Arquivo de banco de dados '" + db_filepath_ + "' não encontrado. Será criado um novo.");
-        return;
+UserDatabase::~UserDatabase() {
+    {
+        std::lock_guard<std::mutex> lock(worker_mutex_);
+        stopping_ = true;
     }
+    worker_cv_.notify_one();
+    if (compaction_thread_.joinable()) compaction_thread_.join();
+    compact();
+    if (journal_fd_ != -1) close(journal_fd_);
+}
+
+UserDatabase::Shard& UserDatabase::shard_for(const std::string& username) {
+    return shards_[std::hash<std::string>()(username) % SHARD_COUNT];
+}
+
+const UserDatabase::Shard& UserDatabase::shard_for(const std::string& username) const {
+    return shards_[std::hash<std::string>()(username) % SHARD_COUNT];
+}
+
+// Insere ou substitui; retorna true se o utilizador é novo
+bool UserDatabase::store(const std::string& username, const std::string& hashed) {
+    Shard& shard = shard_for(username);
+    std::unique_lock<ProfiledSharedMutex> lock(shard.mutex);
+    bool inserted = shard.users.insert_or_assign(username, hashed).second;
+    if (inserted) user_count_.fetch_add(1, std::memory_order_relaxed);
+    return inserted;
+}
+
+bool UserDatabase::replay(const std::string& path, size_t& records) {
+    records = 0;
+    std::ifstream file(path);
+    if (!file.is_open()) return false;
 
     std::string line;
     while (std::getline(file, line)) {
+        // Linha sem '\n' no fim: escrita interrompida por uma queda, descarta
+        if (file.eof()) break;
         std::stringstream ss(line);
         std::string username, password;
         if (std::getline(ss, username, ':') && std::getline(ss, password)) {
-            users_[username] = password;
+            store(username, password);
+            ++records;
         }
     }
-    LOG_INFO(std::to_string(users_.size()) + " usuários carregados do banco de dados.");
+    return true;
+}
+
+void UserDatabase::load() {
+    size_t snapshot_records = 0, rotated_records = 0, journal_records = 0;
+    if (!replay(db_filepath_, snapshot_records)) {
+        LOG_WARNING("Arquivo de banco de dados '" + db_filepath_ + "' não encontrado. Será criado um novo.");
+    }
+    // Um journal ".compacting" só existe se a última compactação não terminou
+    rotated_pending_ = replay(journal_filepath_ + ".compacting", rotated_records);
+    replay(journal_filepath_, journal_records);
+    LOG_INFO(std::to_string(get_user_count()) + " usuários carregados do banco de dados.");
+
+    journal_records_ = rotated_records + journal_records;
+    if (!open_journal()) return;
+    // Incorpora o journal no snapshot logo no arranque (e descarta registos truncados)
+    if (journal_records_ > 0 || rotated_pending_) compact();
+}
+
+bool UserDatabase::open_journal() {
+    journal_fd_ = open(journal_filepath_.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    if (journal_fd_ == -1) {
+        LOG_ERROR("Não foi possível abrir o journal '" + journal_filepath_ + "': " + strerror(errno));
+        return false;
+    }
+    return true;
 }
 
-void UserDatabase::save() {
-    
-    std::ofstream file(db_filepath_, std::ios::trunc);
-    if (!file.is_open()) {
+void UserDatabase::append_journal(const std::string& username, const std::string& password) {
+    std::string record = username + ":" + password + "\n";
+    bool request_compaction = false;
+    {
+        std::lock_guard<ProfiledMutex> lock(journal_mutex_);
+        // Um único write() com O_APPEND; o fsync fica a cargo da compactação
+        if (journal_fd_ == -1 || !write_all(journal_fd_, record)) {
+            LOG_ERROR("Falha ao escrever no journal '" + journal_filepath_ + "'");
+            return;
+        }
+        ++journal_records_;
+        journal_dirty_ = true;
+        request_compaction = compaction_due();
+    }
+    if (request_compaction) {
+        {
+            std::lock_guard<std::mutex> lock(worker_mutex_);
+            compact_requested_ = true;
+        }
+        worker_cv_.notify_one();
+    }
+}
+
+bool UserDatabase::compaction_due() const {
+    size_t threshold = std::max(COMPACT_MIN_RECORDS, user_count_.load(std::memory_order_relaxed) / COMPACT_FRACTION);
+    return journal_records_ >= threshold;
+}
+
+void UserDatabase::sync_journal() {
+    int fd;
+    {
+        std::lock_guard<ProfiledMutex> lock(journal_mutex_);
+        if (!journal_dirty_ || journal_fd_ == -1) return;
+        // Uma cópia do descritor: o fdatasync corre sem o lock e a rotação pode fechar o original
+        fd = dup(journal_fd_);
+        if (fd == -1) return;
+        journal_dirty_ = false;
+    }
+    if (fdatasync(fd) != 0) {
+        LOG_ERROR("Falha ao sincronizar o journal '" + journal_filepath_ + "': " + strerror(errno));
+    }
+    close(fd);
+}
+
+bool UserDatabase::write_snapshot(const UserMap& users) {
+    std::string tmp_path = db_filepath_ + ".tmp";
+    int fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd == -1) {
+        LOG_ERROR("Não foi possível salvar o banco de dados em '" + tmp_path + "'");
+        return false;
+    }
+
+    const size_t CHUNK_SIZE = 64 * 1024;
+    std::string chunk;
+    chunk.reserve(CHUNK_SIZE + 256);
+    bool ok = true;
+    for (const auto& pair : users) {
+        chunk.append(pair.first).append(1, ':').append(pair.second).append(1, '\n');
+        if (chunk.size() >= CHUNK_SIZE) {
+            ok = write_all(fd, chunk);
+            chunk.clear();
+            if (!ok) break;
+        }
+    }
+    if (ok) ok = write_all(fd, chunk) && fsync(fd) == 0;
+    close(fd);
+
+    // O rename() troca o snapshot de forma atómica: ou fica o antigo ou o novo
+    if (!ok || rename(tmp_path.c_str(), db_filepath_.c_str()) != 0) {
         LOG_ERROR("Não foi possível salvar o banco de dados em '" + db_filepath_ + "'");
-        return;
+        unlink(tmp_path.c_str());
+        return false;
+    }
+    sync_parent_dir(db_filepath_);
+    return true;
+}
+
+bool UserDatabase::compact() {
+    std::lock_guard<ProfiledMutex> running(compaction_mutex_);
+    std::string rotated_path = journal_filepath_ + ".compacting";
+    size_t records;
+    {
+        // Só a rotação fica sob o lock do journal: os registos não esperam pela cópia
+        std::lock_guard<ProfiledMutex> lock(journal_mutex_);
+        if (journal_records_ == 0 && !rotated_pending_) return true;
+        records = journal_records_;
+        // Se uma compactação anterior falhou, o journal rodado ainda é a única cópia
+        // em disco desses registos e não pode ser sobrescrito.
+        if (!rotated_pending_ && journal_fd_ != -1) {
+            close(journal_fd_);
+            journal_fd_ = -1;
+            if (rename(journal_filepath_.c_str(), rotated_path.c_str()) == 0) {
+                rotated_pending_ = true;
+                journal_records_ = 0;
+                journal_dirty_ = false; // o snapshot novo é sincronizado
+            }
+            open_journal();
+        }
+    }
+
+    // add_user insere no shard antes de escrever no journal, por isso tudo o que
+    // foi rodado já está nos shards. A cópia pode apanhar registos mais novos,
+    // que também estão no journal novo: repeti-los no arranque é inofensivo.
+    // Cada shard fica bloqueado (só para escrita) apenas durante a sua cópia.
+    UserMap copy;
+    copy.reserve(user_count_.load());
+    for (const Shard& shard : shards_) {
+        std::shared_lock<ProfiledSharedMutex> shard_lock(shard.mutex);
+        copy.insert(shard.users.begin(), shard.users.end());
     }
 
-    for (const auto& pair : users_) {
-        file << pair.first << ":" << pair.second << "\n";
+    // A escrita do snapshot corre sem locks: logins e registos continuam
+    if (!write_snapshot(copy)) return false;
+
+    std::lock_guard<ProfiledMutex> lock(journal_mutex_);
+    unlink(rotated_path.c_str());
+    rotated_pending_ = false;
+    LOG_DEBUG("Banco de dados compactado: " + std::to_string(copy.size()) + " utilizadores, " +
+              std::to_string(records) + " registos do journal incorporados.");
+    return true;
+}
+
+void UserDatabase::compaction_loop() {
+    std::unique_lock<std::mutex> lock(worker_mutex_);
+    while (!stopping_) {
+        worker_cv_.wait_for(lock, std::chrono::seconds(COMPACT_INTERVAL_SECONDS),
+                            [this]{ return stopping_ || compact_requested_; });
+        if (stopping_) break;
+        bool requested = compact_requested_;
+        compact_requested_ = false;
+        lock.unlock();
+        if (!requested) {
+            // Sem pedido só se repete uma compactação que falhou; o resto espera pelo limiar
+            std::lock_guard<ProfiledMutex> journal_lock(journal_mutex_);
+            requested = rotated_pending_;
+        }
+        if (requested) {
+            compact();
+        } else {
+            sync_journal();
+        }
+        lock.lock();
     }
-    file.flush();
 }
 
 bool UserDatabase::add_user(const std::string& username, const std::string& password) {
-    std::lock_guard<std::mutex> lock(db_mutex_);
-    if (users_.count(username)) {
+    // O registo em disco é "nome:hash\n": estes bytes no nome criariam outro registo
+    if (username.empty() || username.find_first_of(":\r\n") != std::string::npos) {
+        return false;
+    }
+    if (user_exists(username)) {
         return false; // Usuário já existe
     }
-    users_[username] = password;
-    save(); // save() agora é chamado com o lock já adquirido
+    std::string hashed = PasswordHasher::hash(password, kdf_iterations_);
+    {
+        Shard& shard = shard_for(username);
+        std::unique_lock<ProfiledSharedMutex> lock(shard.mutex);
+        if (!shard.users.emplace(username, hashed).second) return false;
+    }
+    user_count_.fetch_add(1, std::memory_order_relaxed);
+    // O disco fica fora dos locks dos utilizadores: logins nunca esperam por I/O
+    append_journal(username, hashed);
     LOG_INFO("Novo usuário '" + username + "' registrado.");
     return true;
 }
 
-bool UserDatabase::validate_user(const std::string& username, const std::string& password) const {
-    std::lock_guard<std::mutex> lock(db_mutex_);
-    auto it = users_.find(username);
-    if (it != users_.end()) {
-        return it->second == password;
+bool UserDatabase::validate_user(const std::string& username, const std::string& password) {
+    std::string stored;
+    {
+        const Shard& shard = shard_for(username);
+        std::shared_lock<ProfiledSharedMutex> lock(shard.mutex);
+        auto it = shard.users.find(username);
+        if (it == shard.users.end()) return false;
+        stored = it->second;
+    }
+    if (!PasswordHasher::verify(password, stored)) return false;
+
+    if (!PasswordHasher::is_hashed(stored)) {
+        std::string hashed = PasswordHasher::hash(password, kdf_iterations_);
+        {
+            Shard& shard = shard_for(username);
+            std::unique_lock<ProfiledSharedMutex> lock(shard.mutex);
+            auto it = shard.users.find(username);
+            if (it == shard.users.end() || it->second != stored) return true;
+            it->second = hashed;
+        }
+        append_journal(username, hashed);
+        LOG_INFO("Senha de '" + username + "' convertida para PBKDF2.");
     }
-    return false;
+    return true;
 }
 
 bool UserDatabase::user_exists(const std::string& username) const {
-    std::lock_guard<std::mutex> lock(db_mutex_);
-    return users_.count(username) > 0;
+    const Shard& shard = shard_for(username);
+    std::shared_lock<ProfiledSharedMutex> lock(shard.mutex);
+    return shard.users.count(username) > 0;
 }
 
 size_t UserDatabase::get_user_count() const {
-    std::lock_guard<std::mutex> lock(db_mutex_);
-    return users_.size();
+    return user_count_.load(std::memory_order_relaxed);
 }
 
-} 
+}